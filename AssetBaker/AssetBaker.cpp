@@ -0,0 +1,275 @@
+// Build step of the overlay: turns the assets into a header that is compiled into the executable, so that nothing
+// has to be decoded or read at runtime. The icon is decoded once and stored as RGBA in the sizes the window uses,
+// the shaders are compiled and linked on a hidden GL context so that errors break the build instead of the overlay.
+//
+// AssetBaker <assets directory> <output header>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <lodepng.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+const int k_iconSizes[] = { 64, 32, 16 };
+
+struct ShaderSource {
+	const char* file;
+	const char* name; // of the array in the header
+	GLenum type;
+	std::string code;
+};
+
+// the programs the application links, as indices into the shader list
+const int k_programs[][2] = {
+	{ 0, 1 }, // overlay
+	{ 0, 2 }, // preview window
+};
+
+bool readFile(const std::string& path, std::string& contents) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) return false;
+
+	std::stringstream buffer;
+	buffer << file.rdbuf();
+	contents = buffer.str();
+
+	// the sources are checked out with either line ending, the header always gets the same
+	contents.erase(std::remove(contents.begin(), contents.end(), '\r'), contents.end());
+	return true;
+}
+
+// 2x2 box filter, the icon is square with a power of two size
+std::vector<uint8_t> halveImage(const std::vector<uint8_t>& source, int size) {
+	int half = size / 2;
+	std::vector<uint8_t> result(half * half * 4);
+
+	for (int y = 0; y < half; y++) {
+		for (int x = 0; x < half; x++) {
+			for (int c = 0; c < 4; c++) {
+				int sum = source[((2 * y) * size + 2 * x) * 4 + c] + source[((2 * y) * size + 2 * x + 1) * 4 + c] +
+					source[((2 * y + 1) * size + 2 * x) * 4 + c] + source[((2 * y + 1) * size + 2 * x + 1) * 4 + c];
+				result[(y * half + x) * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+			}
+		}
+	}
+
+	return result;
+}
+
+// drivers put the line number into their messages in one of two ways, "0(12) :" or "0:12:"
+int findErrorLine(const std::string& message) {
+	std::smatch match;
+
+	if (std::regex_search(message, match, std::regex("^\\d+\\((\\d+)\\)")) || std::regex_search(message, match, std::regex("^\\w*:? ?\\d+:(\\d+):"))) {
+		return std::stoi(match[1].str());
+	}
+
+	return 1;
+}
+
+// every line of the info log becomes an error the IDE can jump to
+void reportErrors(const std::string& path, const std::string& log) {
+	std::istringstream lines(log);
+	std::string line;
+
+	while (std::getline(lines, line)) {
+		if (line.empty()) continue;
+
+		fprintf(stderr, "%s(%d): error : %s\n", path.c_str(), findErrorLine(line), line.c_str());
+	}
+}
+
+bool validateShaders(const std::string& directory, std::vector<ShaderSource>& shaders) {
+	if (!glfwInit()) {
+		printf("AssetBaker : warning : no OpenGL available, the shaders are not validated\n");
+		return true;
+	}
+
+	// the same context the application asks for
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow* window = glfwCreateWindow(16, 16, "AssetBaker", NULL, NULL);
+
+	if (window == NULL) {
+		printf("AssetBaker : warning : no OpenGL 4.1 context available, the shaders are not validated\n");
+		glfwTerminate();
+		return true;
+	}
+
+	glfwMakeContextCurrent(window);
+
+	bool success = glewInit() == GLEW_OK;
+	std::vector<GLuint> ids;
+
+	for (const ShaderSource& shader : shaders) {
+		GLuint id = glCreateShader(shader.type);
+		const char* code = shader.code.c_str();
+		glShaderSource(id, 1, &code, NULL);
+		glCompileShader(id);
+
+		GLint status = GL_FALSE;
+		GLint logLength = 0;
+		glGetShaderiv(id, GL_COMPILE_STATUS, &status);
+		glGetShaderiv(id, GL_INFO_LOG_LENGTH, &logLength);
+
+		if (status != GL_TRUE) {
+			std::vector<char> log(logLength + 1);
+			glGetShaderInfoLog(id, logLength, NULL, log.data());
+			reportErrors(directory + "/shaders/" + shader.file, log.data());
+			success = false;
+		}
+
+		ids.push_back(id);
+	}
+
+	for (const auto& program : k_programs) {
+		if (!success) break;
+
+		GLuint id = glCreateProgram();
+		glAttachShader(id, ids[program[0]]);
+		glAttachShader(id, ids[program[1]]);
+		glLinkProgram(id);
+
+		GLint status = GL_FALSE;
+		GLint logLength = 0;
+		glGetProgramiv(id, GL_LINK_STATUS, &status);
+		glGetProgramiv(id, GL_INFO_LOG_LENGTH, &logLength);
+
+		if (status != GL_TRUE) {
+			std::vector<char> log(logLength + 1);
+			glGetProgramInfoLog(id, logLength, NULL, log.data());
+			reportErrors(directory + "/shaders/" + shaders[program[1]].file, log.data());
+			success = false;
+		}
+
+		glDeleteProgram(id);
+	}
+
+	if (success) {
+		printf("AssetBaker: %d shaders validated on %s\n", static_cast<int>(shaders.size()), glGetString(GL_RENDERER));
+	}
+
+	for (GLuint id : ids) {
+		glDeleteShader(id);
+	}
+
+	glfwDestroyWindow(window);
+	glfwTerminate();
+
+	return success;
+}
+
+void writePixels(std::ostringstream& header, const char* name, const std::vector<uint8_t>& pixels) {
+	header << "constexpr unsigned char " << name << "[" << pixels.size() << "] = {";
+
+	for (size_t i = 0; i < pixels.size(); i++) {
+		header << ((i % 32 == 0) ? "\n\t" : " ") << static_cast<int>(pixels[i]) << ",";
+	}
+
+	header << "\n};\n\n";
+}
+
+int main(int argc, char** argv) {
+	if (argc < 3) {
+		fprintf(stderr, "usage: AssetBaker <assets directory> <output header>\n");
+		return 1;
+	}
+
+	std::string directory = argv[1];
+	std::string outputPath = argv[2];
+
+	std::vector<ShaderSource> shaders = {
+		{ "fullscreen.vert", "k_fullscreenVertexShader", GL_VERTEX_SHADER },
+		{ "overlay.frag", "k_overlayFragmentShader", GL_FRAGMENT_SHADER },
+		{ "preview.frag", "k_previewFragmentShader", GL_FRAGMENT_SHADER },
+	};
+
+	for (ShaderSource& shader : shaders) {
+		std::string path = directory + "/shaders/" + shader.file;
+
+		if (!readFile(path, shader.code)) {
+			fprintf(stderr, "%s : error : could not read the shader\n", path.c_str());
+			return 1;
+		}
+
+		if (shader.code.find(")glsl\"") != std::string::npos) {
+			fprintf(stderr, "%s : error : the shader contains the raw string delimiter )glsl\"\n", path.c_str());
+			return 1;
+		}
+	}
+
+	if (!validateShaders(directory, shaders)) {
+		return 1;
+	}
+
+	std::string iconPath = directory + "/icon.png";
+	std::vector<uint8_t> pixels;
+	unsigned width, height;
+
+	unsigned error = lodepng::decode(pixels, width, height, iconPath);
+	if (error != 0) {
+		fprintf(stderr, "%s : error : %s\n", iconPath.c_str(), lodepng_error_text(error));
+		return 1;
+	}
+
+	if (width != height || (width & (width - 1)) != 0 || width < static_cast<unsigned>(k_iconSizes[0])) {
+		fprintf(stderr, "%s : error : the icon has to be square with a power of two size of at least %d\n", iconPath.c_str(), k_iconSizes[0]);
+		return 1;
+	}
+
+	std::ostringstream header;
+	header << "// generated by AssetBaker from the assets directory, do not edit\n#pragma once\n\n";
+
+	for (const ShaderSource& shader : shaders) {
+		header << "constexpr char " << shader.name << "[] = R\"glsl(" << shader.code << ")glsl\";\n\n";
+	}
+
+	// every size is halved from the one before, so the small icons are as sharp as box filtering gets
+	int size = static_cast<int>(width);
+	std::string images;
+
+	for (int iconSize : k_iconSizes) {
+		while (size > iconSize) {
+			pixels = halveImage(pixels, size);
+			size /= 2;
+		}
+
+		std::string name = "k_iconPixels" + std::to_string(iconSize);
+		writePixels(header, name.c_str(), pixels);
+		images += "\t{ " + std::to_string(iconSize) + ", " + std::to_string(iconSize) + ", " + name + " },\n";
+	}
+
+	header << "struct BakedImage {\n\tint width;\n\tint height;\n\tconst unsigned char* pixels; // RGBA\n};\n\n";
+	header << "constexpr BakedImage k_iconImages[] = {\n" << images << "};\n";
+
+	// an unchanged header keeps its timestamp, so nothing including it is rebuilt
+	std::string existing;
+	if (readFile(outputPath, existing) && existing == header.str()) {
+		return 0;
+	}
+
+	std::filesystem::path parent = std::filesystem::path(outputPath).parent_path();
+	if (!parent.empty()) {
+		std::filesystem::create_directories(parent);
+	}
+
+	std::ofstream output(outputPath, std::ios::binary);
+	output << header.str();
+
+	if (!output) {
+		fprintf(stderr, "%s : error : could not write the header\n", outputPath.c_str());
+		return 1;
+	}
+
+	printf("AssetBaker: wrote %s\n", outputPath.c_str());
+	return 0;
+}
@@ -0,0 +1,795 @@
+#include "ImagePyramid.h"
+#include "MotionDetector.h"
+#include "BackgroundModel.h"
+#include "SwipeDetector.h"
+#include "BlobTracker.h"
+#include "StereoMatcher.h"
+#include "FrameStore.h"
+#include "FrameGenerator.h"
+#include "SessionFile.h"
+#include "SwipePipeline.h"
+#include "TrackingDetector.h"
+#include "Evaluation.h"
+#include "Trace.h"
+#include "Log.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <new>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+// Runs every per-frame code path on synthetic frames of the usual Leap camera resolutions and writes
+// ns/frame, bytes/cycle and heap allocations per frame as JSON, so that releases can be compared.
+// A program of its own so that the allocation counting below never ends up in the overlay, it only
+// needs the image processing sources and builds on Linux as well (see CMakeLists.txt).
+
+// counts every heap allocation made through new, the per-frame paths are supposed to make none. All the replaceable
+// forms go through these, so that new[] and over-aligned allocations are counted as well
+std::atomic<uint64_t> s_allocationCount { 0 };
+
+void* countedAlloc(size_t size, size_t alignment) noexcept {
+	s_allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+	if (size == 0) {
+		size = 1;
+	}
+
+	if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+		return malloc(size);
+	}
+
+#ifdef _MSC_VER
+	return _aligned_malloc(size, alignment);
+#else
+	// aligned_alloc wants the size to be a multiple of the alignment
+	return aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+}
+
+void countedFree(void* memory, size_t alignment) noexcept {
+#ifdef _MSC_VER
+	if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+		_aligned_free(memory);
+		return;
+	}
+#else
+	(void)alignment;
+#endif
+
+	free(memory);
+}
+
+void* countedNew(size_t size, size_t alignment) {
+	if (void* memory = countedAlloc(size, alignment)) {
+		return memory;
+	}
+
+	throw std::bad_alloc();
+}
+
+const size_t k_defaultAlignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+void* operator new(size_t size) { return countedNew(size, k_defaultAlignment); }
+void* operator new[](size_t size) { return countedNew(size, k_defaultAlignment); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size, k_defaultAlignment); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size, k_defaultAlignment); }
+void* operator new(size_t size, std::align_val_t alignment) { return countedNew(size, static_cast<size_t>(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment) { return countedNew(size, static_cast<size_t>(alignment)); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return countedAlloc(size, static_cast<size_t>(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return countedAlloc(size, static_cast<size_t>(alignment)); }
+
+void operator delete(void* memory) noexcept { countedFree(memory, k_defaultAlignment); }
+void operator delete[](void* memory) noexcept { countedFree(memory, k_defaultAlignment); }
+void operator delete(void* memory, size_t) noexcept { countedFree(memory, k_defaultAlignment); }
+void operator delete[](void* memory, size_t) noexcept { countedFree(memory, k_defaultAlignment); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { countedFree(memory, k_defaultAlignment); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { countedFree(memory, k_defaultAlignment); }
+void operator delete(void* memory, std::align_val_t alignment) noexcept { countedFree(memory, static_cast<size_t>(alignment)); }
+void operator delete[](void* memory, std::align_val_t alignment) noexcept { countedFree(memory, static_cast<size_t>(alignment)); }
+void operator delete(void* memory, size_t, std::align_val_t alignment) noexcept { countedFree(memory, static_cast<size_t>(alignment)); }
+void operator delete[](void* memory, size_t, std::align_val_t alignment) noexcept { countedFree(memory, static_cast<size_t>(alignment)); }
+void operator delete(void* memory, std::align_val_t alignment, const std::nothrow_t&) noexcept { countedFree(memory, static_cast<size_t>(alignment)); }
+void operator delete[](void* memory, std::align_val_t alignment, const std::nothrow_t&) noexcept { countedFree(memory, static_cast<size_t>(alignment)); }
+
+// stderr without the debug records the log_record case writes by the thousand
+class SummarySink : public LogSink
+{
+public:
+	void write(LogLevel level, const char* line) override {
+		if (level >= LogLevel_Info) {
+			m_stderr.write(level, line);
+		}
+	}
+
+private:
+	StderrSink m_stderr;
+};
+
+// The detector the BackgroundModel replaced, for comparison: the number of bright pixels in the upper half of the full
+// resolution left image has to grow five frames in a row while above a fixed count. It only knew the one gesture that
+// toggled the overlay, so its swipes have no direction. Only lives here, the overlay never runs it.
+class BrightUpperPixels
+{
+public:
+	BrightUpperPixels() :
+		m_counts(k_historySize, 0)
+	{ }
+
+	bool processFrame(int width, int height, const uint8_t* image) {
+		uint32_t count = 0;
+
+		for (int i = 0; i < width * (height / 2); i++) {
+			count += (image[i] >= k_brightThreshold) ? 1 : 0;
+		}
+
+		m_counts[m_nextIndex] = count;
+		m_nextIndex = (m_nextIndex + 1) % m_counts.size();
+
+		return countIncreasing() >= k_increasingFrames;
+	}
+
+private:
+	static const uint8_t k_brightThreshold = 100;
+	static const uint32_t k_countThreshold = 30000;
+	static const uint32_t k_increasingFrames = 5;
+	static const size_t k_historySize = 50;
+
+	// frames in a row, going back from the newest one, whose count was above the threshold and higher than the one before
+	uint32_t countIncreasing() {
+		uint32_t result = 0;
+		uint32_t last = UINT32_MAX;
+
+		for (size_t i = 1; i <= m_counts.size(); i++) {
+			uint32_t value = m_counts[(m_nextIndex + m_counts.size() - i) % m_counts.size()];
+
+			if (value < k_countThreshold || value >= last) {
+				break;
+			}
+
+			result++;
+			last = value;
+		}
+
+		return result;
+	}
+
+	std::vector<uint32_t> m_counts;
+	size_t m_nextIndex { 0 };
+};
+
+struct BenchmarkResolution {
+	int width;
+	int height;
+};
+
+// Leap Motion Controller, Stereo IR 170 and Leap Motion Controller 2
+const BenchmarkResolution k_benchmarkResolutions[] = { { 640, 240 }, { 384, 384 }, { 640, 480 } };
+const int k_benchmarkFrameCount = 32; // distinct frames, the benchmarks cycle through them
+const int64_t k_benchmarkFrameInterval = 11111; // microseconds, 90 Hz
+
+struct BenchmarkResult {
+	std::string name;
+	int width;
+	int height;
+	uint64_t iterations;
+	double nsPerFrame;
+	double bytesPerCycle;
+	double allocationsPerFrame;
+};
+
+// how well a detector does on generated frames, whose ground truth is known, next to what it costs
+struct AccuracyResult {
+	std::string name;
+	int width;
+	int height;
+	std::string metric;
+	double value;
+};
+
+void reportAccuracy(std::vector<AccuracyResult>& accuracy, const char* name, const BenchmarkResolution& resolution, const char* metric, double value) {
+	LOG_INFO("Accuracy {} {}x{}: {} {}", name, resolution.width, resolution.height, metric, value);
+	accuracy.push_back({ name, resolution.width, resolution.height, metric, value });
+}
+
+template<typename Function>
+BenchmarkResult measure(const char* name, const BenchmarkResolution& resolution, uint64_t bytesPerFrame, uint64_t iterations, Function&& frame) {
+	// one untimed round lets caches warm up and the code under test allocate whatever it keeps around
+	for (uint64_t i = 0; i < k_benchmarkFrameCount && i < iterations; i++) {
+		frame(i);
+	}
+
+	uint64_t allocations = s_allocationCount.load(std::memory_order_relaxed);
+	auto start = std::chrono::steady_clock::now();
+	uint64_t startCycles = __rdtsc();
+
+	for (uint64_t i = 0; i < iterations; i++) {
+		frame(i);
+	}
+
+	uint64_t cycles = __rdtsc() - startCycles;
+	double nanoseconds = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+	allocations = s_allocationCount.load(std::memory_order_relaxed) - allocations;
+
+	BenchmarkResult result;
+	result.name = name;
+	result.width = resolution.width;
+	result.height = resolution.height;
+	result.iterations = iterations;
+	result.nsPerFrame = nanoseconds / iterations;
+	result.bytesPerCycle = (cycles > 0) ? static_cast<double>(bytesPerFrame) * iterations / cycles : 0.0;
+	result.allocationsPerFrame = static_cast<double>(allocations) / iterations;
+
+	LOG_INFO("Benchmark {} {}x{}: {} ns/frame, {} bytes/cycle, {} allocations/frame",
+		name, resolution.width, resolution.height, result.nsPerFrame, result.bytesPerCycle, result.allocationsPerFrame);
+
+	return result;
+}
+
+void benchmarkResolution(const BenchmarkResolution& resolution, std::vector<BenchmarkResult>& results) {
+	const uint64_t iterations = 2000;
+
+	int width = resolution.width;
+	int height = resolution.height;
+	size_t imageSize = static_cast<size_t>(width) * height;
+
+	// a hand sweeping across the view once over all frames
+	FrameGeneratorConfig config;
+	config.width = width;
+	config.height = height;
+	config.frameRate = 1e6f / k_benchmarkFrameInterval;
+	config.swipes.resize(1);
+	config.swipes[0].direction = SwipeDirection_FromLeft;
+	config.swipes[0].duration = k_benchmarkFrameCount * k_benchmarkFrameInterval;
+
+	FrameGenerator generator(config);
+
+	results.push_back(measure("frame_generator", resolution, imageSize * 2, iterations, [&](uint64_t i) {
+		generator.generate(i % k_benchmarkFrameCount);
+	}));
+
+	std::vector<std::vector<uint8_t>> frames;
+	for (int i = 0; i < k_benchmarkFrameCount; i++) {
+		generator.generate(i);
+		frames.emplace_back(generator.getImage(0), generator.getImage(0) + imageSize * 2);
+	}
+
+	auto left = [&](uint64_t i) { return frames[i % k_benchmarkFrameCount].data(); };
+	auto right = [&](uint64_t i) { return frames[i % k_benchmarkFrameCount].data() + imageSize; };
+
+	PyramidPool pool;
+
+	results.push_back(measure("pyramid_build", resolution, imageSize * 2, iterations, [&](uint64_t i) {
+		pool.build(i, width, height, left(i), right(i));
+	}));
+
+	// the detectors get prebuilt pyramids, so only their own work is measured
+	std::vector<std::shared_ptr<const ImagePyramid>> pyramids;
+	for (int i = 0; i < k_benchmarkFrameCount; i++) {
+		pyramids.push_back(pool.build(i, width, height, left(i), right(i)));
+	}
+
+	auto levelSize = [&](int level) { return static_cast<uint64_t>(width >> level) * (height >> level); };
+
+	MotionDetector motionDetector;
+	results.push_back(measure("motion_detector", resolution, levelSize(k_motionPyramidLevel) * 2, iterations, [&](uint64_t i) {
+		motionDetector.processFrame(pyramids[i % k_benchmarkFrameCount], i * k_benchmarkFrameInterval);
+	}));
+
+	BackgroundModel backgroundModel;
+	results.push_back(measure("background_model", resolution, levelSize(k_backgroundPyramidLevel), iterations, [&](uint64_t i) {
+		backgroundModel.processFrame(pyramids[i % k_benchmarkFrameCount]->getLevel(0, k_backgroundPyramidLevel));
+	}));
+
+	BrightUpperPixels brightUpperPixels;
+	results.push_back(measure("bright_upper_pixels", resolution, imageSize / 2, iterations, [&](uint64_t i) {
+		brightUpperPixels.processFrame(width, height, left(i));
+	}));
+
+	SwipeDetector swipeDetector;
+	swipeDetector.setFrameRate(1e6f / k_benchmarkFrameInterval);
+	results.push_back(measure("swipe_detector", resolution, levelSize(k_backgroundPyramidLevel), iterations, [&](uint64_t i) {
+		swipeDetector.processFrame(backgroundModel.getWidth(), backgroundModel.getHeight(), backgroundModel.getForegroundMask(), i * k_benchmarkFrameInterval);
+	}));
+
+	BlobTracker blobTracker;
+	results.push_back(measure("blob_tracker", resolution, levelSize(k_blobPyramidLevel), iterations, [&](uint64_t i) {
+		blobTracker.processFrame(pyramids[i % k_benchmarkFrameCount]->getLevel(0, k_blobPyramidLevel));
+	}));
+
+	// every other pixel bright in a checkerboard, the most runs and unions a frame can have
+	std::vector<uint8_t> checkerboard(levelSize(k_blobPyramidLevel));
+	PyramidLevel checkerboardLevel { width >> k_blobPyramidLevel, height >> k_blobPyramidLevel, checkerboard.data() };
+
+	for (int y = 0; y < checkerboardLevel.height; y++) {
+		for (int x = 0; x < checkerboardLevel.width; x++) {
+			checkerboard[y * checkerboardLevel.width + x] = ((x + y) % 2 == 0) ? 255 : 0;
+		}
+	}
+
+	results.push_back(measure("blob_tracker_checkerboard", resolution, levelSize(k_blobPyramidLevel), iterations, [&](uint64_t) {
+		blobTracker.processFrame(checkerboardLevel);
+	}));
+
+	StereoMatcher* stereoMatcher = StereoMatcher::getInstance();
+	results.push_back(measure("stereo_matcher", resolution, levelSize(k_stereoPyramidLevel) * 2, iterations / 10, [&](uint64_t i) {
+		stereoMatcher->compute(*pyramids[i % k_benchmarkFrameCount]);
+	}));
+
+	// the copies GraphicsManager::setFrame makes under its lock, the texture upload needs a GL context and is timed by the
+	// GraphicsManager itself (see its logStatistics)
+	FrameStore frameStore;
+
+	results.push_back(measure("set_frame", resolution, imageSize * 2, iterations, [&](uint64_t i) {
+		frameStore.setFrame(width, height, left(i), right(i));
+	}));
+
+	// the single camera view copies only the left image
+	results.push_back(measure("set_frame_mono", resolution, imageSize, iterations, [&](uint64_t i) {
+		frameStore.setFrame(width, height, left(i), nullptr);
+	}));
+
+	LOG_INFO("Benchmark {}x{}: stereo set_frame takes {} times as long as mono", width, height,
+		results[results.size() - 2].nsPerFrame / results.back().nsPerFrame);
+
+	// the same into the slots of a mapped pixel buffer, which is where frames go when the driver supports it. There this
+	// copy is the only one, uploading from client memory costs the driver another one. The render thread takes every frame
+	// and gets its slot back a frame later, when the GPU has read it
+	FrameStore mappedStore;
+	std::vector<uint8_t> slots(imageSize * 2 * k_frameSlots);
+	int uploadingSlot = -1;
+
+	mappedStore.setFrame(width, height, left(0), right(0));
+	mappedStore.attachSlots(slots.data(), imageSize * 2);
+
+	auto setMappedFrame = [&](const uint8_t* frameLeft, const uint8_t* frameRight) {
+		mappedStore.setFrame(width, height, frameLeft, frameRight);
+
+		if (uploadingSlot >= 0) {
+			mappedStore.releaseSlot(uploadingSlot);
+		}
+
+		uploadingSlot = mappedStore.takeFrame();
+	};
+
+	results.push_back(measure("set_frame_mapped", resolution, imageSize * 2, iterations, [&](uint64_t i) {
+		setMappedFrame(left(i), right(i));
+	}));
+
+	results.push_back(measure("set_frame_mapped_mono", resolution, imageSize, iterations, [&](uint64_t i) {
+		setMappedFrame(left(i), nullptr);
+	}));
+
+	LOG_INFO("Benchmark {}x{}: stereo set_frame_mapped takes {} times as long as mono", width, height,
+		results[results.size() - 2].nsPerFrame / results.back().nsPerFrame);
+
+	// every frame switches between the full and half height, which is the worst case for the buffer reallocation
+	results.push_back(measure("set_frame_resize", resolution, imageSize, iterations, [&](uint64_t i) {
+		frameStore.setFrame(width, (i % 2 == 0) ? height : height / 2, left(i), right(i));
+	}));
+
+	std::vector<float> distortionMap(k_distortionMapSize * 2, 0.5f);
+	results.push_back(measure("distortion_map", resolution, distortionMap.size() * sizeof(float), iterations, [&](uint64_t i) {
+		frameStore.setDistortionMap(static_cast<int>(i % 2), distortionMap.data());
+	}));
+
+	// how fast frames get to the file, the writer waits for a free record instead of dropping frames so that every one is written.
+	// The Leap polling thread only pays for the copy into the record, about what set_frame costs
+	std::string sessionPath = (std::filesystem::temp_directory_path() / ("benchmark" + std::string(k_sessionExtension))).string();
+	SessionWriter sessionWriter;
+
+	if (sessionWriter.open(sessionPath, width, height)) {
+		results.push_back(measure("session_write", resolution, imageSize * 2, iterations, [&](uint64_t i) {
+			ImageFrame frame;
+			frame.frameId = static_cast<int64_t>(i);
+			frame.timestamp = static_cast<int64_t>(i) * k_benchmarkFrameInterval;
+			frame.width = width;
+			frame.height = height;
+			frame.left = left(i);
+			frame.right = right(i);
+
+			sessionWriter.writeFrame(frame);
+		}));
+
+		sessionWriter.close();
+		std::filesystem::remove(sessionPath);
+	}
+
+	// one span as TRACE_SCOPE records it in builds with ENABLE_TRACING, two clock reads and a store into the thread's ring
+	const uint32_t spanName = Tracer::getInstance()->registerName("Benchmark span");
+	results.push_back(measure("trace_span", resolution, 0, iterations * 10, [&](uint64_t) {
+		TraceScope scope(spanName);
+	}));
+
+	// stays below the ring capacity so that nothing is dropped while the logger thread catches up
+	results.push_back(measure("log_record", resolution, 0, LogRing::k_capacity / 4, [&](uint64_t i) {
+		Logger::log(LogLevel_Debug, "Benchmark frame {} of {}x{} at {}", i, width, height, i * 0.5);
+	}));
+}
+
+// A still hand in the middle of the view at a few distances, the generator shifts it by the disparity in the right camera.
+// Only blocks on the edge of the hand have texture the matcher can lock on to, the inside of the hand and the background
+// are flat apart from noise that differs between the cameras, and should come out invalid.
+void measureStereoAccuracy(const BenchmarkResolution& resolution, std::vector<AccuracyResult>& accuracy) {
+	const uint32_t seeds = 16;
+	const int scale = 1 << k_stereoPyramidLevel;
+
+	StereoMatcher* stereoMatcher = StereoMatcher::getInstance();
+	PyramidPool pool;
+	DepthMap depthMap;
+
+	for (int disparity : { 8, 32, 64 }) { // full resolution pixels, the default and two hands closer to the sensor
+		uint32_t handCells = 0;
+		uint32_t validHandCells = 0;
+		uint32_t correctCells = 0;
+		uint32_t validBackgroundCells = 0;
+
+		for (uint32_t seed = 1; seed <= seeds; seed++) {
+			FrameGeneratorConfig config;
+			config.width = resolution.width;
+			config.height = resolution.height;
+			config.seed = seed;
+			config.disparity = disparity;
+			config.swipes.resize(1);
+			config.swipes[0].direction = SwipeDirection_FromLeft;
+			config.swipes[0].duration = 2 * static_cast<int64_t>(1e6f / config.frameRate); // frame 1 is half way, in the middle of the view
+
+			FrameGenerator generator(config);
+			generator.generate(1);
+
+			std::shared_ptr<const ImagePyramid> pyramid = pool.build(seed, config.width, config.height, generator.getImage(0), generator.getImage(1));
+			stereoMatcher->compute(*pyramid);
+			stereoMatcher->getDepthMap(depthMap);
+
+			// a block sees the hand if any of its pixels is brighter than the background and its noise could make it
+			PyramidLevel left = pyramid->getLevel(0, k_stereoPyramidLevel);
+			int threshold = (config.ambient + config.noise + config.handBrightness) / 2;
+
+			for (int row = 0; row < depthMap.height; row++) {
+				for (int cell = 0; cell < depthMap.width; cell++) {
+					bool hand = false;
+
+					for (int y = row * k_stereoCellSize; y < row * k_stereoCellSize + k_stereoBlockHeight && !hand; y++) {
+						const uint8_t* pixels = left.data + y * left.width + cell * k_stereoCellSize;
+						for (int x = 0; x < k_stereoBlockWidth && !hand; x++) {
+							hand = pixels[x] > threshold;
+						}
+					}
+
+					uint8_t value = depthMap.disparity[row * depthMap.width + cell];
+
+					if (hand) {
+						handCells++;
+						if (value != k_invalidDisparity) {
+							validHandCells++;
+							correctCells += (std::abs(value - disparity / scale) <= 1) ? 1 : 0;
+						}
+					} else if (value != k_invalidDisparity) {
+						validBackgroundCells++;
+					}
+				}
+			}
+		}
+
+		std::string name = "stereo_matcher_disparity_" + std::to_string(disparity);
+		uint32_t validCells = validHandCells + validBackgroundCells;
+
+		reportAccuracy(accuracy, name.c_str(), resolution, "hand_cells_valid", handCells > 0 ? static_cast<double>(validHandCells) / handCells : 0.0);
+		reportAccuracy(accuracy, name.c_str(), resolution, "valid_cells_correct", validCells > 0 ? static_cast<double>(correctCells) / validCells : 0.0);
+		reportAccuracy(accuracy, name.c_str(), resolution, "valid_cells_background", validCells > 0 ? static_cast<double>(validBackgroundCells) / validCells : 0.0);
+	}
+}
+
+enum SwipeCandidate {
+	SwipeCandidate_BackgroundModel, // the foreground source of the SwipePipeline
+	SwipeCandidate_BrightUpperPixels, // the detector the BackgroundModel replaced, without directions
+	SwipeCandidate_Motion, // the motion source of the SwipePipeline, the default
+	SwipeCandidate_Tracking, // the TrackingDetector on the palm the generator reports, without the live extrapolation
+	SwipeCandidate_Count,
+};
+
+const char* k_swipeCandidateNames[SwipeCandidate_Count] = { "swipe_background_model", "swipe_bright_upper_pixels", "swipe_motion_detector", "swipe_tracking" };
+
+// how much brighter the scene is at a time: the light comes on every odd second and goes off every even one, either at
+// once like a lamp being switched or fading over lightRamp microseconds like the auto exposure settling
+int lightOffset(int64_t timestamp, int lightStep, int64_t lightRamp) {
+	int64_t sinceOn = timestamp % 2000000 - 1000000;
+	int64_t sinceOff = timestamp % 2000000;
+	double level;
+
+	if (sinceOn >= 0) {
+		level = (lightRamp > 0) ? (std::min)(1.0, static_cast<double>(sinceOn) / lightRamp) : 1.0;
+	} else if (timestamp >= 2000000 && lightRamp > 0) {
+		level = (std::max)(0.0, 1.0 - static_cast<double>(sinceOff) / lightRamp);
+	} else {
+		level = 0.0;
+	}
+
+	return static_cast<int>(std::lround(level * lightStep));
+}
+
+// Runs every candidate over one generated session with the cooldown LeapHandler applies, with the lighting changing
+// as lightOffset() describes when lightStep isn't 0.
+void detectSwipes(const FrameGeneratorConfig& config, int64_t duration, int lightStep, int64_t lightRamp, std::vector<Detection> (&detections)[SwipeCandidate_Count]) {
+	PyramidPool pool; // before the pipelines, the MotionDetector holds on to the previous pyramid until it is destroyed
+
+	SwipePipeline pipeline;
+	pipeline.setFrameRate(config.frameRate);
+
+	SwipePipeline motionPipeline; // a pipeline starts over when the source changes, so each source gets its own
+	motionPipeline.setFrameRate(config.frameRate);
+
+	BrightUpperPixels brightUpperPixels;
+	TrackingDetector trackingDetector;
+
+	FrameGenerator generator(config);
+
+	size_t imageSize = static_cast<size_t>(config.width) * config.height;
+	std::vector<uint8_t> litImages(imageSize * 2);
+	int64_t lastSwipeTimes[SwipeCandidate_Count];
+	std::fill(std::begin(lastSwipeTimes), std::end(lastSwipeTimes), -k_swipeCooldown);
+
+	int64_t frameCount = static_cast<int64_t>(duration * config.frameRate / 1e6);
+
+	for (int64_t f = 0; f < frameCount; f++) {
+		const FrameLabel& label = generator.generate(f);
+		const uint8_t* images = generator.getImage(0);
+
+		int light = lightOffset(label.timestamp, lightStep, lightRamp);
+
+		if (light > 0) {
+			for (size_t i = 0; i < litImages.size(); i++) {
+				litImages[i] = static_cast<uint8_t>((std::min)(images[i] + light, 255));
+			}
+			images = litImages.data();
+		}
+
+		std::shared_ptr<const ImagePyramid> pyramid = pool.build(f, config.width, config.height, images, images + imageSize);
+
+		SwipeDirection directions[SwipeCandidate_Count];
+		directions[SwipeCandidate_BackgroundModel] = pipeline.processFrame(pyramid, SwipeSource_Foreground, label.timestamp);
+
+		// scoreDetections matches a swipe without a direction against a pass in any direction
+		bool brightSwipe = brightUpperPixels.processFrame(config.width, config.height, images);
+		directions[SwipeCandidate_BrightUpperPixels] = SwipeDirection_None;
+
+		directions[SwipeCandidate_Motion] = motionPipeline.processFrame(pyramid, SwipeSource_Motion, label.timestamp);
+		directions[SwipeCandidate_Tracking] = trackingDetector.processFrame(generator.getTrackingFrame());
+
+		for (int c = 0; c < SwipeCandidate_Count; c++) {
+			bool detected = (c == SwipeCandidate_BrightUpperPixels) ? brightSwipe : directions[c] != SwipeDirection_None;
+
+			if (detected && label.timestamp - lastSwipeTimes[c] >= k_swipeCooldown) {
+				lastSwipeTimes[c] = label.timestamp;
+				detections[c].push_back({ label.timestamp, directions[c] });
+			}
+		}
+	}
+}
+
+// runs every candidate over the sessions generateSessions writes, with the hand scaled to handSize when that isn't 0
+void scoreSwipeSessions(int sessionCount, float handSize, EvaluationCounts (&counts)[SwipeCandidate_Count]) {
+	for (int session = 0; session < sessionCount; session++) {
+		FrameGeneratorConfig config = makeGeneratedSessionConfig(session);
+
+		if (handSize > 0.0f) {
+			config.handSize = handSize;
+		}
+
+		std::vector<Detection> detections[SwipeCandidate_Count];
+		detectSwipes(config, config.swipes.back().startTime + config.swipes.back().duration + 1000000, 0, 0, detections);
+
+		std::vector<SessionLabel> labels = makeGeneratedSessionLabels(config);
+		for (int c = 0; c < SwipeCandidate_Count; c++) {
+			scoreDetections(detections[c], labels, counts[c]);
+		}
+	}
+}
+
+void reportSwipeCounts(std::vector<AccuracyResult>& accuracy, const BenchmarkResolution& resolution, const char* prefix, const EvaluationCounts (&counts)[SwipeCandidate_Count]) {
+	for (int c = 0; c < SwipeCandidate_Count; c++) {
+		const EvaluationCounts& count = counts[c];
+		uint64_t detected = count.truePositives + count.falsePositives;
+		uint64_t expected = count.truePositives + count.falseNegatives;
+
+		reportAccuracy(accuracy, k_swipeCandidateNames[c], resolution, (std::string(prefix) + "swipes").c_str(), static_cast<double>(detected));
+		reportAccuracy(accuracy, k_swipeCandidateNames[c], resolution, (std::string(prefix) + "precision").c_str(), (detected > 0) ? static_cast<double>(count.truePositives) / detected : 0.0);
+		reportAccuracy(accuracy, k_swipeCandidateNames[c], resolution, (std::string(prefix) + "recall").c_str(), (expected > 0) ? static_cast<double>(count.truePositives) / expected : 0.0);
+		reportAccuracy(accuracy, k_swipeCandidateNames[c], resolution, (std::string(prefix) + "mean_latency_ms").c_str(), (count.truePositives > 0) ? count.latencySum / 1000.0 / count.truePositives : 0.0);
+	}
+}
+
+// Precision, recall and latency on the sessions generateSessions writes, and false swipes in an empty scene whose
+// lighting changes. The detector the BackgroundModel replaced needs 30000 bright pixels in the upper half of the image,
+// which the generated hand never covers, so every candidate also runs on the same sessions with a hand close to the
+// cameras (close_hand_*). A light that comes on at once only changes its count in one frame, one that fades in takes
+// it through the threshold over several (light_ramp_swipes).
+void measureSwipeAccuracy(std::vector<AccuracyResult>& accuracy) {
+	const int sessionCount = 6; // two of each frame rate
+	const float closeHandSize = 0.6f;
+	const int lightStep = 60;
+	const int64_t lightRamp = 300000;
+	const int64_t lightDuration = 20000000;
+
+	FrameGeneratorConfig sessionConfig = makeGeneratedSessionConfig(0);
+	BenchmarkResolution resolution { sessionConfig.width, sessionConfig.height };
+
+	EvaluationCounts counts[SwipeCandidate_Count];
+	scoreSwipeSessions(sessionCount, 0.0f, counts);
+	reportSwipeCounts(accuracy, resolution, "", counts);
+
+	EvaluationCounts closeHandCounts[SwipeCandidate_Count];
+	scoreSwipeSessions(sessionCount, closeHandSize, closeHandCounts);
+	reportSwipeCounts(accuracy, resolution, "close_hand_", closeHandCounts);
+
+	FrameGeneratorConfig lightConfig = makeGeneratedSessionConfig(1);
+	lightConfig.swipes.clear();
+
+	std::vector<Detection> lightDetections[SwipeCandidate_Count];
+	detectSwipes(lightConfig, lightDuration, lightStep, 0, lightDetections);
+
+	std::vector<Detection> rampDetections[SwipeCandidate_Count];
+	detectSwipes(lightConfig, lightDuration, lightStep, lightRamp, rampDetections);
+
+	for (int c = 0; c < SwipeCandidate_Count; c++) {
+		reportAccuracy(accuracy, k_swipeCandidateNames[c], resolution, "light_change_swipes", static_cast<double>(lightDetections[c].size()));
+		reportAccuracy(accuracy, k_swipeCandidateNames[c], resolution, "light_ramp_swipes", static_cast<double>(rampDetections[c].size()));
+	}
+}
+
+// The blob of every frame of the generated sessions against the hand the generator drew. The ground truth are the pixels
+// of the full resolution left image that are brighter than the background and its noise can make it, their centroid and box.
+void measureTrackingAccuracy(std::vector<AccuracyResult>& accuracy) {
+	const int sessionCount = 6;
+
+	uint64_t handFrames = 0;
+	uint64_t foundFrames = 0;
+	uint64_t emptyFrames = 0;
+	uint64_t falseFrames = 0;
+	double centroidError = 0.0; // full resolution pixels
+	double boxError = 0.0; // mean distance of the four box edges from the hand's, full resolution pixels
+	BenchmarkResolution resolution {};
+
+	for (int session = 0; session < sessionCount; session++) {
+		FrameGeneratorConfig config = makeGeneratedSessionConfig(session);
+		resolution = { config.width, config.height };
+
+		FrameGenerator generator(config);
+		PyramidPool pool;
+		BlobTracker blobTracker;
+
+		int threshold = (config.ambient + config.noise + config.handBrightness) / 2;
+		const GeneratedSwipe& last = config.swipes.back();
+		int64_t frameCount = static_cast<int64_t>((last.startTime + last.duration + 1000000) * config.frameRate / 1e6);
+
+		for (int64_t f = 0; f < frameCount; f++) {
+			generator.generate(f);
+			std::shared_ptr<const ImagePyramid> pyramid = pool.build(f, config.width, config.height, generator.getImage(0), generator.getImage(1));
+			HandBlob blob = blobTracker.processFrame(pyramid->getLevel(0, k_blobPyramidLevel));
+
+			const uint8_t* image = generator.getImage(0);
+			uint64_t area = 0, sumX = 0, sumY = 0;
+			int minX = config.width, minY = config.height, maxX = -1, maxY = -1;
+
+			for (int y = 0; y < config.height; y++) {
+				for (int x = 0; x < config.width; x++) {
+					if (image[y * config.width + x] <= threshold) continue;
+
+					area++;
+					sumX += x;
+					sumY += y;
+					minX = (std::min)(minX, x);
+					minY = (std::min)(minY, y);
+					maxX = (std::max)(maxX, x);
+					maxY = (std::max)(maxY, y);
+				}
+			}
+
+			if (area == 0) {
+				emptyFrames++;
+				falseFrames += blob.found ? 1 : 0;
+				continue;
+			}
+
+			handFrames++;
+			if (!blob.found) continue;
+
+			foundFrames++;
+
+			// pixel centers, the blob's coordinates are normalized to the image size
+			double centroidX = (sumX + 0.5 * area) / area;
+			double centroidY = (sumY + 0.5 * area) / area;
+			centroidError += std::hypot(blob.centroidX * config.width - centroidX, blob.centroidY * config.height - centroidY);
+
+			boxError += (std::abs(blob.minX * config.width - minX) + std::abs(blob.maxX * config.width - (maxX + 1)) +
+				std::abs(blob.minY * config.height - minY) + std::abs(blob.maxY * config.height - (maxY + 1))) / 4.0;
+		}
+	}
+
+	reportAccuracy(accuracy, "blob_tracker", resolution, "hand_frames_found", (handFrames > 0) ? static_cast<double>(foundFrames) / handFrames : 0.0);
+	reportAccuracy(accuracy, "blob_tracker", resolution, "empty_frames_found", (emptyFrames > 0) ? static_cast<double>(falseFrames) / emptyFrames : 0.0);
+	reportAccuracy(accuracy, "blob_tracker", resolution, "centroid_error_px", (foundFrames > 0) ? centroidError / foundFrames : 0.0);
+	reportAccuracy(accuracy, "blob_tracker", resolution, "box_edge_error_px", (foundFrames > 0) ? boxError / foundFrames : 0.0);
+}
+
+int runBenchmarks(const char* outputPath) {
+	std::vector<BenchmarkResult> results;
+	std::vector<AccuracyResult> accuracy;
+
+	for (const BenchmarkResolution& resolution : k_benchmarkResolutions) {
+		benchmarkResolution(resolution, results);
+		measureStereoAccuracy(resolution, accuracy);
+	}
+
+	measureSwipeAccuracy(accuracy);
+	measureTrackingAccuracy(accuracy);
+
+	FILE* file = nullptr;
+	if (fopen_s(&file, outputPath, "w") != 0 || file == nullptr) {
+		LOG_ERROR("Could not write benchmark results to {}", outputPath);
+		return 1;
+	}
+
+	fprintf(file, "{\n\t\"benchmarks\": [\n");
+
+	for (size_t i = 0; i < results.size(); i++) {
+		const BenchmarkResult& result = results[i];
+
+		fprintf(file, "\t\t{ \"name\": \"%s\", \"width\": %d, \"height\": %d, \"iterations\": %llu, \"ns_per_frame\": %.1f, \"bytes_per_cycle\": %.3f, \"allocations_per_frame\": %.3f }%s\n",
+			result.name.c_str(), result.width, result.height, static_cast<unsigned long long>(result.iterations),
+			result.nsPerFrame, result.bytesPerCycle, result.allocationsPerFrame, (i + 1 < results.size()) ? "," : "");
+	}
+
+	fprintf(file, "\t],\n\t\"accuracy\": [\n");
+
+	for (size_t i = 0; i < accuracy.size(); i++) {
+		const AccuracyResult& result = accuracy[i];
+
+		fprintf(file, "\t\t{ \"name\": \"%s\", \"width\": %d, \"height\": %d, \"metric\": \"%s\", \"value\": %.4f }%s\n",
+			result.name.c_str(), result.width, result.height, result.metric.c_str(), result.value, (i + 1 < accuracy.size()) ? "," : "");
+	}
+
+	fprintf(file, "\t]\n}\n");
+	fclose(file);
+
+	LOG_INFO("Benchmark results written to {}", outputPath);
+	return 0;
+}
+
+// Benchmark [file] [--log file], the results go to benchmark.json by default and a summary to stderr
+int main(int argc, char** argv) {
+	const char* outputPath = "benchmark.json";
+	const char* logPath = nullptr;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--log") == 0 && i + 1 < argc) {
+			logPath = argv[++i];
+		} else {
+			outputPath = argv[i];
+		}
+	}
+
+	if (logPath != nullptr) {
+		Logger::getInstance()->addSink(std::make_unique<FileSink>(logPath));
+	} else {
+		Logger::getInstance()->addSink(std::make_unique<SummarySink>());
+	}
+
+	int result = runBenchmarks(outputPath);
+	Logger::getInstance()->shutdown();
+
+	return result;
+}
@@ -0,0 +1,131 @@
+#include "BackgroundModel.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define BACKGROUND_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+// background pixels follow the scene quickly (1/16 per frame), foreground pixels only very slowly (1/256 per frame)
+// so that a permanent change like a light being switched on still ends up in the model after a few seconds
+const int k_backgroundShift = 4;
+const int k_foregroundShift = 8;
+
+// a pixel is foreground if it differs from the model by more than this, or by a quarter of the background brightness in bright scenes
+const int k_minContrast = 24;
+
+void BackgroundModel::processFrame(const PyramidLevel& level)
+{
+	TRACE_SCOPE("BackgroundModel::processFrame");
+
+	if (level.width != m_width || level.height != m_height) {
+		m_width = level.width;
+		m_height = level.height;
+
+		m_background.assign(m_width * m_height, 0);
+		m_foreground.assign(m_width * m_height, 0);
+		m_initialized = false;
+	}
+
+	m_current = level.data;
+
+	if (!m_initialized) {
+		for (size_t i = 0; i < m_background.size(); i++) {
+			m_background[i] = m_current[i] << 8;
+		}
+
+		m_initialized = true;
+	}
+
+	update();
+}
+
+void BackgroundModel::reset()
+{
+	m_initialized = false;
+}
+
+const uint8_t* BackgroundModel::getForegroundMask()
+{
+	return m_foreground.data();
+}
+
+int BackgroundModel::getWidth()
+{
+	return m_width;
+}
+
+int BackgroundModel::getHeight()
+{
+	return m_height;
+}
+
+int BackgroundModel::globalShift()
+{
+	uint32_t histogram[511] = { 0 };
+
+	for (size_t i = 0; i < m_background.size(); i++) {
+		histogram[m_current[i] - (m_background[i] >> 8) + 255]++;
+	}
+
+	uint32_t seen = 0;
+
+	for (int i = 0; i < 511; i++) {
+		seen += histogram[i];
+
+		if (seen * 4 >= m_background.size()) {
+			return i - 255;
+		}
+	}
+
+	return 0;
+}
+
+void BackgroundModel::update()
+{
+	// the scene as a whole getting brighter or darker (auto exposure, lights) shifts every pixel by about the same amount.
+	// the hand is lit by the sensor's LEDs and ends up in the upper part of the distribution, so the lower quartile
+	// of the differences only follows the scene until the hand covers three quarters of the view
+	int offset = globalShift();
+
+	size_t count = m_background.size();
+	size_t i = 0;
+
+#ifdef BACKGROUND_USE_SSE2
+	const __m128i minContrast = _mm_set1_epi16(k_minContrast);
+	const __m128i offsetVector = _mm_set1_epi16(static_cast<short>(offset));
+
+	for (; i + 8 <= count; i += 8) {
+		__m128i current = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(m_current + i)), _mm_setzero_si128());
+		__m128i background = _mm_loadu_si128((const __m128i*)(m_background.data() + i));
+		__m128i backgroundInt = _mm_srli_epi16(background, 8);
+
+		__m128i adjusted = _mm_sub_epi16(current, offsetVector);
+		__m128i difference = _mm_max_epi16(_mm_sub_epi16(adjusted, backgroundInt), _mm_sub_epi16(backgroundInt, adjusted));
+		__m128i margin = _mm_max_epi16(minContrast, _mm_srli_epi16(backgroundInt, 2));
+		__m128i foreground = _mm_cmpgt_epi16(difference, margin);
+
+		// bg += (current - bg) * 2^-shift, rearranged so that every intermediate stays within unsigned 16 bit
+		__m128i fast = _mm_add_epi16(_mm_sub_epi16(background, _mm_srli_epi16(background, k_backgroundShift)), _mm_slli_epi16(current, 8 - k_backgroundShift));
+		__m128i slow = _mm_add_epi16(_mm_sub_epi16(background, _mm_srli_epi16(background, k_foregroundShift)), _mm_slli_epi16(current, 8 - k_foregroundShift));
+
+		_mm_storeu_si128((__m128i*)(m_background.data() + i), _mm_or_si128(_mm_and_si128(foreground, slow), _mm_andnot_si128(foreground, fast)));
+		_mm_storel_epi64((__m128i*)(m_foreground.data() + i), _mm_packs_epi16(foreground, foreground));
+	}
+#endif
+
+	for (; i < count; i++) {
+		int current = m_current[i];
+		int background = m_background[i];
+		int backgroundInt = background >> 8;
+
+		bool foreground = std::abs(current - offset - backgroundInt) > (std::max)(k_minContrast, backgroundInt >> 2);
+		int shift = foreground ? k_foregroundShift : k_backgroundShift;
+
+		m_background[i] = static_cast<uint16_t>(background - (background >> shift) + (current << (8 - shift)));
+		m_foreground[i] = foreground ? 255 : 0;
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "ImagePyramid.h"
+
+const int k_backgroundPyramidLevel = 3; // the model runs on 1/8 of the camera resolution in both directions
+
+// Running average of the static scene, kept in 8.8 fixed point at reduced resolution.
+// Every frame is compared against the model and turned into a foreground mask (0 or 255 per pixel),
+// so that detectors see a hand instead of whatever happens to be bright in the room.
+class BackgroundModel
+{
+public:
+	void processFrame(const PyramidLevel& level);
+	void reset();
+
+	const uint8_t* getForegroundMask();
+	int getWidth();
+	int getHeight();
+
+private:
+	int globalShift();
+	void update();
+
+	int m_width { 0 };
+	int m_height { 0 };
+	bool m_initialized { false };
+
+	const uint8_t* m_current { nullptr };
+	std::vector<uint16_t> m_background; // 8.8 fixed point
+	std::vector<uint8_t> m_foreground;
+};
@@ -0,0 +1,185 @@
+#include "BlobTracker.h"
+#include "Trace.h"
+
+#include <algorithm>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define BLOB_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+const uint8_t k_blobThreshold = 100;
+const float k_minHandArea = 0.02f; // smaller blobs are reflections and noise
+
+HandBlob BlobTracker::processFrame(const PyramidLevel& level)
+{
+	TRACE_SCOPE("BlobTracker::processFrame");
+
+	if (level.width != m_width || level.height != m_height) {
+		m_width = level.width;
+		m_height = level.height;
+
+		// worst case is alternating bright and dark pixels
+		size_t maxRuns = static_cast<size_t>(m_height) * ((m_width + 1) / 2);
+		m_runs.resize(maxRuns);
+		m_parents.resize(maxRuns);
+		m_stats.resize(maxRuns);
+		m_allocationCount++;
+	}
+
+	m_runCount = 0;
+	uint32_t previousRowStart = 0;
+
+	for (int y = 0; y < m_height; y++) {
+		uint32_t rowStart = m_runCount;
+		encodeRow(level.data + y * m_width, y, m_width);
+
+		// join runs that touch a run of the row above, including diagonally
+		uint32_t i = previousRowStart;
+		uint32_t j = rowStart;
+
+		while (y > 0 && i < rowStart && j < m_runCount) {
+			const Run& above = m_runs[i];
+			const Run& current = m_runs[j];
+
+			if (above.end + 1 < current.start) {
+				i++;
+			} else if (current.end + 1 < above.start) {
+				j++;
+			} else {
+				unite(i, j);
+
+				if (above.end < current.end) {
+					i++;
+				} else {
+					j++;
+				}
+			}
+		}
+
+		previousRowStart = rowStart;
+	}
+
+	for (uint32_t i = 0; i < m_runCount; i++) {
+		m_stats[i] = { 0, 0, 0, INT16_MAX, INT16_MAX, INT16_MIN, INT16_MIN };
+	}
+
+	uint32_t largest = UINT32_MAX;
+
+	for (uint32_t i = 0; i < m_runCount; i++) {
+		const Run& run = m_runs[i];
+		uint32_t root = findRoot(i);
+		BlobStats& stats = m_stats[root];
+
+		uint32_t length = run.end - run.start + 1;
+		stats.area += length;
+		stats.sumX += static_cast<uint64_t>(run.start + run.end) * length / 2;
+		stats.sumY += static_cast<uint64_t>(run.y) * length;
+		stats.minX = (std::min)(stats.minX, run.start);
+		stats.maxX = (std::max)(stats.maxX, run.end);
+		stats.minY = (std::min)(stats.minY, run.y);
+		stats.maxY = (std::max)(stats.maxY, run.y);
+
+		if (largest == UINT32_MAX || stats.area > m_stats[largest].area) {
+			largest = root;
+		}
+	}
+
+	HandBlob result;
+
+	if (largest == UINT32_MAX) {
+		return result;
+	}
+
+	const BlobStats& stats = m_stats[largest];
+	float width = static_cast<float>(m_width);
+	float height = static_cast<float>(m_height);
+
+	result.area = stats.area / (width * height);
+	result.found = result.area >= k_minHandArea;
+	result.centroidX = (static_cast<float>(stats.sumX) / stats.area + 0.5f) / width;
+	result.centroidY = (static_cast<float>(stats.sumY) / stats.area + 0.5f) / height;
+	result.minX = stats.minX / width;
+	result.minY = stats.minY / height;
+	result.maxX = (stats.maxX + 1) / width;
+	result.maxY = (stats.maxY + 1) / height;
+
+	return result;
+}
+
+uint32_t BlobTracker::getAllocationCount()
+{
+	return m_allocationCount;
+}
+
+void BlobTracker::encodeRow(const uint8_t* row, int y, int width)
+{
+	int runStart = -1;
+	int x = 0;
+
+	auto closeRun = [&](int end) {
+		m_runs[m_runCount] = { static_cast<int16_t>(y), static_cast<int16_t>(runStart), static_cast<int16_t>(end) };
+		m_parents[m_runCount] = m_runCount;
+		m_runCount++;
+		runStart = -1;
+	};
+
+#ifdef BLOB_USE_SSE2
+	const __m128i threshold = _mm_set1_epi8(static_cast<char>(k_blobThreshold));
+#endif
+
+	while (x < width) {
+#ifdef BLOB_USE_SSE2
+		// skip 16 pixels at once as long as they don't end or start a run
+		if (x + 16 <= width) {
+			__m128i pixels = _mm_loadu_si128((const __m128i*)(row + x));
+			int bright = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(pixels, threshold), pixels));
+
+			if ((runStart < 0 && bright == 0) || (runStart >= 0 && bright == 0xFFFF)) {
+				x += 16;
+				continue;
+			}
+		}
+#endif
+
+		bool isBright = row[x] >= k_blobThreshold;
+
+		if (isBright && runStart < 0) {
+			runStart = x;
+		} else if (!isBright && runStart >= 0) {
+			closeRun(x - 1);
+		}
+
+		x++;
+	}
+
+	if (runStart >= 0) {
+		closeRun(width - 1);
+	}
+}
+
+uint32_t BlobTracker::findRoot(uint32_t run)
+{
+	// path halving
+	while (m_parents[run] != run) {
+		m_parents[run] = m_parents[m_parents[run]];
+		run = m_parents[run];
+	}
+
+	return run;
+}
+
+void BlobTracker::unite(uint32_t a, uint32_t b)
+{
+	uint32_t rootA = findRoot(a);
+	uint32_t rootB = findRoot(b);
+
+	if (rootA == rootB) return;
+
+	// keep the older run as root so that roots always point backwards
+	if (rootA < rootB) {
+		m_parents[rootB] = rootA;
+	} else {
+		m_parents[rootA] = rootB;
+	}
+}
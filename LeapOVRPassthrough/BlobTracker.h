@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "ImagePyramid.h"
+
+const int k_blobPyramidLevel = 2; // 1/4 scale is plenty to find a hand
+
+// largest bright blob of a frame, coordinates are normalized to [0, 1] in the camera image
+struct HandBlob {
+	bool found { false };
+	float centroidX { 0.0f };
+	float centroidY { 0.0f };
+	float minX { 0.0f };
+	float minY { 0.0f };
+	float maxX { 0.0f };
+	float maxY { 0.0f };
+	float area { 0.0f }; // fraction of the image
+};
+
+// Finds the hand as the largest connected bright area.
+// Rows are run-length encoded and the runs are joined with union-find, so the work is proportional to the number of runs
+// instead of the number of pixels. All scratch storage is only reallocated when the image size changes.
+class BlobTracker
+{
+public:
+	HandBlob processFrame(const PyramidLevel& level);
+	uint32_t getAllocationCount();
+
+private:
+	struct Run {
+		int16_t y;
+		int16_t start;
+		int16_t end; // inclusive
+	};
+
+	struct BlobStats {
+		uint32_t area;
+		uint64_t sumX;
+		uint64_t sumY;
+		int16_t minX, minY, maxX, maxY;
+	};
+
+	void encodeRow(const uint8_t* row, int y, int width);
+	uint32_t findRoot(uint32_t run);
+	void unite(uint32_t a, uint32_t b);
+
+	int m_width { 0 };
+	int m_height { 0 };
+	uint32_t m_allocationCount { 0 };
+
+	std::vector<Run> m_runs;
+	uint32_t m_runCount { 0 };
+	std::vector<uint32_t> m_parents;
+	std::vector<BlobStats> m_stats;
+};
@@ -0,0 +1,77 @@
+#include "Clock.h"
+#include "utils.h"
+
+#include <thread>
+
+#ifdef _WIN32
+// a high resolution timer lets us wake up with sub-millisecond precision, the default sleep granularity is way too coarse.
+// there is one per thread since a timer can only be waited on by one thread at a time
+struct PacingTimer {
+	HANDLE handle;
+
+	PacingTimer() {
+		handle = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	}
+
+	~PacingTimer() {
+		if (handle != NULL) {
+			CloseHandle(handle);
+		}
+	}
+};
+#endif
+
+SteadyClock* s_steadyClock = nullptr;
+
+SteadyClock* SteadyClock::getInstance()
+{
+	if (s_steadyClock == nullptr) {
+		s_steadyClock = new SteadyClock();
+	}
+
+	return s_steadyClock;
+}
+
+int64_t SteadyClock::now()
+{
+	return getHostTimeMicroseconds();
+}
+
+void SteadyClock::sleepUntil(int64_t time)
+{
+	int64_t wait = time - now();
+
+	if (wait <= 0) return;
+
+#ifdef _WIN32
+	thread_local PacingTimer timer;
+
+	if (timer.handle != NULL) {
+		LARGE_INTEGER dueTime;
+		dueTime.QuadPart = -wait * 10; // relative time in 100ns units
+
+		if (SetWaitableTimer(timer.handle, &dueTime, 0, NULL, NULL, FALSE)) {
+			WaitForSingleObject(timer.handle, INFINITE);
+			return;
+		}
+	}
+#endif
+
+	std::this_thread::sleep_for(std::chrono::microseconds(wait));
+}
+
+VirtualClock::VirtualClock(int64_t start) :
+	m_now(start)
+{ }
+
+int64_t VirtualClock::now()
+{
+	return m_now.load();
+}
+
+void VirtualClock::sleepUntil(int64_t time)
+{
+	int64_t current = m_now.load();
+
+	while (time > current && !m_now.compare_exchange_weak(current, time)) {}
+}
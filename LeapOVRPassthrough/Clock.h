@@ -0,0 +1,41 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Where the pipeline takes "now" from and how it waits. Live it runs on the SteadyClock, the host clock of
+// getHostTimeMicroseconds. A replay runs on a VirtualClock that only moves forward when it is told to, so that a
+// recording goes through all of the logic as fast as the CPU allows and takes the same decisions every time.
+class Clock
+{
+public:
+	virtual ~Clock() {}
+
+	virtual int64_t now() = 0; // microseconds
+	virtual void sleepUntil(int64_t time) = 0;
+
+	void sleepFor(int64_t microseconds) {
+		sleepUntil(now() + microseconds);
+	}
+};
+
+class SteadyClock : public Clock
+{
+public:
+	static SteadyClock* getInstance();
+
+	int64_t now() override;
+	void sleepUntil(int64_t time) override;
+};
+
+// sleeping returns right away with the time moved forward, the time never goes backwards
+class VirtualClock : public Clock
+{
+public:
+	VirtualClock(int64_t start);
+
+	int64_t now() override;
+	void sleepUntil(int64_t time) override;
+
+private:
+	std::atomic<int64_t> m_now;
+};
@@ -0,0 +1,111 @@
+#include "ConnectionMonitor.h"
+#include "Clock.h"
+#include "Log.h"
+#include "utils.h"
+
+#include <algorithm>
+
+const char* k_connectionStateNames[] = { "disconnected", "connecting", "connected" };
+
+ConnectionMonitor::ConnectionMonitor(const std::string& name, int64_t initialDelay, int64_t maxDelay) :
+	m_name(name),
+	m_initialDelay(initialDelay),
+	m_maxDelay(maxDelay),
+	m_clock(SteadyClock::getInstance()),
+	m_delay(initialDelay)
+{
+}
+
+void ConnectionMonitor::setClock(Clock* clock)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_clock = clock;
+}
+
+void ConnectionMonitor::setState(ConnectionState state, const char* reason)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (state == m_state) return;
+
+	LOG_INFO("{} {} ({})", m_name, k_connectionStateNames[state], reason);
+
+	int64_t now = m_clock->now();
+
+	if (m_state == ConnectionState_Connected) {
+		if (now - m_connectedTime >= m_maxDelay) {
+			m_delay = m_initialDelay;
+		}
+
+		m_outageStartTime = now;
+		m_outageStartCpuTime = getProcessCpuMicroseconds();
+		m_stats.outages++;
+	}
+
+	if (state == ConnectionState_Connected) {
+		m_connectedTime = now;
+
+		if (m_everConnected) {
+			int64_t recoveryTime = now - m_outageStartTime;
+			int64_t cpuTime = getProcessCpuMicroseconds() - m_outageStartCpuTime;
+
+			m_stats.totalRecoveryTime += recoveryTime;
+			m_stats.maxRecoveryTime = (std::max)(m_stats.maxRecoveryTime, recoveryTime);
+			m_stats.totalOutageCpuTime += cpuTime;
+
+			LOG_INFO("{} recovered after {} s, the process used {} ms of CPU time in the meantime ({}% of a core)",
+				m_name, recoveryTime / 1e6, cpuTime / 1000.0, (recoveryTime > 0) ? 100.0 * cpuTime / recoveryTime : 0.0);
+		}
+
+		m_everConnected = true;
+	}
+
+	m_state = state;
+}
+
+ConnectionState ConnectionMonitor::getState()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_state;
+}
+
+bool ConnectionMonitor::isAttemptDue()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_clock->now() >= m_nextAttemptTime;
+}
+
+void ConnectionMonitor::backOff()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_nextAttemptTime = m_clock->now() + m_delay;
+	m_delay = (std::min)(m_delay * 2, m_maxDelay);
+	m_stats.backoffs++;
+}
+
+int64_t ConnectionMonitor::getNextAttemptTime()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_nextAttemptTime;
+}
+
+ConnectionStats ConnectionMonitor::getStats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
+
+void ConnectionMonitor::logStatistics()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	uint32_t recovered = m_stats.outages - ((m_everConnected && m_state != ConnectionState_Connected) ? 1 : 0);
+
+	LOG_INFO("{}: {}, {} outages, {} backoffs, next delay {} s", m_name, k_connectionStateNames[m_state], m_stats.outages, m_stats.backoffs, m_delay / 1e6);
+
+	if (recovered > 0) {
+		LOG_INFO("{}: {} s mean and {} s max time to recover, {} ms of CPU time while disconnected",
+			m_name, m_stats.totalRecoveryTime / 1e6 / recovered, m_stats.maxRecoveryTime / 1e6, m_stats.totalOutageCpuTime / 1000.0);
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+class Clock;
+
+enum ConnectionState {
+	ConnectionState_Disconnected = 0, // the runtime is not there, the next attempt waits for the backoff
+	ConnectionState_Connecting, // the runtime answers but can't be used yet, e.g. the Leap service without a device
+	ConnectionState_Connected,
+};
+
+struct ConnectionStats {
+	uint32_t outages { 0 }; // times a working connection was lost, the startup doesn't count
+	uint32_t backoffs { 0 }; // times the next attempt had to wait
+	int64_t totalRecoveryTime { 0 }; // microseconds from losing the connection until it worked again
+	int64_t maxRecoveryTime { 0 };
+	int64_t totalOutageCpuTime { 0 }; // microseconds of process CPU time spent while disconnected
+};
+
+// State of the connection to one runtime and the backoff between attempts to reach it. Every backoff doubles the delay
+// up to the maximum, so a runtime that is gone for good costs next to nothing. The delay only starts over once a connection
+// held for the maximum delay, a runtime that accepts and drops us again right away (e.g. while shutting down) gets the full backoff.
+// An outage lasts from leaving Connected until reaching it again, its wall time and the CPU time the whole process
+// used in the meantime are logged when it ends. Times come from the SteadyClock unless another clock is set, which lets the
+// backoff be tested on a VirtualClock.
+class ConnectionMonitor
+{
+public:
+	ConnectionMonitor(const std::string& name, int64_t initialDelay, int64_t maxDelay);
+
+	void setClock(Clock* clock); // before the first attempt
+
+	void setState(ConnectionState state, const char* reason);
+	ConnectionState getState();
+
+	bool isAttemptDue(); // the backoff since the last failure has passed
+	void backOff(); // after an attempt failed or the connection was lost
+	int64_t getNextAttemptTime(); // on the clock
+
+	ConnectionStats getStats();
+	void logStatistics();
+
+private:
+	std::string m_name;
+	int64_t m_initialDelay;
+	int64_t m_maxDelay;
+	Clock* m_clock;
+
+	std::mutex m_mutex; // the Leap connection is driven by its polling thread, the statistics are read by the main loop
+	ConnectionState m_state { ConnectionState_Disconnected };
+	bool m_everConnected { false };
+	int64_t m_delay;
+	int64_t m_nextAttemptTime { 0 };
+	int64_t m_connectedTime { 0 };
+	int64_t m_outageStartTime { 0 };
+	int64_t m_outageStartCpuTime { 0 };
+	ConnectionStats m_stats;
+};
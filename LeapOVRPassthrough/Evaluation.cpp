@@ -0,0 +1,319 @@
+#include "Evaluation.h"
+#include "SessionFile.h"
+#include "SwipePipeline.h"
+#include "TrackingDetector.h"
+#include "FrameGenerator.h"
+#include "ThreadPool.h"
+#include "utils.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+const int64_t k_labelTolerance = 300000; // microseconds a detection may come after the hand has left the view
+
+struct EvaluationSetting {
+	SwipeSource source;
+	SwipeThresholds thresholds;
+};
+
+std::vector<EvaluationSetting> makeEvaluationSettings() {
+	std::vector<EvaluationSetting> settings;
+
+	for (float coherence : { 0.25f, 0.35f, 0.45f, 0.5f }) {
+		for (float travel : { 0.25f, 0.33f, 0.45f }) {
+			EvaluationSetting setting;
+			setting.source = SwipeSource_Motion;
+			setting.thresholds.motion.minCoherence = coherence;
+			setting.thresholds.motion.minTravel = travel;
+			settings.push_back(setting);
+		}
+	}
+
+	for (float fraction : { 0.1f, 0.15f, 0.2f, 0.3f }) {
+		EvaluationSetting setting;
+		setting.source = SwipeSource_Foreground;
+		setting.thresholds.brightFraction = fraction;
+		settings.push_back(setting);
+	}
+
+	// the tracking detector has no thresholds to tune, it is there to compare the image based sources against
+	EvaluationSetting tracking;
+	tracking.source = SwipeSource_Tracking;
+	settings.push_back(tracking);
+
+	return settings;
+}
+
+// with the tolerance the windows of neighbouring labels overlap, so a detection is matched against all of them
+void scoreDetections(const std::vector<Detection>& detections, const std::vector<SessionLabel>& labels, EvaluationCounts& counts) {
+	std::vector<bool> matched(labels.size(), false);
+
+	for (const Detection& detection : detections) {
+		bool truePositive = false;
+
+		for (size_t i = 0; i < labels.size(); i++) {
+			const SessionLabel& label = labels[i];
+
+			if (detection.timestamp < label.start || detection.timestamp > label.end + k_labelTolerance) continue;
+
+			if (label.fullPass && (detection.direction == SwipeDirection_None || label.direction == detection.direction) && !matched[i]) {
+				matched[i] = true;
+				truePositive = true;
+
+				int64_t latency = detection.timestamp - label.start;
+				counts.latencySum += latency;
+				counts.latencyMax = (std::max)(counts.latencyMax, latency);
+				break;
+			}
+		}
+
+		if (truePositive) {
+			counts.truePositives++;
+		} else {
+			counts.falsePositives++;
+		}
+	}
+
+	for (size_t i = 0; i < labels.size(); i++) {
+		if (labels[i].fullPass && !matched[i]) {
+			counts.falseNegatives++;
+		}
+	}
+}
+
+// all settings share the pyramids of a session, each one gets its own pipeline. Tracking frames are recorded with
+// every image, the detector only sees each of them once. Sessions recorded without tracking aren't scored for it
+void evaluateSession(const std::filesystem::path& path, const std::vector<EvaluationSetting>& settings, std::vector<EvaluationCounts>& counts) {
+	SessionReader reader;
+	if (!reader.open(path.string())) return;
+
+	size_t frameCount = reader.getFrameCount();
+	if (frameCount < 2) return;
+
+	std::filesystem::path labelsPath = path;
+	labelsPath.replace_extension(k_labelsExtension);
+	std::vector<SessionLabel> labels = loadSessionLabels(labelsPath.string());
+
+	int64_t firstTimestamp = reader.getFrame(0).timestamp;
+	int64_t duration = reader.getFrame(frameCount - 1).timestamp - firstTimestamp;
+	float frameRate = (duration > 0) ? (frameCount - 1) * 1e6f / duration : 90.0f;
+
+	PyramidPool pyramidPool;
+	std::vector<SwipePipeline> pipelines(settings.size());
+	std::vector<TrackingDetector> trackingDetectors(settings.size());
+	int64_t lastTrackingFrameId = -1;
+	bool hasTracking = false;
+	std::vector<std::vector<Detection>> detections(settings.size());
+	std::vector<int64_t> lastSwipeTimestamps(settings.size(), firstTimestamp - k_swipeCooldown);
+
+	for (size_t i = 0; i < settings.size(); i++) {
+		pipelines[i].setThresholds(settings[i].thresholds);
+		pipelines[i].setFrameRate(frameRate);
+	}
+
+	for (size_t f = 0; f < frameCount; f++) {
+		ImageFrame frame = reader.getFrame(f);
+		std::shared_ptr<const ImagePyramid> pyramid = pyramidPool.build(frame.frameId, frame.width, frame.height, frame.left, frame.right);
+
+		bool newTrackingFrame = frame.tracking.frameId >= 0 && frame.tracking.frameId != lastTrackingFrameId;
+		lastTrackingFrameId = frame.tracking.frameId;
+		hasTracking = hasTracking || newTrackingFrame;
+
+		for (size_t i = 0; i < settings.size(); i++) {
+			SwipeDirection direction = SwipeDirection_None;
+			int64_t detectionTime = frame.timestamp;
+
+			auto start = std::chrono::steady_clock::now();
+
+			if (settings[i].source != SwipeSource_Tracking) {
+				direction = pipelines[i].processFrame(pyramid, settings[i].source, frame.timestamp);
+			} else if (newTrackingFrame) {
+				direction = trackingDetectors[i].processFrame(frame.tracking);
+				detectionTime = frame.tracking.timestamp;
+			}
+
+			counts[i].costNanoseconds += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+			// same cooldown as LeapHandler
+			if (direction != SwipeDirection_None && detectionTime - lastSwipeTimestamps[i] >= k_swipeCooldown) {
+				lastSwipeTimestamps[i] = detectionTime;
+				detections[i].push_back({ detectionTime, direction });
+			}
+		}
+	}
+
+	for (size_t i = 0; i < settings.size(); i++) {
+		if (settings[i].source == SwipeSource_Tracking && !hasTracking) continue;
+
+		counts[i].frames += frameCount;
+		counts[i].footageSeconds += duration / 1e6;
+		scoreDetections(detections[i], labels, counts[i]);
+	}
+}
+
+int runEvaluation(const char* directory) {
+	std::vector<std::filesystem::path> sessions;
+	std::error_code error;
+
+	for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+		if (entry.is_regular_file() && entry.path().extension() == k_sessionExtension) {
+			sessions.push_back(entry.path());
+		}
+	}
+
+	if (sessions.empty()) {
+		LOG_ERROR("No {} files in {}", k_sessionExtension, directory);
+		return 1;
+	}
+
+	// the longest sessions go first, so that no core is left with a long one at the end
+	std::sort(sessions.begin(), sessions.end(), [](const std::filesystem::path& a, const std::filesystem::path& b) {
+		std::error_code sizeError;
+		return std::filesystem::file_size(a, sizeError) > std::filesystem::file_size(b, sizeError);
+	});
+
+	std::vector<EvaluationSetting> settings = makeEvaluationSettings();
+	std::vector<std::vector<EvaluationCounts>> sessionCounts(sessions.size(), std::vector<EvaluationCounts>(settings.size()));
+
+	uint32_t threadCount = (std::max)(std::thread::hardware_concurrency(), 2u) - 1;
+	ThreadPool threadPool(threadCount, "Evaluation");
+
+	LOG_INFO("Evaluating {} settings on {} sessions with {} threads", settings.size(), sessions.size(), threadPool.getThreadCount());
+
+	auto start = std::chrono::steady_clock::now();
+
+	// sessions are handed out one at a time to whichever thread is free next
+	threadPool.parallelFor(static_cast<int>(sessions.size()), [&](int index) {
+		evaluateSession(sessions[index], settings, sessionCounts[index]);
+	});
+
+	double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::vector<EvaluationCounts> totals(settings.size());
+
+	for (const std::vector<EvaluationCounts>& counts : sessionCounts) {
+		for (size_t i = 0; i < settings.size(); i++) {
+			totals[i].frames += counts[i].frames;
+			totals[i].truePositives += counts[i].truePositives;
+			totals[i].falsePositives += counts[i].falsePositives;
+			totals[i].falseNegatives += counts[i].falseNegatives;
+			totals[i].latencySum += counts[i].latencySum;
+			totals[i].latencyMax = (std::max)(totals[i].latencyMax, counts[i].latencyMax);
+			totals[i].costNanoseconds += counts[i].costNanoseconds;
+			totals[i].footageSeconds += counts[i].footageSeconds;
+		}
+	}
+
+	std::filesystem::path outputPath = std::filesystem::path(directory) / "evaluation.json";
+	FILE* file = nullptr;
+
+	if (fopen_s(&file, outputPath.string().c_str(), "w") != 0 || file == nullptr) {
+		LOG_ERROR("Could not write evaluation results to {}", outputPath.string());
+		return 1;
+	}
+
+	fprintf(file, "{\n\t\"sessions\": %zu,\n\t\"footage_seconds\": %.1f,\n\t\"elapsed_seconds\": %.2f,\n\t\"settings\": [\n",
+		sessions.size(), totals[0].footageSeconds, elapsedSeconds);
+
+	const char* sourceNames[SwipeSource_Count] = { "motion", "foreground", "tracking" };
+
+	for (size_t i = 0; i < settings.size(); i++) {
+		const EvaluationSetting& setting = settings[i];
+		const EvaluationCounts& total = totals[i];
+
+		uint64_t detected = total.truePositives + total.falsePositives;
+		uint64_t expected = total.truePositives + total.falseNegatives;
+		double precision = (detected > 0) ? static_cast<double>(total.truePositives) / detected : 0.0;
+		double recall = (expected > 0) ? static_cast<double>(total.truePositives) / expected : 0.0;
+		double meanLatency = (total.truePositives > 0) ? total.latencySum / 1000.0 / total.truePositives : 0.0;
+		double nsPerFrame = (total.frames > 0) ? total.costNanoseconds / total.frames : 0.0;
+
+		fprintf(file, "\t\t{ \"source\": \"%s\", \"min_coherence\": %.2f, \"min_travel\": %.2f, \"bright_fraction\": %.2f, "
+			"\"precision\": %.3f, \"recall\": %.3f, \"true_positives\": %llu, \"false_positives\": %llu, \"false_negatives\": %llu, "
+			"\"mean_latency_ms\": %.1f, \"max_latency_ms\": %.1f, \"ns_per_frame\": %.0f }%s\n",
+			sourceNames[setting.source], setting.thresholds.motion.minCoherence, setting.thresholds.motion.minTravel, setting.thresholds.brightFraction,
+			precision, recall, static_cast<unsigned long long>(total.truePositives), static_cast<unsigned long long>(total.falsePositives),
+			static_cast<unsigned long long>(total.falseNegatives), meanLatency, total.latencyMax / 1000.0, nsPerFrame, (i + 1 < settings.size()) ? "," : "");
+
+		LOG_INFO("Evaluation {} setting {}: precision {}, recall {}, mean latency {} ms, {} ns/frame",
+			sourceNames[setting.source], i, precision, recall, meanLatency, nsPerFrame);
+	}
+
+	fprintf(file, "\t]\n}\n");
+	fclose(file);
+
+	LOG_INFO("Evaluated {} s of footage in {} s, results written to {}", totals[0].footageSeconds, elapsedSeconds, outputPath.string());
+	return 0;
+}
+
+FrameGeneratorConfig makeGeneratedSessionConfig(int index) {
+	const float frameRates[] = { 60.0f, 90.0f, 120.0f };
+
+	// every session differs in frame rate, lighting and noise
+	FrameGeneratorConfig config;
+	config.seed = index + 1;
+	config.frameRate = frameRates[index % 3];
+	config.ambient = static_cast<uint8_t>(20 + 20 * (index % 2));
+	config.noise = static_cast<uint8_t>(8 + 8 * (index % 2));
+	config.swipes = makeSwipeSequence(8, 3000000, 300000 + 100000 * (index % 3)); // further apart than the swipe cooldown
+
+	return config;
+}
+
+std::vector<SessionLabel> makeGeneratedSessionLabels(const FrameGeneratorConfig& config) {
+	std::vector<SessionLabel> labels;
+
+	for (const GeneratedSwipe& swipe : config.swipes) {
+		labels.push_back({ swipe.startTime, swipe.startTime + swipe.duration, swipe.direction, swipe.extent >= 1.0f });
+	}
+
+	return labels;
+}
+
+int generateSessions(const char* directory, int count) {
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+
+	for (int i = 0; i < count; i++) {
+		FrameGeneratorConfig config = makeGeneratedSessionConfig(i);
+
+		int64_t duration = config.swipes.back().startTime + config.swipes.back().duration + 1000000;
+		int64_t frameCount = static_cast<int64_t>(duration * config.frameRate / 1e6);
+
+		char name[32];
+		snprintf(name, sizeof(name), "synthetic-%02d", i);
+		std::filesystem::path path = std::filesystem::path(directory) / name;
+
+		FrameGenerator generator(config);
+		SessionWriter writer;
+
+		if (!writer.open(path.string() + k_sessionExtension, config.width, config.height)) {
+			return 1;
+		}
+
+		for (int64_t f = 0; f < frameCount; f++) {
+			const FrameLabel& label = generator.generate(f);
+
+			ImageFrame frame;
+			frame.frameId = f;
+			frame.timestamp = label.timestamp;
+			frame.width = config.width;
+			frame.height = config.height;
+			frame.left = generator.getImage(0);
+			frame.right = generator.getImage(1);
+			frame.tracking = generator.getTrackingFrame();
+
+			writer.writeFrame(frame);
+		}
+
+		saveSessionLabels(path.string() + k_labelsExtension, makeGeneratedSessionLabels(config));
+		LOG_INFO("Wrote {} frames at {} Hz to {}", frameCount, config.frameRate, path.string());
+	}
+
+	return 0;
+}
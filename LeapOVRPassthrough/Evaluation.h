@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "FrameGenerator.h"
+#include "SessionFile.h"
+
+struct EvaluationCounts {
+	uint64_t frames { 0 };
+	uint64_t truePositives { 0 };
+	uint64_t falsePositives { 0 };
+	uint64_t falseNegatives { 0 };
+	int64_t latencySum { 0 };
+	int64_t latencyMax { 0 };
+	double costNanoseconds { 0.0 };
+	double footageSeconds { 0.0 };
+};
+
+struct Detection {
+	int64_t timestamp;
+	SwipeDirection direction;
+};
+
+// Offline tuning of the image based swipe detection. Every recorded session in a directory is run through the
+// SwipePipeline with a grid of thresholds, and precision, recall, detection latency and cost per frame of each setting
+// are written to evaluation.json in that directory. Sessions are memory mapped and nothing touches the GPU.
+int runEvaluation(const char* directory);
+
+// writes labelled sessions made by the FrameGenerator, for when there are no recordings at hand
+int generateSessions(const char* directory, int count);
+
+// the scripted sessions generateSessions writes, also used by the benchmark to score detectors without touching the disk
+FrameGeneratorConfig makeGeneratedSessionConfig(int index);
+std::vector<SessionLabel> makeGeneratedSessionLabels(const FrameGeneratorConfig& config);
+
+// every full pass should be detected once with the right direction, anything else is a false positive. A detection without
+// a direction (SwipeDirection_None, from a detector that can't tell) matches a pass in any direction
+void scoreDetections(const std::vector<Detection>& detections, const std::vector<SessionLabel>& labels, EvaluationCounts& counts);
@@ -0,0 +1,220 @@
+#include "FrameGenerator.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define GENERATOR_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+const uint32_t k_noiseTableMask = 0xFFFF;
+const int k_maxGeneratedWidth = 4096;
+const int64_t k_velocityStep = 1000; // microseconds over which the palm velocity is measured
+
+uint32_t hashNoise(uint32_t value) {
+	value ^= value >> 16;
+	value *= 0x7FEB352Du;
+	value ^= value >> 15;
+	value *= 0x846CA68Bu;
+	value ^= value >> 16;
+	return value;
+}
+
+FrameGenerator::FrameGenerator(const FrameGeneratorConfig& config) :
+	m_config(config)
+{
+	m_config.width = (std::min)(m_config.width, k_maxGeneratedWidth);
+	m_pixels.resize(static_cast<size_t>(m_config.width) * m_config.height * 2);
+
+	// rows start at a random position of the table, the tail lets a full row be read from any position
+	m_noiseTable.resize(k_noiseTableMask + 1 + k_maxGeneratedWidth);
+	uint32_t state = m_config.seed | 1;
+
+	for (uint8_t& value : m_noiseTable) {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		value = static_cast<uint8_t>((state >> 8) % (m_config.noise + 1u));
+	}
+}
+
+const FrameLabel& FrameGenerator::generate(int64_t frameIndex)
+{
+	TRACE_SCOPE("FrameGenerator::generate");
+
+	int width = m_config.width;
+	int height = m_config.height;
+
+	int64_t timestamp = static_cast<int64_t>(frameIndex * 1e6 / m_config.frameRate);
+	int64_t scriptTime = (m_config.loopDuration > 0) ? timestamp % m_config.loopDuration : timestamp;
+
+	m_label = makeLabel(scriptTime);
+	m_label.timestamp = timestamp;
+	updateTrackingFrame(frameIndex, scriptTime);
+
+	float centerX = m_label.handX * width;
+	float centerY = m_label.handY * height;
+	float radiusX = m_config.handSize * width * 0.5f;
+	float radiusY = radiusX * 1.5f; // hands are taller than wide, the images have square pixels
+
+	uint32_t frameHash = hashNoise(m_config.seed ^ static_cast<uint32_t>(frameIndex * 0x9E3779B9u));
+
+	for (int camera = 0; camera < 2; camera++) {
+		uint8_t* image = m_pixels.data() + camera * width * height;
+		float shift = (camera == 0) ? 0.0f : static_cast<float>(m_config.disparity);
+
+		for (int y = 0; y < height; y++) {
+			uint8_t* row = image + y * width;
+			uint32_t noiseOffset = hashNoise(frameHash + y * 2 + camera) & k_noiseTableMask;
+
+			fillRow(row, 0, width, m_config.ambient, noiseOffset);
+
+			float dy = (y + 0.5f - centerY) / radiusY;
+
+			if (!m_label.handVisible || std::abs(dy) >= 1.0f) continue;
+
+			// the hand is an ellipse, each row covers one span of it
+			float halfWidth = radiusX * std::sqrt(1.0f - dy * dy);
+			int x0 = (std::max)(static_cast<int>(centerX - shift - halfWidth), 0);
+			int x1 = (std::min)(static_cast<int>(centerX - shift + halfWidth), width);
+
+			if (x0 < x1) {
+				fillRow(row, x0, x1, m_config.handBrightness, noiseOffset);
+			}
+		}
+	}
+
+	return m_label;
+}
+
+const FrameGeneratorConfig& FrameGenerator::getConfig()
+{
+	return m_config;
+}
+
+const uint8_t* FrameGenerator::getImage(int camera)
+{
+	return m_pixels.data() + camera * m_config.width * m_config.height;
+}
+
+const FrameLabel& FrameGenerator::getLabel()
+{
+	return m_label;
+}
+
+const TrackingFrame& FrameGenerator::getTrackingFrame()
+{
+	return m_trackingFrame;
+}
+
+void FrameGenerator::fillRow(uint8_t* row, int x0, int x1, uint8_t base, uint32_t noiseOffset)
+{
+	const uint8_t* noise = m_noiseTable.data() + noiseOffset;
+	int x = x0;
+
+#ifdef GENERATOR_USE_SSE2
+	const __m128i baseValue = _mm_set1_epi8(static_cast<char>(base));
+
+	for (; x + 16 <= x1; x += 16) {
+		__m128i values = _mm_adds_epu8(baseValue, _mm_loadu_si128((const __m128i*)(noise + x)));
+		_mm_storeu_si128((__m128i*)(row + x), values);
+	}
+#endif
+
+	for (; x < x1; x++) {
+		row[x] = static_cast<uint8_t>((std::min)(base + noise[x], 255));
+	}
+}
+
+FrameLabel FrameGenerator::makeLabel(int64_t scriptTime)
+{
+	FrameLabel label;
+
+	for (size_t i = 0; i < m_config.swipes.size(); i++) {
+		const GeneratedSwipe& swipe = m_config.swipes[i];
+
+		if (scriptTime < swipe.startTime || scriptTime >= swipe.startTime + swipe.duration || swipe.duration <= 0) continue;
+
+		float progress = static_cast<float>(scriptTime - swipe.startTime) / swipe.duration;
+
+		// full passes move at constant speed, partial ones go in and come back out the same way
+		float travel = (swipe.extent >= 1.0f) ? progress : swipe.extent * (1.0f - std::abs(2.0f * progress - 1.0f));
+
+		// from just outside the entry edge to just outside the opposite edge, in units of the image size
+		bool horizontal = swipe.direction == SwipeDirection_FromLeft || swipe.direction == SwipeDirection_FromRight;
+		float radius = horizontal ? m_config.handSize * 0.5f : m_config.handSize * 0.75f * m_config.width / m_config.height;
+		float position = -radius + (1.0f + 2.0f * radius) * travel;
+
+		if (swipe.direction == SwipeDirection_FromRight || swipe.direction == SwipeDirection_FromBottom) {
+			position = 1.0f - position;
+		}
+
+		label.handX = horizontal ? position : swipe.offset;
+		label.handY = horizontal ? swipe.offset : position;
+		label.handVisible = true;
+		label.swipeIndex = static_cast<int>(i);
+		label.swipe = swipe.direction;
+		label.fullPass = swipe.extent >= 1.0f;
+		break;
+	}
+
+	return label;
+}
+
+LEAP_VECTOR FrameGenerator::makePalmPosition(const FrameLabel& label)
+{
+	// image columns follow the palm's x and image rows its z, see TrackingDetector. The hand is 200 mm above the device
+	LEAP_VECTOR position;
+	position.x = (label.handX - 0.5f) * m_config.viewSize;
+	position.y = 200.0f;
+	position.z = (label.handY - 0.5f) * m_config.viewSize;
+	return position;
+}
+
+void FrameGenerator::updateTrackingFrame(int64_t frameIndex, int64_t scriptTime)
+{
+	m_trackingFrame = TrackingFrame();
+	m_trackingFrame.frameId = frameIndex;
+	m_trackingFrame.timestamp = m_label.timestamp;
+
+	// the service only finds a hand once its palm is in view, not as soon as the fingertips are
+	bool palmVisible = m_label.handX >= 0.0f && m_label.handX <= 1.0f && m_label.handY >= 0.0f && m_label.handY <= 1.0f;
+
+	if (!m_label.handVisible || !palmVisible) return;
+
+	// the velocity is measured over the last millisecond, or the next one when the hand only just came into view
+	FrameLabel earlier = makeLabel(scriptTime - k_velocityStep);
+	FrameLabel later = makeLabel(scriptTime + k_velocityStep);
+	bool backwards = earlier.swipeIndex == m_label.swipeIndex;
+	const FrameLabel& other = backwards ? earlier : later;
+
+	LEAP_VECTOR position = makePalmPosition(m_label);
+	LEAP_VECTOR otherPosition = makePalmPosition(other);
+	float scale = (backwards ? 1e6f : -1e6f) / k_velocityStep;
+
+	TrackedHand& hand = m_trackingFrame.hands[0];
+	hand.id = static_cast<uint32_t>(m_label.swipeIndex) + 1;
+	hand.confidence = 1.0f;
+	hand.position = position;
+
+	for (int axis = 0; axis < 3; axis++) {
+		hand.velocity.v[axis] = (position.v[axis] - otherPosition.v[axis]) * scale;
+	}
+
+	m_trackingFrame.handCount = 1;
+}
+
+std::vector<GeneratedSwipe> makeSwipeSequence(int count, int64_t interval, int64_t duration) {
+	std::vector<GeneratedSwipe> swipes(count);
+
+	for (int i = 0; i < count; i++) {
+		swipes[i].direction = static_cast<SwipeDirection>(i % SwipeDirection_Count);
+		swipes[i].startTime = interval * (i + 1);
+		swipes[i].duration = duration;
+		swipes[i].extent = (i % 3 == 2) ? 0.5f : 1.0f;
+	}
+
+	return swipes;
+}
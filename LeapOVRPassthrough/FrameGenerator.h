@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "SwipeDetector.h"
+#include "TrackingDetector.h"
+
+// one scripted pass of a hand over the sensor, times are relative to the first frame
+struct GeneratedSwipe {
+	SwipeDirection direction { SwipeDirection_FromTop };
+	int64_t startTime { 0 }; // microseconds
+	int64_t duration { 400000 }; // microseconds a full pass takes from entering the view to leaving it on the other side
+	float extent { 1.0f }; // how far the hand gets, below 1 it turns around and leaves through the edge it came from
+	float offset { 0.5f }; // position across the direction of motion
+};
+
+struct FrameGeneratorConfig {
+	int width { 640 };
+	int height { 240 };
+	float frameRate { 90.0f };
+	uint32_t seed { 1 };
+	uint8_t ambient { 20 }; // brightness of the background
+	uint8_t noise { 8 }; // amplitude of the sensor noise
+	uint8_t handBrightness { 170 };
+	float handSize { 0.35f }; // width of the hand as a fraction of the image width
+	float viewSize { 400.0f }; // mm the view covers along either axis at the height of the hand, scales the tracking frames
+	int disparity { 8 }; // pixels the hand is shifted by in the right camera
+	int64_t loopDuration { 0 }; // microseconds after which the script starts over, 0 plays it once
+	std::vector<GeneratedSwipe> swipes;
+};
+
+// ground truth of a generated frame
+struct FrameLabel {
+	int64_t timestamp { 0 };
+	bool handVisible { false };
+	float handX { 0.0f }; // center of the hand, normalized to [0, 1] in the left camera image
+	float handY { 0.0f };
+	int swipeIndex { -1 }; // scripted swipe in progress, -1 if none
+	SwipeDirection swipe { SwipeDirection_None };
+	bool fullPass { false }; // the swipe in progress crosses the whole view, i.e. it should be detected
+};
+
+// Procedural infrared frames in the layout LeapC delivers them: 8 bit, both cameras back to back in one buffer.
+// A frame only depends on the seed and its index, so sequences are reproducible and frames can be generated in any order.
+// Noise comes from a precomputed table and rows are filled with saturating SSE2 adds, which keeps generation far above
+// the frame rate of any real device.
+class FrameGenerator
+{
+public:
+	FrameGenerator(const FrameGeneratorConfig& config);
+
+	const FrameLabel& generate(int64_t frameIndex);
+
+	const FrameGeneratorConfig& getConfig();
+	const uint8_t* getImage(int camera);
+	const FrameLabel& getLabel();
+	const TrackingFrame& getTrackingFrame(); // the palm of the labelled hand, as the tracking service would report it
+
+private:
+	void fillRow(uint8_t* row, int x0, int x1, uint8_t base, uint32_t noiseOffset);
+	FrameLabel makeLabel(int64_t scriptTime);
+	LEAP_VECTOR makePalmPosition(const FrameLabel& label);
+	void updateTrackingFrame(int64_t frameIndex, int64_t scriptTime);
+
+	FrameGeneratorConfig m_config;
+	std::vector<uint8_t> m_noiseTable;
+	std::vector<uint8_t> m_pixels;
+	FrameLabel m_label;
+	TrackingFrame m_trackingFrame;
+};
+
+// a swipe every interval cycling through all directions, every third one only covers half of the view
+std::vector<GeneratedSwipe> makeSwipeSequence(int count, int64_t interval, int64_t duration);
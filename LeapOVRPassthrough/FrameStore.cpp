@@ -0,0 +1,145 @@
+#include "FrameStore.h"
+#include "Trace.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+FrameStore::FrameStore()
+{
+	m_pixelData = (uint8_t*)malloc(m_width * m_height * 2 * sizeof(uint8_t));
+	m_distortionPixelData = (float*)malloc(k_distortionMapFloats * sizeof(float));
+
+	// placeholders until the first frame and the distortion maps arrive, filled in before the Leap thread can deliver them
+	for (int i = 0; i < m_width * m_height * 2; i++) {
+		m_pixelData[i] = 255;
+	}
+	for (int i = 0; i < k_distortionMapFloats; i++) {
+		m_distortionPixelData[i] = 0.5f;
+	}
+
+	m_latestData = m_pixelData;
+}
+
+FrameStore::~FrameStore()
+{
+	free(m_pixelData);
+	free(m_distortionPixelData);
+}
+
+bool FrameStore::setFrame(int width, int height, const uint8_t* left, const uint8_t* right)
+{
+	TRACE_SCOPE("FrameStore::setFrame");
+
+	// the pixel buffer is only reallocated when this frame's size differs from the last one
+	bool resized = m_width != width || m_height != height;
+
+	m_width = width;
+	m_height = height;
+
+	if (resized) {
+		if (m_pixelData != nullptr) {
+			free(m_pixelData);
+		}
+
+		m_pixelData = (uint8_t*)malloc(m_width * m_height * 2);
+		m_latestData = m_pixelData;
+	}
+
+	assert(m_pixelData != nullptr);
+
+	size_t imageSize = m_width * m_height;
+
+	// a frame the render thread hasn't taken yet is simply replaced, otherwise it goes into a slot nobody reads from
+	int slot = -1;
+
+	if (m_slotData != nullptr && imageSize * 2 <= m_slotSize) {
+		if (m_latestSlot >= 0 && !m_latestTaken) {
+			slot = m_latestSlot;
+		} else {
+			for (int i = 0; i < k_frameSlots && slot < 0; i++) {
+				if (!m_slotReserved[i]) slot = i;
+			}
+		}
+	}
+
+	uint8_t* destination = (slot >= 0) ? m_slotData + slot * m_slotSize : m_pixelData;
+
+	// LeapC usually delivers both images back to back in one buffer, in which case one copy is enough
+	if (right == nullptr) {
+		memcpy(destination, left, imageSize);
+	} else if (right == left + imageSize) {
+		memcpy(destination, left, imageSize * 2);
+	} else {
+		memcpy(destination, left, imageSize);
+		memcpy(destination + imageSize, right, imageSize);
+	}
+
+	m_latestData = destination;
+	m_latestSlot = slot;
+	m_latestTaken = false;
+
+	return resized;
+}
+
+void FrameStore::attachSlots(uint8_t* data, size_t slotSize)
+{
+	// the slots may be write only, a frame that was in them is lost
+	if (m_latestSlot >= 0) {
+		m_latestData = m_pixelData;
+	}
+
+	m_slotData = data;
+	m_slotSize = (data != nullptr) ? slotSize : 0;
+	m_latestSlot = -1;
+
+	for (bool& reserved : m_slotReserved) {
+		reserved = false;
+	}
+}
+
+int FrameStore::takeFrame()
+{
+	m_latestTaken = true;
+
+	if (m_latestSlot >= 0) {
+		m_slotReserved[m_latestSlot] = true;
+	}
+
+	return m_latestSlot;
+}
+
+void FrameStore::releaseSlot(int slot)
+{
+	m_slotReserved[slot] = false;
+}
+
+size_t FrameStore::getSlotSize()
+{
+	return m_slotSize;
+}
+
+void FrameStore::setDistortionMap(int camera, const float* data)
+{
+	memcpy(m_distortionPixelData + camera * k_distortionMapSize * 2, data, k_distortionMapSize * 2 * sizeof(float));
+}
+
+int FrameStore::getWidth()
+{
+	return m_width;
+}
+
+int FrameStore::getHeight()
+{
+	return m_height;
+}
+
+const uint8_t* FrameStore::getPixelData()
+{
+	return m_latestData;
+}
+
+const float* FrameStore::getDistortionData()
+{
+	return m_distortionPixelData;
+}
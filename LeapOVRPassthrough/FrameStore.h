@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+
+extern "C" {
+	#include <LeapC.h>
+}
+
+const int k_distortionMapSize = LEAP_DISTORTION_MATRIX_N * LEAP_DISTORTION_MATRIX_N;
+const int k_distortionMapFloats = k_distortionMapSize * 2 * 2; // an (x, y) pair per entry for each of the two cameras
+const int k_frameSlots = 3; // one being uploaded by the GPU, one waiting for the render thread and one to write into
+
+// The latest camera images and distortion maps, laid out the way the video and distortion textures are uploaded.
+// Not synchronized, the GraphicsManager holds its update mutex around every call. It has no GL code of its own,
+// so the copies can be measured without a context (see the Benchmark project).
+//
+// Frames are copied straight into slots of memory the GPU reads from (a persistently mapped pixel buffer) once
+// attachSlots() has provided them, so the copy setFrame makes is the only one. A slot handed out by takeFrame() isn't
+// written again until releaseSlot(), i.e. until the GPU has read it. Frames go into the store's own buffer when there
+// are no slots, they are too small for the frame or all of them are still being read.
+class FrameStore
+{
+public:
+	FrameStore();
+	~FrameStore();
+
+	// returns true if the size differs from the previous frame, the textures have to be recreated then.
+	// Without a right image (mono) only the left one is copied and the right half of the buffer keeps the previous frame
+	bool setFrame(int width, int height, const uint8_t* left, const uint8_t* right);
+	void setDistortionMap(int camera, const float* data);
+
+	void attachSlots(uint8_t* data, size_t slotSize); // k_frameSlots slots one after the other, nullptr detaches them
+	int takeFrame(); // slot of the latest frame, which stays reserved until it is released, or -1 if it isn't in a slot
+	void releaseSlot(int slot);
+	size_t getSlotSize();
+
+	int getWidth();
+	int getHeight();
+	const uint8_t* getPixelData(); // the latest frame, wherever it is
+	const float* getDistortionData();
+
+private:
+	uint8_t* m_pixelData { nullptr }; // left and right image, one after the other
+	uint8_t* m_latestData { nullptr };
+	uint8_t* m_slotData { nullptr };
+	size_t m_slotSize { 0 };
+	bool m_slotReserved[k_frameSlots] {};
+	int m_latestSlot { -1 };
+	bool m_latestTaken { false };
+	float* m_distortionPixelData { nullptr }; // left and right distortion map, one after the other
+	int m_width { 100 };
+	int m_height { 100 };
+};
@@ -1,363 +1,492 @@
-#include "GraphicsManager.h"
-
-const char* vertexShaderCode = R"""(
-#version 420 core
-
-layout(location = 0) in vec3 position;
-layout(location = 1) in vec2 uv;
-
-out vec2 vUv;
-
-void main() {
-	vUv = uv;
-	gl_Position = vec4(position, 1.0);
-}
-)""";
-const GLint vertexShaderCodeLength = strlen(vertexShaderCode);
-
-const char* fragmentShaderCode = R"""(
-#version 420 core
-
-layout(location = 0) out vec4 diffuseColor;
-
-uniform sampler2D textureSampler;
-uniform sampler2D distortionTextureSampler;
-uniform bool useDistortionMap; 
-
-in vec2 vUv;
-
-void main() {
-	if (useDistortionMap) {
-		vec2 uv = vUv;
-		vec2 distortionIndex = texture2D(distortionTextureSampler, uv).xy;
-
-		float hIndex = distortionIndex.x;
-		float vIndex = distortionIndex.y;
-
-		if (vIndex > 0.0 && vIndex < 1.0 && hIndex > 0.0 && hIndex < 1.0) {
-			diffuseColor = vec4(texture(textureSampler, distortionIndex).rrr, 1);
-		} else {
-			diffuseColor = vec4(0.2, 0.0, 0.0, 0.0);
-		}
-	} else {
-		vec2 uv = vec2(vUv.x, 1 - vUv.y);
-		diffuseColor = vec4(texture( textureSampler, uv).rrr, 1);
-	}
-}
-)""";
-const GLint fragmentShaderCodeLength = strlen(fragmentShaderCode);
-
-static const GLfloat fullscreenQuadGeo[] = {
-	-1.0f, -1.0f, 0.0f,
-	1.0f, -1.0f, 0.0f,
-	-1.0f,  1.0f, 0.0f,
-	-1.0f,  1.0f, 0.0f,
-	1.0f,  1.0f, 0.0f,
-	1.0f, -1.0f, 0.0f,
-};
-
-static const GLfloat fullscreenQuadUVs[] = {
-	0.0f, 0.0f,
-	1.0f, 0.0f,
-	0.0f,  1.0f,
-	0.0f,  1.0f,
-	1.0f,  1.0f,
-	1.0f, 0.0f,
-};
-
-GraphicsManager* s_sharedInstance = nullptr;
-
-bool checkShader(GLuint id) {
-	GLint result = GL_FALSE;
-	int infoLogLength;
-
-	glGetShaderiv(id, GL_COMPILE_STATUS, &result);
-	glGetShaderiv(id, GL_INFO_LOG_LENGTH, &infoLogLength);
-	if (infoLogLength > 0) {
-		std::vector<char> shaderErrorMessage(infoLogLength + 1);
-		std::vector<wchar_t> shaderErrorMessageW(infoLogLength + 1);
-
-		glGetShaderInfoLog(id, infoLogLength, NULL, &shaderErrorMessage[0]);
-
-		size_t convertedChars = 0;
-		mbstowcs_s(&convertedChars, &shaderErrorMessageW[0], shaderErrorMessageW.size(), &shaderErrorMessage[0], shaderErrorMessage.size() - 1);
-		OutputDebugString(&shaderErrorMessageW[0]);
-	}
-
-	return infoLogLength == 0;
-}
-
-bool checkProgram(GLuint id) {
-	GLint result = GL_FALSE;
-	int infoLogLength;
-
-	glGetProgramiv(id, GL_COMPILE_STATUS, &result);
-	glGetProgramiv(id, GL_INFO_LOG_LENGTH, &infoLogLength);
-	if (infoLogLength > 0) {
-		std::vector<char> shaderErrorMessage(infoLogLength + 1);
-		std::vector<wchar_t> shaderErrorMessageW(infoLogLength + 1);
-
-		glGetShaderInfoLog(id, infoLogLength, NULL, &shaderErrorMessage[0]);
-
-		size_t convertedChars = 0;
-		mbstowcs_s(&convertedChars, &shaderErrorMessageW[0], shaderErrorMessageW.size(), &shaderErrorMessage[0], shaderErrorMessage.size() - 1);
-		OutputDebugString(&shaderErrorMessageW[0]);
-	}
-
-	return infoLogLength == 0;
-}
-
-
-GraphicsManager * GraphicsManager::getInstance()
-{
-	if (s_sharedInstance == nullptr) {
-		s_sharedInstance = new GraphicsManager();
-	}
-
-	return s_sharedInstance;
-}
-
-GraphicsManager::GraphicsManager()
-{
-	m_pixelData = (uint8_t*)malloc(m_width * m_height * sizeof(uint8_t));
-	m_distortionPixelData = (float*)malloc(LEAP_DISTORTION_MATRIX_N * LEAP_DISTORTION_MATRIX_N * 2 * sizeof(float));
-}
-
-GraphicsManager::~GraphicsManager()
-{
-	free(m_pixelData);
-	free(m_distortionPixelData);
-}
-
-bool GraphicsManager::init()
-{
-	// create and compile vertex shader
-	m_vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(m_vertexShader, 1, &vertexShaderCode, &vertexShaderCodeLength);
-	glCompileShader(m_vertexShader);
-
-	if (!checkShader(m_vertexShader)) return false;
-
-	// create and compile fragment shader
-	m_fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(m_fragmentShader, 1, &fragmentShaderCode, &fragmentShaderCodeLength);
-	glCompileShader(m_fragmentShader);
-
-	if (!checkShader(m_fragmentShader)) return false;
-
-	// turn vertex and fragment shader into a program
-	m_shaderProgram = glCreateProgram();
-	glAttachShader(m_shaderProgram, m_vertexShader);
-	glAttachShader(m_shaderProgram, m_fragmentShader);
-	glLinkProgram(m_shaderProgram);
-
-	if (!checkProgram(m_shaderProgram)) return false;
-
-	m_textureSamplerID = glGetUniformLocation(m_shaderProgram, "textureSampler");
-	m_distortionTextureSamplerID = glGetUniformLocation(m_shaderProgram, "distortionTextureSampler");
-	m_useDistortionMapID = glGetUniformLocation(m_shaderProgram, "useDistortionMap");
-
-	glGenVertexArrays(1, &m_fullscreenQuadVAO);
-	glBindVertexArray(m_fullscreenQuadVAO);
-
-	glGenBuffers(1, &m_fullscreenQuadBuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, m_fullscreenQuadBuffer);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(fullscreenQuadGeo), fullscreenQuadGeo, GL_STATIC_DRAW);
-
-	glGenBuffers(1, &m_fullscreenQuadUVs);
-	glBindBuffer(GL_ARRAY_BUFFER, m_fullscreenQuadUVs);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(fullscreenQuadUVs), fullscreenQuadUVs, GL_STATIC_DRAW);
-
-	// create framebuffer
-	glGenFramebuffers(1, &m_framebuffer);
-	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
-
-	glGenTextures(1, &m_framebufferTexture);
-	glBindTexture(GL_TEXTURE_2D, m_framebufferTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_fbWidth, m_fbHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-
-	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_framebufferTexture, 0);
-	GLenum DrawBuffers[1] = { GL_COLOR_ATTACHMENT0 };
-	glDrawBuffers(1, DrawBuffers);
-
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-		return false;
-	}
-
-	// generate a dummy initial video texture
-	for (int i = 0; i < m_width * m_height; i++) {
-		m_pixelData[i] = 255;
-	}
-	for (int i = 0; i < LEAP_DISTORTION_MATRIX_N * LEAP_DISTORTION_MATRIX_N * 2; i++) {
-		m_distortionPixelData[i] = 0.5f;
-	}
-
-	glGenTextures(1, &m_videoTexture);
-	glBindTexture(GL_TEXTURE_2D, m_videoTexture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, m_width, m_height, 0, GL_RED, GL_UNSIGNED_BYTE, m_pixelData);
-
-	glGenTextures(1, &m_distortionTexture);
-	glBindTexture(GL_TEXTURE_2D, m_distortionTexture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG, LEAP_DISTORTION_MATRIX_N, LEAP_DISTORTION_MATRIX_N, 0, GL_RG, GL_FLOAT, m_distortionPixelData);
-
-	updateFramebuffer();
-
-	return true;
-}
-
-void GraphicsManager::updateTexture()
-{
-	std::lock_guard<std::mutex> lock(m_updateMutex);
-
-	if (!m_frameChanged) {
-		return;
-	}
-
-	if (m_dimensionsChanged) { // re-gen texture
-		//glDeleteTextures(1, &m_videoTexture);
-		//glGenTextures(1, &m_videoTexture);
-
-		//glBindTexture(GL_TEXTURE_2D, m_videoTexture);
-
-		//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		glBindTexture(GL_TEXTURE_2D, m_videoTexture);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, m_width, m_height, 0, GL_RED, GL_UNSIGNED_BYTE, m_pixelData);
-
-		glBindTexture(GL_TEXTURE_2D, m_framebufferTexture);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_fbWidth, m_fbHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
-	} else {
-		glBindTexture(GL_TEXTURE_2D, m_videoTexture);
-		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_width, m_height, GL_RED, GL_UNSIGNED_BYTE, m_pixelData);
-	}
-
-	if (m_distortionMapChanged) {
-		glBindTexture(GL_TEXTURE_2D, m_distortionTexture);
-		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, LEAP_DISTORTION_MATRIX_N, LEAP_DISTORTION_MATRIX_N, GL_RG, GL_FLOAT, m_distortionPixelData);
-	}
-
-	m_wasUpdated = true;
-	m_dimensionsChanged = false;
-	m_distortionMapChanged = false;
-	m_frameChanged = false;
-
-	updateFramebuffer();
-}
-
-void GraphicsManager::setFrame(int width, int height, uint8_t* data)
-{
-	std::lock_guard<std::mutex> lock(m_updateMutex);
-	//std::cout << "width: " << width << " height: " << height << std::endl;
-
-	if (m_width != width || m_height != height) {
-		m_dimensionsChanged = true;
-	}
-
-	m_frameChanged = true;
-	m_width = width;
-	m_height = height;
-
-	if (m_dimensionsChanged) {
-		if (m_pixelData != nullptr) {
-			free(m_pixelData);
-		}
-
-		m_pixelData = (uint8_t*)malloc(m_width * m_height);
-	}
-
-	assert(m_pixelData != nullptr); 
-
-	memcpy(m_pixelData, data, m_width * m_height);
-}
-
-void GraphicsManager::setDistortionMap(float* data)
-{
-	std::lock_guard<std::mutex> lock(m_updateMutex);
-
-	m_distortionMapChanged = true;
-
-	OutputDebugString(L"Distortion map changed\n");
-
-	memcpy(m_distortionPixelData, data, LEAP_DISTORTION_MATRIX_N * LEAP_DISTORTION_MATRIX_N * 2 * sizeof(float));
-}
-
-void GraphicsManager::setDistortionMapActive(bool active)
-{
-	std::lock_guard<std::mutex> lock(m_updateMutex);
-
-	m_useDistortionMap = active;
-}
-
-bool GraphicsManager::getDistortionMapActive()
-{
-	std::lock_guard<std::mutex> lock(m_updateMutex);
-
-	return m_useDistortionMap;
-}
-
-GLuint GraphicsManager::getVideoTexture()
-{
-	return m_framebufferTexture;
-}
-
-bool GraphicsManager::wasUpdated()
-{
-	std::lock_guard<std::mutex> lock(m_updateMutex);
-	return m_wasUpdated;
-}
-
-void GraphicsManager::updateFramebuffer()
-{
-	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
-	glViewport(0, 0, m_fbWidth, m_fbHeight);
-
-	glClear(GL_COLOR_BUFFER_BIT);
-
-	glUseProgram(m_shaderProgram);
-
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, m_videoTexture);
-	glUniform1i(m_textureSamplerID, 0); // set the sampler to use texture unit 0
-	glBindTexture(GL_TEXTURE0, m_videoTexture);
-
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, m_distortionTexture);
-	glUniform1i(m_distortionTextureSamplerID, 1); // set the distortion sampler to use texture unit 0
-	glBindTexture(GL_TEXTURE1, m_distortionTexture);
-
-	glUniform1i(m_useDistortionMapID, m_useDistortionMap);
-
-	glEnableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, m_fullscreenQuadBuffer);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-
-	glEnableVertexAttribArray(1);
-	glBindBuffer(GL_ARRAY_BUFFER, m_fullscreenQuadUVs);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
-
-	glDrawArrays(GL_TRIANGLES, 0, 6);
-	glDisableVertexAttribArray(0);
-	glDisableVertexAttribArray(1);
-
-	glEnd();
-	glFlush();
-}
-
-void GraphicsManager::setFramebufferSize(int width, int height)
-{
-	std::lock_guard<std::mutex> lock(m_updateMutex);
-
-	m_fbWidth = width;
-	m_fbHeight = height;
-
-	m_dimensionsChanged = true;
-}
+#include "GraphicsManager.h"
+#include "ProgramCache.h"
+#include "BakedAssets.h"
+#include "utils.h"
+
+// the sources are in assets\shaders, AssetBaker validates them and bakes them into the header at build time
+const char* vertexShaderCode = k_fullscreenVertexShader;
+const GLint vertexShaderCodeLength = sizeof(k_fullscreenVertexShader) - 1;
+
+const char* fragmentShaderCode = k_overlayFragmentShader;
+const GLint fragmentShaderCodeLength = sizeof(k_overlayFragmentShader) - 1;
+
+static const GLfloat fullscreenQuadGeo[] = {
+	-1.0f, -1.0f, 0.0f,
+	1.0f, -1.0f, 0.0f,
+	-1.0f,  1.0f, 0.0f,
+	-1.0f,  1.0f, 0.0f,
+	1.0f,  1.0f, 0.0f,
+	1.0f, -1.0f, 0.0f,
+};
+
+static const GLfloat fullscreenQuadUVs[] = {
+	0.0f, 0.0f,
+	1.0f, 0.0f,
+	0.0f,  1.0f,
+	0.0f,  1.0f,
+	1.0f,  1.0f,
+	1.0f, 0.0f,
+};
+
+GraphicsManager* s_sharedInstance = nullptr;
+
+GraphicsManager * GraphicsManager::getInstance()
+{
+	if (s_sharedInstance == nullptr) {
+		s_sharedInstance = new GraphicsManager();
+	}
+
+	return s_sharedInstance;
+}
+
+GraphicsManager::GraphicsManager() :
+	m_clock(SteadyClock::getInstance())
+{
+}
+
+bool GraphicsManager::init()
+{
+	// loaded from the driver's binary of an earlier start when possible, see ProgramCache
+	m_shaderProgram = ProgramCache::getInstance()->linkProgram("overlay", vertexShaderCode, vertexShaderCodeLength, fragmentShaderCode, fragmentShaderCodeLength);
+
+	if (m_shaderProgram == 0) return false;
+
+	m_textureSamplerID = glGetUniformLocation(m_shaderProgram, "textureSampler");
+	m_distortionTextureSamplerID = glGetUniformLocation(m_shaderProgram, "distortionTextureSampler");
+	m_useDistortionMapID = glGetUniformLocation(m_shaderProgram, "useDistortionMap");
+	m_stereoID = glGetUniformLocation(m_shaderProgram, "stereo");
+	m_showHighlightID = glGetUniformLocation(m_shaderProgram, "showHighlight");
+	m_highlightRectID = glGetUniformLocation(m_shaderProgram, "highlightRect");
+
+	glGenVertexArrays(1, &m_fullscreenQuadVAO);
+	glBindVertexArray(m_fullscreenQuadVAO);
+
+	glGenBuffers(1, &m_fullscreenQuadBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, m_fullscreenQuadBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(fullscreenQuadGeo), fullscreenQuadGeo, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &m_fullscreenQuadUVs);
+	glBindBuffer(GL_ARRAY_BUFFER, m_fullscreenQuadUVs);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(fullscreenQuadUVs), fullscreenQuadUVs, GL_STATIC_DRAW);
+
+	// create framebuffer
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+
+	glGenTextures(1, &m_framebufferTexture);
+	glBindTexture(GL_TEXTURE_2D, m_framebufferTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_fbWidth, m_fbHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_framebufferTexture, 0);
+	GLenum DrawBuffers[1] = { GL_COLOR_ATTACHMENT0 };
+	glDrawBuffers(1, DrawBuffers);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		return false;
+	}
+
+	// the Leap connection comes up on its own thread, so frames and distortion maps may already be arriving
+	std::lock_guard<std::mutex> lock(m_updateMutex);
+
+	// both camera images live in one 2-layer array texture so that a frame is a single upload
+	glGenTextures(1, &m_videoTexture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_videoTexture);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R8, m_frameStore.getWidth(), m_frameStore.getHeight(), 2, 0, GL_RED, GL_UNSIGNED_BYTE, m_frameStore.getPixelData());
+
+	glGenTextures(1, &m_distortionTexture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_distortionTexture);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RG32F, LEAP_DISTORTION_MATRIX_N, LEAP_DISTORTION_MATRIX_N, 2, 0, GL_RG, GL_FLOAT, m_frameStore.getDistortionData());
+
+	// without persistent mapping (GL 4.4) frames are uploaded from the FrameStore's own buffer, which costs the driver a copy
+	m_pixelBufferSupported = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+
+	if (!m_pixelBufferSupported) {
+		LOG_INFO("The driver can't map pixel buffers persistently, frames are uploaded from client memory");
+	}
+
+	updatePixelBuffer();
+
+	glGenQueries(k_gpuTimerFrames, m_uploadQueries);
+	glGenQueries(k_gpuTimerFrames, m_renderQueries);
+
+	updateFramebuffer();
+
+	return true;
+}
+
+void GraphicsManager::updateTexture()
+{
+	TRACE_SCOPE("GraphicsManager::updateTexture");
+
+	std::lock_guard<std::mutex> lock(m_updateMutex);
+
+	if (!m_frameChanged) {
+		return;
+	}
+
+	// a frame whose timer queries are still in flight isn't timed, nothing waits for the GPU
+	int timer = -1;
+
+	// without a GL context (see the pipeline benchmark) frames only go through the bookkeeping below
+	if (!m_headless) {
+		readGpuTimers();
+
+		if (!m_timerPending[m_nextTimer]) {
+			timer = m_nextTimer;
+			glBeginQuery(GL_TIME_ELAPSED, m_uploadQueries[timer]);
+		}
+
+		int64_t uploadStart = getHostTimeMicroseconds();
+
+		if (m_dimensionsChanged) {
+			glBindTexture(GL_TEXTURE_2D_ARRAY, m_videoTexture);
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R8, m_frameStore.getWidth(), m_frameStore.getHeight(), 2, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+
+			glBindTexture(GL_TEXTURE_2D, m_framebufferTexture);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_fbWidth, m_fbHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+
+			updatePixelBuffer();
+		}
+
+		uploadFrame();
+
+		if (m_distortionMapChanged) {
+			glBindTexture(GL_TEXTURE_2D_ARRAY, m_distortionTexture);
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, LEAP_DISTORTION_MATRIX_N, LEAP_DISTORTION_MATRIX_N, 2, GL_RG, GL_FLOAT, m_frameStore.getDistortionData());
+		}
+
+		m_uploadCpuHistograms[m_stereo].record((getHostTimeMicroseconds() - uploadStart) / 1000.0);
+
+		if (timer >= 0) {
+			glEndQuery(GL_TIME_ELAPSED);
+		}
+	}
+
+	m_timestamps = m_pendingTimestamps;
+	m_timestamps.stamp(FrameStage_Upload, m_clock->now());
+
+	m_wasUpdated = true;
+	m_dimensionsChanged = false;
+	m_distortionMapChanged = false;
+	m_frameChanged = false;
+
+	if (!m_headless) {
+		if (timer >= 0) {
+			glBeginQuery(GL_TIME_ELAPSED, m_renderQueries[timer]);
+		}
+
+		updateFramebuffer();
+
+		if (timer >= 0) {
+			glEndQuery(GL_TIME_ELAPSED);
+			m_timerStereo[timer] = m_stereo;
+			m_timerPending[timer] = true;
+			m_nextTimer = (m_nextTimer + 1) % k_gpuTimerFrames;
+		}
+	}
+
+	m_timestamps.stamp(FrameStage_Framebuffer, m_clock->now());
+}
+
+void GraphicsManager::setFrame(int width, int height, const uint8_t* left, const uint8_t* right, const FrameTimestamps& timestamps)
+{
+	TRACE_SCOPE("GraphicsManager::setFrame");
+
+	std::lock_guard<std::mutex> lock(m_updateMutex);
+	//std::cout << "width: " << width << " height: " << height << std::endl;
+
+	// the texture is recreated by the render thread. The single camera view only shows the left image, so the right one isn't copied
+	if (m_frameStore.setFrame(width, height, left, m_stereo ? right : nullptr)) {
+		m_dimensionsChanged = true;
+	}
+
+	m_frameChanged = true;
+
+	m_pendingTimestamps = timestamps;
+	m_pendingTimestamps.stamp(FrameStage_SetFrame, m_clock->now());
+}
+
+void GraphicsManager::setDistortionMap(int camera, float* data)
+{
+	std::lock_guard<std::mutex> lock(m_updateMutex);
+
+	m_distortionMapChanged = true;
+
+	LOG_DEBUG("Distortion map of camera {} changed", camera);
+
+	m_frameStore.setDistortionMap(camera, data);
+}
+
+void GraphicsManager::setDistortionMapActive(bool active)
+{
+	std::lock_guard<std::mutex> lock(m_updateMutex);
+
+	m_useDistortionMap = active;
+}
+
+bool GraphicsManager::getDistortionMapActive()
+{
+	std::lock_guard<std::mutex> lock(m_updateMutex);
+
+	return m_useDistortionMap;
+}
+
+void GraphicsManager::setStereo(bool stereo)
+{
+	std::lock_guard<std::mutex> lock(m_updateMutex);
+
+	if (m_stereo == stereo) {
+		return;
+	}
+
+	// the two camera images are placed side by side in stereo mode
+	m_stereo = stereo;
+	m_fbWidth = stereo ? k_cameraFramebufferWidth * 2 : k_cameraFramebufferWidth;
+
+	m_dimensionsChanged = true;
+	m_frameChanged = true;
+}
+
+bool GraphicsManager::getStereo()
+{
+	std::lock_guard<std::mutex> lock(m_updateMutex);
+
+	return m_stereo;
+}
+
+void GraphicsManager::setHandBlob(const HandBlob& blob)
+{
+	std::lock_guard<std::mutex> lock(m_updateMutex);
+
+	m_handBlob = blob;
+}
+
+void GraphicsManager::setHighlightEnabled(bool enabled)
+{
+	std::lock_guard<std::mutex> lock(m_updateMutex);
+
+	m_highlightEnabled = enabled;
+	m_frameChanged = true;
+}
+
+bool GraphicsManager::getHighlightEnabled()
+{
+	std::lock_guard<std::mutex> lock(m_updateMutex);
+
+	return m_highlightEnabled;
+}
+
+GLuint GraphicsManager::getVideoTexture()
+{
+	return m_framebufferTexture;
+}
+
+void GraphicsManager::setHeadless(bool headless)
+{
+	std::lock_guard<std::mutex> lock(m_updateMutex);
+
+	m_headless = headless;
+}
+
+void GraphicsManager::setClock(Clock* clock)
+{
+	std::lock_guard<std::mutex> lock(m_updateMutex);
+
+	m_clock = clock;
+}
+
+bool GraphicsManager::wasUpdated()
+{
+	std::lock_guard<std::mutex> lock(m_updateMutex);
+	return m_wasUpdated;
+}
+
+FrameTimestamps GraphicsManager::getFrameTimestamps()
+{
+	std::lock_guard<std::mutex> lock(m_updateMutex);
+	return m_timestamps;
+}
+
+void GraphicsManager::logStatistics()
+{
+	std::lock_guard<std::mutex> lock(m_updateMutex);
+
+	for (int stereo = 0; stereo < 2; stereo++) {
+		m_uploadCpuHistograms[stereo].log();
+		m_uploadGpuHistograms[stereo].log();
+		m_renderGpuHistograms[stereo].log();
+	}
+
+	// stereo is supposed to stay within 1.3 times the cost of mono, which can only be told once both were shown
+	if (m_renderGpuHistograms[0].getCount() > 0 && m_renderGpuHistograms[1].getCount() > 0) {
+		double mono = m_uploadGpuHistograms[0].getPercentile(50.0) + m_renderGpuHistograms[0].getPercentile(50.0);
+		double stereo = m_uploadGpuHistograms[1].getPercentile(50.0) + m_renderGpuHistograms[1].getPercentile(50.0);
+
+		LOG_INFO("Stereo upload and render take {} times the GPU time of mono (p50)", (mono > 0.0) ? stereo / mono : 0.0);
+	}
+}
+
+void GraphicsManager::updatePixelBuffer()
+{
+	if (!m_pixelBufferSupported) return;
+
+	size_t frameSize = static_cast<size_t>(m_frameStore.getWidth()) * m_frameStore.getHeight() * 2;
+
+	// a buffer that is big enough is kept, so the frame in it isn't lost. A bigger frame went into the FrameStore's own buffer
+	if (m_pixelBuffer != 0 && frameSize <= m_frameStore.getSlotSize()) return;
+
+	m_frameStore.attachSlots(nullptr, 0);
+
+	// the GPU may still read the old buffer, GL only deletes it once it is done
+	for (GLsync& fence : m_slotFences) {
+		if (fence != nullptr) {
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+
+	if (m_pixelBuffer != 0) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pixelBuffer);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		glDeleteBuffers(1, &m_pixelBuffer);
+		m_pixelBuffer = 0;
+	}
+
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	GLsizeiptr bufferSize = static_cast<GLsizeiptr>(frameSize * k_frameSlots);
+
+	glGenBuffers(1, &m_pixelBuffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pixelBuffer);
+	glBufferStorage(GL_PIXEL_UNPACK_BUFFER, bufferSize, nullptr, flags);
+	void* data = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bufferSize, flags);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	if (data == nullptr) {
+		LOG_WARNING("Could not map a pixel buffer of {} bytes, frames are uploaded from client memory", bufferSize);
+		glDeleteBuffers(1, &m_pixelBuffer);
+		m_pixelBuffer = 0;
+		m_pixelBufferSupported = false;
+		return;
+	}
+
+	m_frameStore.attachSlots(static_cast<uint8_t*>(data), frameSize);
+}
+
+void GraphicsManager::uploadFrame()
+{
+	// slots whose fence has signalled were read by the GPU and can take new frames
+	for (int slot = 0; slot < k_frameSlots; slot++) {
+		if (m_slotFences[slot] != nullptr && glClientWaitSync(m_slotFences[slot], 0, 0) != GL_TIMEOUT_EXPIRED) {
+			glDeleteSync(m_slotFences[slot]);
+			m_slotFences[slot] = nullptr;
+			m_frameStore.releaseSlot(slot);
+		}
+	}
+
+	// only layer 0 is sampled in mono mode
+	int layers = m_stereo ? 2 : 1;
+	int slot = m_frameStore.takeFrame();
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_videoTexture);
+
+	if (slot < 0) {
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, m_frameStore.getWidth(), m_frameStore.getHeight(), layers, GL_RED, GL_UNSIGNED_BYTE, m_frameStore.getPixelData());
+		return;
+	}
+
+	// the GPU copies the slot into the texture on its own, the CPU made its only copy in setFrame
+	const void* offset = reinterpret_cast<const void*>(slot * m_frameStore.getSlotSize());
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pixelBuffer);
+	glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, m_frameStore.getWidth(), m_frameStore.getHeight(), layers, GL_RED, GL_UNSIGNED_BYTE, offset);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	if (m_slotFences[slot] != nullptr) {
+		glDeleteSync(m_slotFences[slot]);
+	}
+
+	m_slotFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void GraphicsManager::readGpuTimers()
+{
+	for (int i = 0; i < k_gpuTimerFrames; i++) {
+		if (!m_timerPending[i]) continue;
+
+		// the render query ends last, once it is there the upload query is as well
+		GLuint available = 0;
+		glGetQueryObjectuiv(m_renderQueries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+
+		if (!available) continue;
+
+		GLuint64 uploadTime = 0;
+		GLuint64 renderTime = 0;
+		glGetQueryObjectui64v(m_uploadQueries[i], GL_QUERY_RESULT, &uploadTime);
+		glGetQueryObjectui64v(m_renderQueries[i], GL_QUERY_RESULT, &renderTime);
+
+		m_uploadGpuHistograms[m_timerStereo[i]].record(uploadTime / 1e6);
+		m_renderGpuHistograms[m_timerStereo[i]].record(renderTime / 1e6);
+		m_timerPending[i] = false;
+	}
+}
+
+void GraphicsManager::updateFramebuffer()
+{
+	TRACE_SCOPE("GraphicsManager::updateFramebuffer");
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, m_fbWidth, m_fbHeight);
+
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	glUseProgram(m_shaderProgram);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_videoTexture);
+	glUniform1i(m_textureSamplerID, 0); // set the sampler to use texture unit 0
+
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_distortionTexture);
+	glUniform1i(m_distortionTextureSamplerID, 1); // set the distortion sampler to use texture unit 1
+
+	glActiveTexture(GL_TEXTURE0);
+
+	glUniform1i(m_useDistortionMapID, m_useDistortionMap);
+	glUniform1i(m_stereoID, m_stereo);
+	glUniform1i(m_showHighlightID, m_highlightEnabled && m_handBlob.found);
+	glUniform4f(m_highlightRectID, m_handBlob.minX, m_handBlob.minY, m_handBlob.maxX, m_handBlob.maxY);
+
+	glEnableVertexAttribArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, m_fullscreenQuadBuffer);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+	glEnableVertexAttribArray(1);
+	glBindBuffer(GL_ARRAY_BUFFER, m_fullscreenQuadUVs);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+	glDrawArrays(GL_TRIANGLES, 0, 6);
+	glDisableVertexAttribArray(0);
+	glDisableVertexAttribArray(1);
+
+	glEnd();
+	glFlush();
+}
+
+void GraphicsManager::setFramebufferSize(int width, int height)
+{
+	std::lock_guard<std::mutex> lock(m_updateMutex);
+
+	m_fbWidth = width;
+	m_fbHeight = height;
+
+	m_dimensionsChanged = true;
+}
@@ -1,64 +1,101 @@
-#pragma once
-#include <GL/glew.h>
-#include <iostream>
-#include <mutex>
-#include <cassert>
-
-#include "OVROverlayController.h"
-
-extern "C" {
-	#include <LeapC.h>
-}
-
-class GraphicsManager
-{
-public:
-	static GraphicsManager* getInstance();
-
-	GraphicsManager();
-	~GraphicsManager();
-
-	bool init();
-	void updateTexture();
-	void setFrame(int width, int height, uint8_t* data);
-	void setDistortionMap(float* data);
-	void setDistortionMapActive(bool active);
-	bool getDistortionMapActive();
-	GLuint getVideoTexture();
-	bool wasUpdated();
-
-private:
-	void updateFramebuffer();
-	void setFramebufferSize(int width, int height);
-
-	GLuint m_videoTexture { 0 };
-	GLuint m_distortionTexture{ 0 };
-
-	uint8_t* m_pixelData { nullptr };
-	float* m_distortionPixelData { nullptr };
-	int m_width { 100 };
-	int m_height { 100 };
-	int m_fbWidth { 640 };
-	int m_fbHeight { 480 };
-	int m_useDistortionMap { false };
-
-	bool m_wasUpdated { false };
-	bool m_frameChanged { false };
-	bool m_dimensionsChanged { false };
-	bool m_distortionMapChanged { false };
-	std::mutex m_updateMutex;
-
-	// opengl stuff
-	GLuint m_framebuffer { 0 };
-	GLuint m_framebufferTexture { 0 };
-	GLuint m_fullscreenQuadVAO { 0 };
-	GLuint m_fullscreenQuadBuffer { 0 };
-	GLuint m_fullscreenQuadUVs { 0 };
-	GLuint m_vertexShader { 0 };
-	GLuint m_fragmentShader { 0 };
-	GLuint m_shaderProgram { 0 };
-	GLuint m_textureSamplerID { 0 };
-	GLuint m_distortionTextureSamplerID { 0 };
-	GLuint m_useDistortionMapID { 0 };
-};
-
+#pragma once
+#include <GL/glew.h>
+#include <iostream>
+#include <mutex>
+#include <cassert>
+
+#include "OVROverlayController.h"
+#include "FrameStore.h"
+#include "LatencyTracker.h"
+#include "Clock.h"
+#include "BlobTracker.h"
+#include "Histogram.h"
+#include "Trace.h"
+#include "Log.h"
+
+const int k_cameraFramebufferWidth = 640; // width of one camera image in the framebuffer
+const int k_gpuTimerFrames = 4; // frames whose GPU timings are in flight, they are read back later instead of waited for
+
+class GraphicsManager
+{
+public:
+	static GraphicsManager* getInstance();
+
+	GraphicsManager();
+
+	bool init();
+	void updateTexture();
+	void setFrame(int width, int height, const uint8_t* left, const uint8_t* right, const FrameTimestamps& timestamps);
+	void setDistortionMap(int camera, float* data);
+	void setDistortionMapActive(bool active);
+	bool getDistortionMapActive();
+	void setStereo(bool stereo);
+	bool getStereo();
+	void setHandBlob(const HandBlob& blob);
+	void setHighlightEnabled(bool enabled);
+	bool getHighlightEnabled();
+	GLuint getVideoTexture();
+	void setHeadless(bool headless);
+	void setClock(Clock* clock);
+	bool wasUpdated();
+	FrameTimestamps getFrameTimestamps();
+	void logStatistics();
+
+private:
+	void updateFramebuffer();
+	void setFramebufferSize(int width, int height);
+	void updatePixelBuffer();
+	void uploadFrame();
+	void readGpuTimers();
+
+	GLuint m_videoTexture { 0 };
+	GLuint m_distortionTexture{ 0 };
+
+	FrameStore m_frameStore;
+	int m_fbWidth { k_cameraFramebufferWidth * 2 };
+	int m_fbHeight { 480 };
+	int m_useDistortionMap { false };
+	bool m_stereo { true };
+	bool m_highlightEnabled { false };
+	HandBlob m_handBlob;
+	FrameTimestamps m_pendingTimestamps; // timestamps of the frame in m_frameStore
+	FrameTimestamps m_timestamps; // timestamps of the frame currently in the framebuffer
+
+	bool m_wasUpdated { false };
+	bool m_headless { false }; // no GL context, frames are only passed along
+	Clock* m_clock;
+	bool m_frameChanged { false };
+	bool m_dimensionsChanged { false };
+	bool m_distortionMapChanged { false };
+	std::mutex m_updateMutex;
+
+	// opengl stuff
+	GLuint m_framebuffer { 0 };
+	GLuint m_framebufferTexture { 0 };
+	GLuint m_fullscreenQuadVAO { 0 };
+	GLuint m_fullscreenQuadBuffer { 0 };
+	GLuint m_fullscreenQuadUVs { 0 };
+	GLuint m_shaderProgram { 0 };
+	GLuint m_textureSamplerID { 0 };
+	GLuint m_distortionTextureSamplerID { 0 };
+	GLuint m_useDistortionMapID { 0 };
+	GLuint m_stereoID { 0 };
+	GLuint m_showHighlightID { 0 };
+	GLuint m_highlightRectID { 0 };
+
+	// persistently mapped, the FrameStore copies frames straight into its slots and the GPU reads them from there
+	bool m_pixelBufferSupported { false };
+	GLuint m_pixelBuffer { 0 };
+	GLsync m_slotFences[k_frameSlots] {}; // signalled once the GPU has read the slot
+
+	// upload and framebuffer render times of mono (0) and stereo (1) frames
+	GLuint m_uploadQueries[k_gpuTimerFrames] {};
+	GLuint m_renderQueries[k_gpuTimerFrames] {};
+	bool m_timerStereo[k_gpuTimerFrames] {};
+	bool m_timerPending[k_gpuTimerFrames] {};
+	int m_nextTimer { 0 };
+	Histogram m_uploadCpuHistograms[2] { { "Texture upload CPU, mono (ms)", 0.0, 1.0, 200 }, { "Texture upload CPU, stereo (ms)", 0.0, 1.0, 200 } };
+	Histogram m_uploadGpuHistograms[2] { { "Texture upload GPU, mono (ms)", 0.0, 1.0, 200 }, { "Texture upload GPU, stereo (ms)", 0.0, 1.0, 200 } };
+	Histogram m_renderGpuHistograms[2] { { "Framebuffer render GPU, mono (ms)", 0.0, 1.0, 200 }, { "Framebuffer render GPU, stereo (ms)", 0.0, 1.0, 200 } };
+};
+
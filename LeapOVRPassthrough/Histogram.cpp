@@ -0,0 +1,90 @@
+#include "Histogram.h"
+#include "Log.h"
+
+Histogram::Histogram(const std::string& name, double lowerBound, double upperBound, uint32_t bucketCount) :
+	m_name(name),
+	m_lowerBound(lowerBound),
+	m_upperBound(upperBound),
+	m_bucketWidth((upperBound - lowerBound) / bucketCount),
+	m_bucketCount(bucketCount),
+	m_buckets(new std::atomic<uint64_t>[bucketCount])
+{
+	reset();
+}
+
+void Histogram::record(double value)
+{
+	if (value < m_lowerBound) {
+		m_underflow.fetch_add(1, std::memory_order_relaxed);
+	} else if (value >= m_upperBound) {
+		m_overflow.fetch_add(1, std::memory_order_relaxed);
+	} else {
+		uint32_t index = static_cast<uint32_t>((value - m_lowerBound) / m_bucketWidth);
+		m_buckets[(index < m_bucketCount) ? index : m_bucketCount - 1].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	m_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Histogram::reset()
+{
+	for (uint32_t i = 0; i < m_bucketCount; i++) {
+		m_buckets[i].store(0, std::memory_order_relaxed);
+	}
+
+	m_underflow.store(0, std::memory_order_relaxed);
+	m_overflow.store(0, std::memory_order_relaxed);
+	m_count.store(0, std::memory_order_relaxed);
+}
+
+uint64_t Histogram::getCount()
+{
+	return m_count.load(std::memory_order_relaxed);
+}
+
+double Histogram::getPercentile(double percentile)
+{
+	uint64_t count = getCount();
+
+	if (count == 0) {
+		return 0.0;
+	}
+
+	uint64_t target = static_cast<uint64_t>(percentile / 100.0 * count);
+	uint64_t seen = m_underflow.load(std::memory_order_relaxed);
+
+	if (seen > target) {
+		return m_lowerBound;
+	}
+
+	for (uint32_t i = 0; i < m_bucketCount; i++) {
+		seen += m_buckets[i].load(std::memory_order_relaxed);
+
+		if (seen > target) {
+			return m_lowerBound + (i + 1) * m_bucketWidth; // upper edge of the bucket
+		}
+	}
+
+	return m_upperBound;
+}
+
+void Histogram::log()
+{
+	uint64_t count = getCount();
+
+	if (count == 0) {
+		LOG_INFO("{}: no samples", m_name);
+		return;
+	}
+
+	LOG_INFO("{}: {} samples, p50 {}, p90 {}, p99 {}", m_name, count, getPercentile(50.0), getPercentile(90.0), getPercentile(99.0));
+	LOG_INFO("  < {}: {}, >= {}: {}", m_lowerBound, m_underflow.load(std::memory_order_relaxed), m_upperBound, m_overflow.load(std::memory_order_relaxed));
+
+	for (uint32_t i = 0; i < m_bucketCount; i++) {
+		uint64_t bucket = m_buckets[i].load(std::memory_order_relaxed);
+
+		if (bucket > 0) {
+			LOG_INFO("  [{}, {}): {}", m_lowerBound + i * m_bucketWidth, m_lowerBound + (i + 1) * m_bucketWidth, bucket);
+		}
+	}
+}
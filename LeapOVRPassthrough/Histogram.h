@@ -0,0 +1,33 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <string>
+#include <cstdint>
+
+// Fixed-range histogram with linear buckets.
+// record() only does relaxed atomic increments, so it can be called from any thread without locking.
+class Histogram
+{
+public:
+	Histogram(const std::string& name, double lowerBound, double upperBound, uint32_t bucketCount);
+
+	void record(double value);
+	void reset();
+
+	uint64_t getCount();
+	double getPercentile(double percentile);
+
+	void log();
+
+private:
+	std::string m_name;
+	double m_lowerBound;
+	double m_upperBound;
+	double m_bucketWidth;
+	uint32_t m_bucketCount;
+
+	std::unique_ptr<std::atomic<uint64_t>[]> m_buckets;
+	std::atomic<uint64_t> m_underflow { 0 };
+	std::atomic<uint64_t> m_overflow { 0 };
+	std::atomic<uint64_t> m_count { 0 };
+};
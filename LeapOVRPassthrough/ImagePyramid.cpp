@@ -0,0 +1,158 @@
+#include "ImagePyramid.h"
+#include "Log.h"
+#include "Trace.h"
+
+#include <cassert>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define PYRAMID_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+// (a + b + c + d + 2) / 4 for every 2x2 block of a row pair, from column x on
+void halveRowsScalar(const uint8_t* row0, const uint8_t* row1, uint8_t* out, int x, int width) {
+	for (; x < width; x++) {
+		out[x] = static_cast<uint8_t>((row0[2 * x] + row0[2 * x + 1] + row1[2 * x] + row1[2 * x + 1] + 2) / 4);
+	}
+}
+
+void halveImageScalar(const PyramidLevel& source, uint8_t* target, int width, int height) {
+	for (int y = 0; y < height; y++) {
+		const uint8_t* row0 = source.data + (2 * y) * source.width;
+		halveRowsScalar(row0, row0 + source.width, target + y * width, 0, width);
+	}
+}
+
+void halveImage(const PyramidLevel& source, uint8_t* target, int width, int height) {
+	for (int y = 0; y < height; y++) {
+		const uint8_t* row0 = source.data + (2 * y) * source.width;
+		const uint8_t* row1 = row0 + source.width;
+		uint8_t* out = target + y * width;
+
+		int x = 0;
+
+#ifdef PYRAMID_USE_SSE2
+		// the four pixels are summed in 16 bit and rounded once, exactly like the scalar tail. Averaging the rows with
+		// _mm_avg_epu8 first would round twice and give some blocks a different value depending on their column
+		const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+		const __m128i two = _mm_set1_epi16(2);
+
+		for (; x + 16 <= width; x += 16) {
+			__m128i a0 = _mm_loadu_si128((const __m128i*)(row0 + 2 * x));
+			__m128i a1 = _mm_loadu_si128((const __m128i*)(row1 + 2 * x));
+			__m128i b0 = _mm_loadu_si128((const __m128i*)(row0 + 2 * x + 16));
+			__m128i b1 = _mm_loadu_si128((const __m128i*)(row1 + 2 * x + 16));
+
+			__m128i a = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a0, lowBytes), _mm_srli_epi16(a0, 8)),
+				_mm_add_epi16(_mm_and_si128(a1, lowBytes), _mm_srli_epi16(a1, 8)));
+			__m128i b = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(b0, lowBytes), _mm_srli_epi16(b0, 8)),
+				_mm_add_epi16(_mm_and_si128(b1, lowBytes), _mm_srli_epi16(b1, 8)));
+
+			a = _mm_srli_epi16(_mm_add_epi16(a, two), 2);
+			b = _mm_srli_epi16(_mm_add_epi16(b, two), 2);
+
+			_mm_storeu_si128((__m128i*)(out + x), _mm_packus_epi16(a, b));
+		}
+#endif
+
+		halveRowsScalar(row0, row1, out, x, width);
+	}
+}
+
+int64_t ImagePyramid::getFrameId() const
+{
+	return m_frameId;
+}
+
+PyramidLevel ImagePyramid::getLevel(int camera, int level) const
+{
+	assert(level > 0);
+
+	const PyramidLevel& result = m_levels[camera][level];
+	const PyramidLevel& full = m_levels[camera][0];
+
+	m_pool->m_readBytes.fetch_add(result.width * result.height, std::memory_order_relaxed);
+	m_pool->m_fullResolutionBytes.fetch_add(full.width * full.height, std::memory_order_relaxed);
+
+	return result;
+}
+
+void ImagePyramid::build(int64_t frameId, int width, int height, const uint8_t* left, const uint8_t* right)
+{
+	TRACE_SCOPE("ImagePyramid::build");
+
+	m_frameId = frameId;
+	uint64_t buildBytes = 0;
+
+	const uint8_t* images[k_pyramidCameras] = { left, right };
+
+	for (int camera = 0; camera < k_pyramidCameras; camera++) {
+		PyramidLevel fullResolution = { width, height, images[camera] };
+		m_levels[camera][0] = { width, height, nullptr };
+
+		for (int level = 1; level < k_pyramidLevels; level++) {
+			const PyramidLevel& source = (level == 1) ? fullResolution : m_levels[camera][level - 1];
+			int levelWidth = source.width / 2;
+			int levelHeight = source.height / 2;
+
+			// only reallocates when the image size changes
+			m_storage[camera][level].resize(levelWidth * levelHeight);
+			halveImage(source, m_storage[camera][level].data(), levelWidth, levelHeight);
+
+			m_levels[camera][level] = { levelWidth, levelHeight, m_storage[camera][level].data() };
+			buildBytes += source.width * source.height + levelWidth * levelHeight;
+		}
+	}
+
+	m_pool->m_buildBytes.fetch_add(buildBytes, std::memory_order_relaxed);
+}
+
+PyramidPool::~PyramidPool()
+{
+	// pyramids still referenced somewhere at this point are leaked rather than freed under their owner
+	for (ImagePyramid* pyramid : m_free) {
+		delete pyramid;
+	}
+}
+
+std::shared_ptr<const ImagePyramid> PyramidPool::build(int64_t frameId, int width, int height, const uint8_t* left, const uint8_t* right)
+{
+	ImagePyramid* pyramid = nullptr;
+
+	{
+		std::lock_guard<std::mutex> lock(m_freeMutex);
+
+		if (!m_free.empty()) {
+			pyramid = m_free.back();
+			m_free.pop_back();
+		} else {
+			pyramid = new ImagePyramid();
+			pyramid->m_pool = this;
+			m_allocated++;
+		}
+	}
+
+	pyramid->build(frameId, width, height, left, right);
+
+	// the last reference hands the buffers back instead of freeing them
+	return std::shared_ptr<const ImagePyramid>(pyramid, [this](const ImagePyramid* released) {
+		std::lock_guard<std::mutex> lock(m_freeMutex);
+		m_free.push_back(const_cast<ImagePyramid*>(released));
+	});
+}
+
+void PyramidPool::logStatistics()
+{
+	uint64_t buildBytes = m_buildBytes.load(std::memory_order_relaxed);
+	uint64_t readBytes = m_readBytes.load(std::memory_order_relaxed);
+	uint64_t fullResolutionBytes = m_fullResolutionBytes.load(std::memory_order_relaxed);
+
+	uint32_t allocated;
+	{
+		std::lock_guard<std::mutex> lock(m_freeMutex);
+		allocated = m_allocated;
+	}
+
+	LOG_INFO("Image pyramid: {} buffers, {} MB built, {} MB read by detectors instead of {} MB at full resolution ({} MB saved)",
+		allocated, buildBytes / 1e6, readBytes / 1e6, fullResolutionBytes / 1e6, (static_cast<double>(fullResolutionBytes) - readBytes - buildBytes) / 1e6);
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+const int k_pyramidLevels = 4; // full resolution, 1/2, 1/4 and 1/8
+const int k_pyramidCameras = 2;
+
+struct PyramidLevel {
+	int width { 0 };
+	int height { 0 };
+	const uint8_t* data { nullptr };
+};
+
+class PyramidPool;
+
+// 2x2 box filter from one level into the next, every target pixel is (a + b + c + d + 2) / 4. halveImage uses SSE2
+// where available and has to give exactly the same result as halveImageScalar for every width
+void halveImage(const PyramidLevel& source, uint8_t* target, int width, int height);
+void halveImageScalar(const PyramidLevel& source, uint8_t* target, int width, int height);
+
+// Box filtered downscaled versions of both camera images of one frame.
+// Pyramids are handed out as shared_ptr<const ImagePyramid> and never change after build(), so any thread may read them.
+// Level 0 only has the full resolution size and no data: the camera image it was built from belongs to LeapC or the frame
+// source and is reused for the next frame, while pyramids are held on to for longer (e.g. the MotionDetector's previous one).
+class ImagePyramid
+{
+	friend class PyramidPool;
+
+public:
+	int64_t getFrameId() const;
+	PyramidLevel getLevel(int camera, int level) const; // level 1 and up
+
+private:
+	void build(int64_t frameId, int width, int height, const uint8_t* left, const uint8_t* right);
+
+	PyramidPool* m_pool { nullptr };
+	int64_t m_frameId { -1 };
+	PyramidLevel m_levels[k_pyramidCameras][k_pyramidLevels];
+	std::vector<uint8_t> m_storage[k_pyramidCameras][k_pyramidLevels];
+};
+
+// Recycles pyramid buffers so that steady state frames don't allocate.
+// Also counts how many bytes detectors read from the levels compared to reading the full images every time.
+class PyramidPool
+{
+	friend class ImagePyramid;
+
+public:
+	~PyramidPool();
+
+	std::shared_ptr<const ImagePyramid> build(int64_t frameId, int width, int height, const uint8_t* left, const uint8_t* right);
+
+	void logStatistics();
+
+private:
+	std::mutex m_freeMutex;
+	std::vector<ImagePyramid*> m_free;
+	uint32_t m_allocated { 0 };
+
+	std::atomic<uint64_t> m_buildBytes { 0 }; // read and written while building the levels
+	std::atomic<uint64_t> m_readBytes { 0 }; // size of the levels detectors asked for
+	std::atomic<uint64_t> m_fullResolutionBytes { 0 }; // what those reads would have been at full resolution
+};
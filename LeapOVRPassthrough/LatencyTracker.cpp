@@ -0,0 +1,66 @@
+#include "LatencyTracker.h"
+
+const char* stageNames[FrameStage_Count] = {
+	"Capture",
+	"Capture -> Dequeue (ms)",
+	"Dequeue -> Analyzed (ms)",
+	"Analyzed -> SetFrame (ms)",
+	"SetFrame -> Upload (ms)",
+	"Upload -> Framebuffer (ms)",
+	"Framebuffer -> Submit (ms)",
+};
+
+LatencyTracker* s_latencyTracker = nullptr;
+
+LatencyTracker* LatencyTracker::getInstance()
+{
+	if (s_latencyTracker == nullptr) {
+		s_latencyTracker = new LatencyTracker();
+	}
+
+	return s_latencyTracker;
+}
+
+LatencyTracker::LatencyTracker() :
+	m_stageHistograms(),
+	m_totalHistogram("Capture -> Submit (ms)", 0.0, 100.0, 200)
+{
+	for (int i = FrameStage_Dequeue; i < FrameStage_Count; i++) {
+		m_stageHistograms[i] = new Histogram(stageNames[i], 0.0, 50.0, 200);
+	}
+}
+
+void LatencyTracker::recordFrame(const FrameTimestamps& timestamps)
+{
+	// a frame stays in the texture until the next one arrives and may be submitted several times, only count it once
+	if (timestamps.frameId == m_lastFrameId) {
+		return;
+	}
+
+	m_lastFrameId = timestamps.frameId;
+
+	for (int i = FrameStage_Dequeue; i < FrameStage_Count; i++) {
+		m_stageHistograms[i]->record((timestamps.stages[i] - timestamps.stages[i - 1]) / 1000.0);
+	}
+
+	m_totalHistogram.record((timestamps.stages[FrameStage_Submit] - timestamps.stages[FrameStage_Capture]) / 1000.0);
+}
+
+void LatencyTracker::logStatistics()
+{
+	LOG_INFO("Frame latency:");
+	m_totalHistogram.log();
+
+	for (int i = FrameStage_Dequeue; i < FrameStage_Count; i++) {
+		m_stageHistograms[i]->log();
+	}
+}
+
+void LatencyTracker::reset()
+{
+	m_totalHistogram.reset();
+
+	for (int i = FrameStage_Dequeue; i < FrameStage_Count; i++) {
+		m_stageHistograms[i]->reset();
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+
+#include "Histogram.h"
+#include "Log.h"
+#include "utils.h"
+
+enum FrameStage {
+	FrameStage_Capture = 0, // camera exposure, rebased from the leap clock
+	FrameStage_Dequeue, // LeapPollConnection returned the image event
+	FrameStage_Analyzed, // swipe detection finished
+	FrameStage_SetFrame, // pixels copied into the GraphicsManager
+	FrameStage_Upload, // texture upload issued
+	FrameStage_Framebuffer, // updateFramebuffer finished
+	FrameStage_Submit, // SetOverlayTexture returned
+	FrameStage_Count
+};
+
+// timestamps of a single frame as it moves through the pipeline, on the pipeline's Clock
+struct FrameTimestamps {
+	int64_t frameId { 0 };
+	int64_t stages[FrameStage_Count] { 0 };
+
+	void stamp(FrameStage stage, int64_t time) {
+		stages[stage] = time;
+	}
+};
+
+class LatencyTracker
+{
+public:
+	static LatencyTracker* getInstance();
+
+	LatencyTracker();
+
+	void recordFrame(const FrameTimestamps& timestamps);
+	void logStatistics();
+	void reset();
+
+private:
+	Histogram* m_stageHistograms[FrameStage_Count]; // latency from the previous stage into this one, index 0 is unused
+	Histogram m_totalHistogram;
+	int64_t m_lastFrameId { -1 };
+};
@@ -1,251 +1,736 @@
-#include "LeapHandler.h"
-#include "utils.h"
-
-std::map<eLeapRS, std::string> errorMap = {
-	{ eLeapRS_Success, "Success" },
-	{ eLeapRS_UnknownError, "Unknown Error" },
-	{ eLeapRS_InvalidArgument, "Invalid Argument" },
-	{ eLeapRS_InsufficientResources, "Insufficient Resources" },
-	{ eLeapRS_InsufficientBuffer, "Insufficient Buffer" },
-	{ eLeapRS_Timeout, "Timeout" },
-	{ eLeapRS_NotConnected, "Not Connected" },
-	{ eLeapRS_HandshakeIncomplete, "Handshake Incomplete" },
-	{ eLeapRS_BufferSizeOverflow, "Buffer Size Overflow" },
-	{ eLeapRS_ProtocolError, "Protocol Error" },
-	{ eLeapRS_InvalidClientID, "Invalid Client ID" },
-	{ eLeapRS_UnexpectedClosed, "Unexpected Closed" },
-	{ eLeapRS_UnknownImageFrameRequest, "Unknown Image Frame Request" },
-	{ eLeapRS_UnknownTrackingFrameID, "Unknown Tracking Frame ID" },
-	{ eLeapRS_RoutineIsNotSeer, "Routine Is Not Seer" },
-	{ eLeapRS_TimestampTooEarly, "Timestamp Too Early" },
-	{ eLeapRS_ConcurrentPoll, "Concurrent Poll" },
-	{ eLeapRS_NotAvailable, "Not Available" },
-	{ eLeapRS_NotStreaming, "Not Streaming" },
-	{ eLeapRS_CannotOpenDevice, "Cannot Open Device" },
-};
-
-std::map<eLeapEventType, std::string> eventMsgMap = {
-	{ eLeapEventType_None, "None" },
-	{ eLeapEventType_Connection, "Connection" },
-	{ eLeapEventType_ConnectionLost, "Connection Lost" },
-	{ eLeapEventType_Device, "Device " },
-	{ eLeapEventType_DeviceFailure, "Device Failure" },
-	{ eLeapEventType_Policy, "Policy" },
-	{ eLeapEventType_Tracking, "Tracking" },
-	{ eLeapEventType_ImageRequestError, "Image Request Error" },
-	{ eLeapEventType_ImageComplete, "Image Complete" },
-	{ eLeapEventType_LogEvent, "Log Event" },
-	{ eLeapEventType_DeviceLost, "Device Lost" },
-	{ eLeapEventType_ConfigResponse, "Config Response" },
-	{ eLeapEventType_ConfigChange, "Config Change" },
-	{ eLeapEventType_DeviceStatusChange, "Device Status Change" },
-	{ eLeapEventType_Image, "Image" },
-	{ eLeapEventType_PointMappingChange, "Point Mapping Change" },
-	{ eLeapEventType_LogEvents, "Log Events" },
-};
-
-void printLeapRSError(eLeapRS result) {
-	std::stringstream output;
-	output << "LeapC Error: " << errorMap[result] << " " << result << std::endl;
-	outputStringStream(output);
-}
-
-LeapHandler* s_sharedInstance = nullptr;
-
-LeapHandler* LeapHandler::getInstance()
-{
-	if (s_sharedInstance == nullptr) {
-		s_sharedInstance = new LeapHandler();
-	}
-
-	return s_sharedInstance;
-}
-
-LeapHandler::LeapHandler() :
-	m_brightUpperPixelsRingbuffer(std::vector<uint32_t>(50)),
-	m_lastSwipeDetected( steady_clock::now() ),
-	m_connection( nullptr )
-{
-}
-
-
-LeapHandler::~LeapHandler()
-{
-}
-
-bool LeapHandler::openConnection()
-{
-	if (m_started) {
-		return false;
-	}
-
-	eLeapRS result = LeapCreateConnection(NULL, &m_connection);
-
-	if (result != eLeapRS_Success) {
-		printLeapRSError(result);
-		m_started = false;
-		return false;
-	}
-
-	result = LeapOpenConnection(m_connection);
-	if (result != eLeapRS_Success) {
-		printLeapRSError(result);
-		m_started = false;
-		return false;
-	}
-
-	LEAP_CONNECTION_MESSAGE msg;
-	result = LeapPollConnection(m_connection, 1000, &msg);
-	if (result != eLeapRS_Success) {
-		printLeapRSError(result);
-		m_started = false;
-		return false;
-	}
-
-	result = LeapSetPolicyFlags(m_connection, eLeapPolicyFlag_Images | eLeapPolicyFlag_OptimizeHMD, 0);
-	if (result != eLeapRS_Success) {
-		printLeapRSError(result);
-		m_started = false;
-		return false;
-	}
-
-	m_started = true;
-	m_pollingThread = std::thread([this]() {
-		this->pollController();
-	});
-			
-	return true;
-}
-
-bool LeapHandler::swipeDetected()
-{
-	bool result = m_swipeDetected;
-	m_swipeDetected = false;
-	return result;
-}
-
-void LeapHandler::join()
-{
-	if (m_started && m_pollingThread.joinable()) {
-		m_started = false;
-		m_pollingThread.join();
-	}
-}
-
-void LeapHandler::pollController()
-{
-	eLeapRS result;
-	LEAP_CONNECTION_MESSAGE msg;
-	std::stringstream output;
-
-	while (m_started) {
-		result = LeapPollConnection(m_connection, 1000, &msg);
-
-		//std::cout << eventMsgMap[msg.type] << std::endl;
-
-		switch (msg.type) {
-			case eLeapEventType_LogEvents: 
-			{
-				const LEAP_LOG_EVENTS* events = msg.log_events;
-				//std::cout << "Messages (" << events->nEvents << "):" << std::endl;
-
-				for (uint32_t i = 0; i < events->nEvents; i++) {
-					LEAP_LOG_EVENT evt = events->events[i];
-
-					output << "[" << evt.timestamp << "] " << evt.message << std::endl;
-					outputStringStream(output);
-				}
-
-				break;
-			}
-			case eLeapEventType_LogEvent:
-			{
-				const LEAP_LOG_EVENT* evt = msg.log_event;
-			
-				output << "[" << evt->timestamp << "] " << evt->message << std::endl;
-				outputStringStream(output);
-				break;
-			}
-			case eLeapEventType_Image: 
-			{
-				const LEAP_IMAGE_EVENT* evt = msg.image_event;
-				GraphicsManager* graphicsManager = GraphicsManager::getInstance();
-
-				updateBrightUpperPixels(evt->image[0].properties.width, evt->image[0].properties.height, (uint8_t*)evt->image[0].data + evt->image[0].offset);
-
-				if (countLastBUPIncreasing() >= 5) {
-					auto cur_ts = steady_clock::now();
-
-					if (std::chrono::duration_cast<std::chrono::seconds>(cur_ts - m_lastSwipeDetected) > 2 * std::chrono::seconds()) {
-						m_lastSwipeDetected = cur_ts;
-						m_swipeDetected = true;
-					}
-				}
-
-				graphicsManager->setFrame(evt->image[0].properties.width, evt->image[0].properties.height, (uint8_t*)evt->image[0].data + evt->image[0].offset);
-
-				if (evt->image[0].matrix_version != m_lastDistortionMatrixVersion) {
-					m_lastDistortionMatrixVersion = evt->image[0].matrix_version;
-					graphicsManager->setDistortionMap((float*)evt->image[0].distortion_matrix);
-				}
-
-				break;
-			}
-		}
-	}
-}
-
-void LeapHandler::updateBrightUpperPixels(int width, int height, uint8_t * image)
-{
-	const uint8_t threshold = 100;
-
-	uint32_t count = 0;
-
-	for (int y = 0; y < height / 2; y++) {
-		for (int x = 0; x < width; x++) {
-			int i = y * width + x;
-
-			if (image[i] >= threshold) {
-				count++;
-			}
-		}
-	}
-
-	//std::cout << "count: " << count << std::endl;
-
-	m_brightUpperPixelsRingbuffer[m_bupRBNextIndex] = count;
-	m_bupRBNextIndex++;
-
-	if (m_bupRBNextIndex == m_brightUpperPixelsRingbuffer.size()) {
-		m_bupRBNextIndex = 0;
-	}
-}
-
-uint32_t LeapHandler::countLastBUPIncreasing()
-{
-	const uint32_t threshold = 30000;
-
-	uint32_t result = 0;
-
-	uint32_t last = UINT32_MAX;
-
-	for (int i = 1; i <= m_brightUpperPixelsRingbuffer.size(); i++) {
-		int index = m_bupRBNextIndex - i;
-		index = (index < 0) ? index + static_cast<int>(m_brightUpperPixelsRingbuffer.size()) : index;
-
-		uint32_t value = m_brightUpperPixelsRingbuffer[index];
-
-		if (value < threshold) {
-			break;
-		}
-
-		if (value < last) {
-			result++;
-			last = value;
-		} else {
-			break;
-		}
-	}
-
-	return result;
-}
+#include "LeapHandler.h"
+#include "utils.h"
+
+struct LeapResultName {
+	eLeapRS result;
+	const char* name;
+};
+
+struct LeapEventTypeName {
+	eLeapEventType type;
+	const char* name;
+};
+
+constexpr LeapResultName leapResultNames[] = {
+	{ eLeapRS_Success, "Success" },
+	{ eLeapRS_UnknownError, "Unknown Error" },
+	{ eLeapRS_InvalidArgument, "Invalid Argument" },
+	{ eLeapRS_InsufficientResources, "Insufficient Resources" },
+	{ eLeapRS_InsufficientBuffer, "Insufficient Buffer" },
+	{ eLeapRS_Timeout, "Timeout" },
+	{ eLeapRS_NotConnected, "Not Connected" },
+	{ eLeapRS_HandshakeIncomplete, "Handshake Incomplete" },
+	{ eLeapRS_BufferSizeOverflow, "Buffer Size Overflow" },
+	{ eLeapRS_ProtocolError, "Protocol Error" },
+	{ eLeapRS_InvalidClientID, "Invalid Client ID" },
+	{ eLeapRS_UnexpectedClosed, "Unexpected Closed" },
+	{ eLeapRS_UnknownImageFrameRequest, "Unknown Image Frame Request" },
+	{ eLeapRS_UnknownTrackingFrameID, "Unknown Tracking Frame ID" },
+	{ eLeapRS_RoutineIsNotSeer, "Routine Is Not Seer" },
+	{ eLeapRS_TimestampTooEarly, "Timestamp Too Early" },
+	{ eLeapRS_ConcurrentPoll, "Concurrent Poll" },
+	{ eLeapRS_NotAvailable, "Not Available" },
+	{ eLeapRS_NotStreaming, "Not Streaming" },
+	{ eLeapRS_CannotOpenDevice, "Cannot Open Device" },
+};
+
+constexpr LeapEventTypeName leapEventTypeNames[] = {
+	{ eLeapEventType_None, "None" },
+	{ eLeapEventType_Connection, "Connection" },
+	{ eLeapEventType_ConnectionLost, "Connection Lost" },
+	{ eLeapEventType_Device, "Device " },
+	{ eLeapEventType_DeviceFailure, "Device Failure" },
+	{ eLeapEventType_Policy, "Policy" },
+	{ eLeapEventType_Tracking, "Tracking" },
+	{ eLeapEventType_ImageRequestError, "Image Request Error" },
+	{ eLeapEventType_ImageComplete, "Image Complete" },
+	{ eLeapEventType_LogEvent, "Log Event" },
+	{ eLeapEventType_DeviceLost, "Device Lost" },
+	{ eLeapEventType_ConfigResponse, "Config Response" },
+	{ eLeapEventType_ConfigChange, "Config Change" },
+	{ eLeapEventType_DeviceStatusChange, "Device Status Change" },
+	{ eLeapEventType_Image, "Image" },
+	{ eLeapEventType_PointMappingChange, "Point Mapping Change" },
+	{ eLeapEventType_LogEvents, "Log Events" },
+};
+
+constexpr const char* leapResultToString(eLeapRS result) {
+	for (const LeapResultName& entry : leapResultNames) {
+		if (entry.result == result) return entry.name;
+	}
+
+	return "Unknown Result";
+}
+
+constexpr const char* leapEventTypeToString(eLeapEventType type) {
+	for (const LeapEventTypeName& entry : leapEventTypeNames) {
+		if (entry.type == type) return entry.name;
+	}
+
+	return "Unknown Event";
+}
+
+// backoff between polls while the service is away
+const int64_t k_leapRetryDelay = 50000;
+const int64_t k_leapMaxRetryDelay = 2000000;
+
+// after this many failed polls in a row the connection is closed and opened again, in case LeapC gave up on it
+const uint32_t k_leapReopenAfterErrors = 10;
+
+void printLeapRSError(eLeapRS result) {
+	LOG_ERROR("LeapC Error: {} {}", leapResultToString(result), static_cast<uint32_t>(result));
+}
+
+LeapHandler* s_sharedInstance = nullptr;
+
+LeapHandler* LeapHandler::getInstance()
+{
+	if (s_sharedInstance == nullptr) {
+		s_sharedInstance = new LeapHandler();
+	}
+
+	return s_sharedInstance;
+}
+
+LeapHandler::LeapHandler() :
+	m_connection( nullptr ),
+	m_connectionMonitor( "Leap Motion", k_leapRetryDelay, k_leapMaxRetryDelay ),
+	m_clock( SteadyClock::getInstance() )
+{
+}
+
+
+LeapHandler::~LeapHandler()
+{
+	if (m_clockRebaser != nullptr) {
+		LeapDestroyClockRebaser(m_clockRebaser);
+	}
+}
+
+bool LeapHandler::openConnection()
+{
+	if (m_started) {
+		return false;
+	}
+
+	eLeapRS result = LeapCreateConnection(NULL, &m_connection);
+
+	if (result != eLeapRS_Success) {
+		printLeapRSError(result);
+		m_started = false;
+		return false;
+	}
+
+	result = LeapCreateClockRebaser(&m_clockRebaser);
+	if (result != eLeapRS_Success) {
+		printLeapRSError(result);
+		m_started = false;
+		return false;
+	}
+
+	// the service doesn't have to be running yet, the polling thread opens the connection and keeps it up.
+	// The handle itself lives as long as the process since the main loop uses it for tracking frames
+	m_started = true;
+	m_pollingThread = std::thread([this]() {
+		this->pollController();
+	});
+			
+	return true;
+}
+
+bool LeapHandler::openSynthetic(const FrameGeneratorConfig& config)
+{
+	if (m_started) {
+		return false;
+	}
+
+	LOG_INFO("Generating {}x{} frames at {} Hz instead of connecting to the Leap Motion service", config.width, config.height, config.frameRate);
+
+	m_frameGenerator = std::make_unique<FrameGenerator>(config);
+	m_frameRateStale = true; // the previous run may have had a different rate
+	m_started = true;
+	m_pollingThread = std::thread([this]() {
+		this->generateFrames();
+	});
+
+	return true;
+}
+
+bool LeapHandler::openReplay(const std::string& path)
+{
+	if (m_started || !m_replayReader.open(path)) {
+		return false;
+	}
+
+	size_t frameCount = m_replayReader.getFrameCount();
+
+	if (frameCount == 0) {
+		m_replayReader.close();
+		return false;
+	}
+
+	int64_t duration = m_replayReader.getFrame(frameCount - 1).timestamp - m_replayReader.getFrame(0).timestamp;
+	m_replayFrameRate = (duration > 0) ? (frameCount - 1) * 1e6f / duration : 90.0f;
+	m_replayIndex = 0;
+	m_frameRateStale = true;
+
+	LOG_INFO("Replaying {} frames at {} Hz from {}", frameCount, m_replayFrameRate, path);
+	return true;
+}
+
+bool LeapHandler::replayUntil(int64_t time)
+{
+	size_t frameCount = m_replayReader.getFrameCount();
+
+	while (m_replayIndex < frameCount) {
+		ImageFrame frame = m_replayReader.getFrame(m_replayIndex);
+
+		if (frame.timestamp > time) {
+			return true;
+		}
+
+		// recorded timestamps are what the clock of a replay runs on, so they are the capture time as well
+		handleImage(frame, frame.timestamp, m_clock->now());
+		m_replayIndex++;
+	}
+
+	return false;
+}
+
+int64_t LeapHandler::getReplayStartTime()
+{
+	return (m_replayReader.getFrameCount() > 0) ? m_replayReader.getFrame(0).timestamp : 0;
+}
+
+void LeapHandler::setClock(Clock* clock)
+{
+	m_clock = clock;
+	m_connectionMonitor.setClock(clock);
+}
+
+SwipeDirection LeapHandler::pollSwipe()
+{
+	return static_cast<SwipeDirection>(m_swipeDirection.exchange(SwipeDirection_None));
+}
+
+void LeapHandler::setSwipeSource(SwipeSource source)
+{
+	m_swipeSource = source;
+	updateImagePolicy();
+}
+
+SwipeSource LeapHandler::getSwipeSource()
+{
+	return static_cast<SwipeSource>(m_swipeSource.load());
+}
+
+void LeapHandler::setOverlayVisible(bool visible)
+{
+	if (visible == m_overlayVisible) return;
+
+	m_overlayVisible = visible;
+	updateImagePolicy();
+}
+
+void LeapHandler::setRecording(bool recording)
+{
+	m_recordingRequested = recording;
+	updateImagePolicy();
+}
+
+bool LeapHandler::isRecording()
+{
+	return m_recordingRequested;
+}
+
+void LeapHandler::setDepthEnabled(bool enabled)
+{
+	m_depthEnabled = enabled;
+}
+
+bool LeapHandler::isDepthEnabled()
+{
+	return m_depthEnabled;
+}
+
+void LeapHandler::updateTracking(int64_t predictedHostTime)
+{
+	if (!m_started || m_frameGenerator || getSwipeSource() != SwipeSource_Tracking || m_connectionMonitor.getState() != ConnectionState_Connected) {
+		m_trackingActive = false;
+		return;
+	}
+
+	TRACE_SCOPE("LeapHandler::updateTracking");
+
+	if (!m_trackingActive) {
+		m_trackingActive = true;
+		m_trackingDetector.reset();
+	}
+
+	// the tracking service extrapolates the hand to the time the next overlay frame is shown,
+	// which takes the processing and transport latency of the tracking frames out of the gesture
+	int64_t leapTime = (std::min)(hostTimeToLeapTime(predictedHostTime), LeapGetNow() + k_maxTrackingPrediction);
+
+	// the polling thread may be closing the connection to open it again
+	std::lock_guard<std::mutex> lock(m_connectionMutex);
+
+	if (!m_connectionOpen) {
+		return;
+	}
+
+	uint64_t frameSize = 0;
+	if (LeapGetFrameSize(m_connection, leapTime, &frameSize) != eLeapRS_Success) {
+		return;
+	}
+
+	// only grows, the frame size depends on the number of hands
+	if (frameSize > m_interpolatedFrame.size()) {
+		m_interpolatedFrame.resize(frameSize);
+	}
+
+	LEAP_TRACKING_EVENT* frame = reinterpret_cast<LEAP_TRACKING_EVENT*>(m_interpolatedFrame.data());
+	if (LeapInterpolateFrame(m_connection, leapTime, frame, frameSize) != eLeapRS_Success) {
+		return;
+	}
+
+	SwipeDirection direction = m_trackingDetector.processFrame(*frame);
+
+	if (direction != SwipeDirection_None) {
+		publishSwipe(direction, leapTime);
+	}
+}
+
+std::shared_ptr<const ImagePyramid> LeapHandler::getLatestPyramid()
+{
+	std::lock_guard<std::mutex> lock(m_latestPyramidMutex);
+	return m_latestPyramid;
+}
+
+HandBlob LeapHandler::getHandBlob()
+{
+	std::lock_guard<std::mutex> lock(m_latestPyramidMutex);
+	return m_latestHandBlob;
+}
+
+void LeapHandler::logStatistics()
+{
+	m_pyramidPool.logStatistics();
+	m_swipePipeline.logStatistics();
+
+	LOG_INFO("Blob tracker scratch allocations: {}", m_blobTracker.getAllocationCount());
+
+	if (m_connection != nullptr) {
+		m_connectionMonitor.logStatistics();
+	}
+}
+
+void LeapHandler::join()
+{
+	if (m_started && m_pollingThread.joinable()) {
+		m_started = false;
+		m_pollingThread.join();
+	}
+}
+
+void LeapHandler::pollController()
+{
+	eLeapRS result;
+	LEAP_CONNECTION_MESSAGE msg;
+
+	TRACE_THREAD_NAME("Leap polling");
+
+	while (m_started) {
+		if (!m_connectionOpen) {
+			if (!m_connectionMonitor.isAttemptDue()) {
+				waitUntil(m_connectionMonitor.getNextAttemptTime());
+				continue;
+			}
+
+			std::lock_guard<std::mutex> lock(m_connectionMutex);
+
+			result = LeapOpenConnection(m_connection);
+			if (result != eLeapRS_Success) {
+				printLeapRSError(result);
+				m_connectionMonitor.backOff();
+				continue;
+			}
+
+			m_connectionOpen = true;
+		}
+
+		{
+			TRACE_SCOPE("LeapPollConnection");
+			result = LeapPollConnection(m_connection, 1000, &msg);
+		}
+		int64_t dequeueTime = m_clock->now();
+
+		// nothing happened within the timeout, e.g. no device is attached
+		if (result == eLeapRS_Timeout) continue;
+
+		// while the service is away the polls fail right away, so they are spaced out instead of spinning
+		if (result != eLeapRS_Success) {
+			handlePollError(result);
+			waitUntil(m_connectionMonitor.getNextAttemptTime());
+			continue;
+		}
+
+		m_pollErrors = 0;
+		m_lastPollError = eLeapRS_Success;
+
+		//LOG_DEBUG("{}", leapEventTypeToString(msg.type));
+
+		switch (msg.type) {
+			case eLeapEventType_Connection:
+			{
+				// a restarted service knows nothing about this client, so the policies are set again every time
+				applyPolicyFlags();
+				m_connectionMonitor.setState(ConnectionState_Connecting, "service connected, waiting for a device");
+				break;
+			}
+			case eLeapEventType_ConnectionLost:
+			{
+				// LeapC reconnects on its own, the polls fail until then
+				m_connectionMonitor.setState(ConnectionState_Disconnected, "service connection lost");
+				break;
+			}
+			case eLeapEventType_DeviceLost:
+			{
+				// the next device may have a different distortion map with the same version number
+				m_lastDistortionMatrixVersion[0] = 0;
+				m_lastDistortionMatrixVersion[1] = 0;
+				m_connectionMonitor.setState(ConnectionState_Connecting, "device lost");
+				break;
+			}
+			case eLeapEventType_DeviceFailure:
+			{
+				LOG_WARNING("Leap Motion device failure, status {}", msg.device_failure_event->status);
+				break;
+			}
+			case eLeapEventType_LogEvents: 
+			{
+				const LEAP_LOG_EVENTS* events = msg.log_events;
+				//std::cout << "Messages (" << events->nEvents << "):" << std::endl;
+
+				for (uint32_t i = 0; i < events->nEvents; i++) {
+					LEAP_LOG_EVENT evt = events->events[i];
+
+					LOG_INFO("[{}] {}", evt.timestamp, evt.message);
+				}
+
+				break;
+			}
+			case eLeapEventType_LogEvent:
+			{
+				const LEAP_LOG_EVENT* evt = msg.log_event;
+			
+				LOG_INFO("[{}] {}", evt->timestamp, evt->message);
+				break;
+			}
+			case eLeapEventType_Device:
+			{
+				// a new device can come with a different frame rate
+				m_frameRateStale = true;
+				m_connectionMonitor.setState(ConnectionState_Connected, "device attached");
+				break;
+			}
+			case eLeapEventType_DeviceStatusChange:
+			{
+				// a changed camera mode can come with a different frame rate
+				m_frameRateStale = true;
+				break;
+			}
+			case eLeapEventType_Tracking:
+			{
+				// the device event can be missed when the device was there before the connection
+				m_connectionMonitor.setState(ConnectionState_Connected, "tracking frames arriving");
+
+				// goes into the session with the next images
+				m_latestTrackingFrame = makeTrackingFrame(*msg.tracking_event);
+				break;
+			}
+			case eLeapEventType_Image: 
+			{
+				const LEAP_IMAGE_EVENT* evt = msg.image_event;
+				GraphicsManager* graphicsManager = GraphicsManager::getInstance();
+
+				m_connectionMonitor.setState(ConnectionState_Connected, "images arriving");
+
+				ImageFrame frame;
+				frame.frameId = evt->info.frame_id;
+				frame.timestamp = evt->info.timestamp;
+				frame.width = evt->image[0].properties.width;
+				frame.height = evt->image[0].properties.height;
+				frame.left = (uint8_t*)evt->image[0].data + evt->image[0].offset;
+				frame.right = (uint8_t*)evt->image[1].data + evt->image[1].offset;
+				frame.tracking = m_latestTrackingFrame;
+
+				// every camera has its own distortion map which can be updated independently. The maps stay on the GPU
+				// while the service is away, so after a reconnect nothing is uploaded unless the version changed
+				for (int camera = 0; camera < 2; camera++) {
+					if (evt->image[camera].matrix_version != m_lastDistortionMatrixVersion[camera]) {
+						m_lastDistortionMatrixVersion[camera] = evt->image[camera].matrix_version;
+						graphicsManager->setDistortionMap(camera, (float*)evt->image[camera].distortion_matrix);
+					}
+				}
+
+				handleImage(frame, leapTimeToHostTime(evt->info.timestamp), dequeueTime);
+				break;
+			}
+		}
+	}
+}
+
+void LeapHandler::generateFrames()
+{
+	TRACE_THREAD_NAME("Synthetic frames");
+
+	const FrameGeneratorConfig& config = m_frameGenerator->getConfig();
+	int64_t startTime = m_clock->now();
+	int64_t frameIndex = 0;
+
+	while (m_started) {
+		// frames are paced like a real device, a frame that is late is generated right away instead of being skipped
+		int64_t captureTime = startTime + static_cast<int64_t>(frameIndex * 1e6 / config.frameRate);
+		m_clock->sleepUntil(captureTime);
+
+		const FrameLabel& label = m_frameGenerator->generate(frameIndex);
+
+		ImageFrame frame;
+		frame.frameId = frameIndex;
+		frame.timestamp = label.timestamp;
+		frame.width = config.width;
+		frame.height = config.height;
+		frame.left = m_frameGenerator->getImage(0);
+		frame.right = m_frameGenerator->getImage(1);
+		frame.tracking = m_frameGenerator->getTrackingFrame();
+
+		handleImage(frame, captureTime, m_clock->now());
+		frameIndex++;
+	}
+}
+
+void LeapHandler::handleImage(const ImageFrame& frame, int64_t captureTime, int64_t dequeueTime)
+{
+	TRACE_SCOPE("LeapHandler::handleImage");
+
+	GraphicsManager* graphicsManager = GraphicsManager::getInstance();
+
+	FrameTimestamps timestamps;
+	timestamps.frameId = frame.frameId;
+	timestamps.stages[FrameStage_Capture] = captureTime;
+	timestamps.stages[FrameStage_Dequeue] = dequeueTime;
+
+	// all detectors read the downscaled levels instead of going through the full images again
+	std::shared_ptr<const ImagePyramid> pyramid = m_pyramidPool.build(frame.frameId, frame.width, frame.height, frame.left, frame.right);
+
+	if (m_frameRateStale) {
+		updateFrameRate();
+	}
+
+	// detection windows are measured with the device's own timestamps, the frame rate only sizes the buffers
+	SwipeSource swipeSource = getSwipeSource();
+	SwipeDirection direction = m_swipePipeline.processFrame(pyramid, swipeSource, frame.timestamp);
+
+	if (direction != SwipeDirection_None) {
+		publishSwipe(direction, frame.timestamp);
+	}
+
+	// live tracking is interpolated by the main loop, generated and replayed frames bring their tracking frame along
+	bool trackingFromFrames = m_frameGenerator || m_replayReader.getFrameCount() > 0;
+
+	if (trackingFromFrames && swipeSource == SwipeSource_Tracking && frame.tracking.frameId != m_lastTrackingFrameId) {
+		m_lastTrackingFrameId = frame.tracking.frameId;
+		SwipeDirection trackedDirection = (frame.tracking.frameId >= 0) ? m_trackingDetector.processFrame(frame.tracking) : SwipeDirection_None;
+
+		if (trackedDirection != SwipeDirection_None) {
+			publishSwipe(trackedDirection, frame.tracking.timestamp);
+		}
+	}
+
+	HandBlob handBlob = m_blobTracker.processFrame(pyramid->getLevel(0, k_blobPyramidLevel));
+	graphicsManager->setHandBlob(handBlob);
+
+	timestamps.stamp(FrameStage_Analyzed, m_clock->now());
+
+	graphicsManager->setFrame(frame.width, frame.height, frame.left, frame.right, timestamps);
+
+	// depth is computed after the frame has been handed over so that it doesn't add to the passthrough latency.
+	// Off by default: the matcher works on the unrectified images and no overlay effect or detector reads its output yet
+	if (m_depthEnabled) {
+		StereoMatcher::getInstance()->compute(*pyramid);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_latestPyramidMutex);
+		m_latestPyramid = pyramid;
+		m_latestHandBlob = handBlob;
+	}
+
+	// the file is only created with the first frame, that is when the image size is known
+	if (m_recordingRequested && !m_sessionWriter.isOpen()) {
+		std::string path = makeSessionFileName();
+
+		// the polling thread never waits for the disk, frames that don't fit into the writer's queue are left out
+		if (m_sessionWriter.open(path, frame.width, frame.height, true)) {
+			LOG_INFO("Recording camera images to {}", path);
+		} else {
+			m_recordingRequested = false;
+		}
+	} else if (!m_recordingRequested && m_sessionWriter.isOpen()) {
+		m_sessionWriter.close();
+		LOG_INFO("Recording stopped, {} frames were dropped because the disk couldn't keep up", m_sessionWriter.getDroppedCount());
+	}
+
+	if (m_sessionWriter.isOpen() && !m_sessionWriter.writeFrame(frame)) {
+		LOG_ERROR("Could not write to the session before frame {}, recording stopped", frame.frameId);
+		m_sessionWriter.close();
+		m_recordingRequested = false;
+	}
+}
+
+void LeapHandler::publishSwipe(SwipeDirection direction, int64_t frameTime)
+{
+	// the polling thread and the main loop (tracking) both publish, only one of them may start a cooldown
+	int64_t lastSwipeTimestamp = m_lastSwipeTimestamp.load();
+
+	do {
+		if (frameTime - lastSwipeTimestamp < k_swipeCooldown) {
+			return;
+		}
+	} while (!m_lastSwipeTimestamp.compare_exchange_weak(lastSwipeTimestamp, frameTime));
+
+	m_swipeDirection = direction;
+}
+
+void LeapHandler::updateImagePolicy()
+{
+	// the tracking based detector doesn't need any images, so nobody looks at them while the overlay is hidden and
+	// nothing is recorded
+	bool imagesRequested = m_overlayVisible || m_recordingRequested || getSwipeSource() != SwipeSource_Tracking;
+
+	if (!m_started || m_frameGenerator || imagesRequested == m_imagesRequested) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_connectionMutex);
+
+	// nobody to tell, the polling thread sets the policy once the service is back
+	if (!m_connectionOpen || m_connectionMonitor.getState() == ConnectionState_Disconnected) {
+		m_imagesRequested = imagesRequested;
+		return;
+	}
+
+	eLeapRS result = imagesRequested
+		? LeapSetPolicyFlags(m_connection, eLeapPolicyFlag_Images, 0)
+		: LeapSetPolicyFlags(m_connection, 0, eLeapPolicyFlag_Images);
+
+	if (result != eLeapRS_Success) {
+		printLeapRSError(result);
+		return;
+	}
+
+	LOG_INFO("Image stream {}", imagesRequested ? "requested" : "dropped");
+	m_imagesRequested = imagesRequested;
+}
+
+void LeapHandler::handlePollError(eLeapRS result)
+{
+	// the same error over and over is only logged once
+	if (result != m_lastPollError) {
+		printLeapRSError(result);
+		m_lastPollError = result;
+	}
+
+	m_connectionMonitor.setState(ConnectionState_Disconnected, leapResultToString(result));
+	m_connectionMonitor.backOff();
+	m_pollErrors++;
+
+	if (m_pollErrors >= k_leapReopenAfterErrors) {
+		LOG_WARNING("Leap Motion service unreachable after {} polls, opening the connection again", m_pollErrors);
+
+		std::lock_guard<std::mutex> lock(m_connectionMutex);
+		LeapCloseConnection(m_connection);
+		m_connectionOpen = false;
+		m_pollErrors = 0;
+	}
+}
+
+void LeapHandler::applyPolicyFlags()
+{
+	bool imagesRequested = m_imagesRequested;
+
+	eLeapRS result = LeapSetPolicyFlags(m_connection, eLeapPolicyFlag_OptimizeHMD | (imagesRequested ? eLeapPolicyFlag_Images : 0), imagesRequested ? 0 : eLeapPolicyFlag_Images);
+
+	if (result != eLeapRS_Success) {
+		printLeapRSError(result);
+	}
+}
+
+void LeapHandler::waitUntil(int64_t time)
+{
+	// on m_clock like the connection monitor's attempt times, in short steps so that join() doesn't have to wait for
+	// the whole backoff. A VirtualClock jumps ahead instead of sleeping
+	while (m_started && m_clock->now() < time) {
+		m_clock->sleepUntil((std::min)(time, m_clock->now() + static_cast<int64_t>(100000)));
+	}
+}
+
+void LeapHandler::updateFrameRate()
+{
+	float framesPerSecond;
+	eLeapRS result = eLeapRS_Success;
+
+	if (m_frameGenerator) {
+		framesPerSecond = m_frameGenerator->getConfig().frameRate;
+	} else if (m_replayFrameRate > 0.0f) {
+		framesPerSecond = m_replayFrameRate;
+	} else {
+		result = LeapGetDeviceFrameRate(m_connection, &framesPerSecond);
+	}
+
+	if (result != eLeapRS_Success || framesPerSecond <= 0.0f) {
+		// try again with the next frame
+		return;
+	}
+
+	m_frameRateStale = false;
+
+	if (framesPerSecond == m_deviceFrameRate) {
+		return;
+	}
+
+	LOG_INFO("Device frame rate is {} Hz", framesPerSecond);
+
+	m_deviceFrameRate = framesPerSecond;
+	m_swipePipeline.setFrameRate(framesPerSecond);
+}
+
+int64_t LeapHandler::leapTimeToHostTime(int64_t leapTime)
+{
+	std::lock_guard<std::mutex> lock(m_clockMutex);
+
+	// keep the rebaser in sync and then map the age of the leap timestamp onto the host clock
+	int64_t hostNow = getHostTimeMicroseconds();
+	LeapUpdateRebase(m_clockRebaser, hostNow, LeapGetNow());
+
+	int64_t leapNow;
+	if (LeapRebaseClock(m_clockRebaser, hostNow, &leapNow) != eLeapRS_Success) {
+		return hostNow;
+	}
+
+	return hostNow - (leapNow - leapTime);
+}
+
+int64_t LeapHandler::hostTimeToLeapTime(int64_t hostTime)
+{
+	std::lock_guard<std::mutex> lock(m_clockMutex);
+
+	LeapUpdateRebase(m_clockRebaser, getHostTimeMicroseconds(), LeapGetNow());
+
+	int64_t leapTime;
+	if (LeapRebaseClock(m_clockRebaser, hostTime, &leapTime) != eLeapRS_Success) {
+		return LeapGetNow();
+	}
+
+	return leapTime;
+}
\ No newline at end of file
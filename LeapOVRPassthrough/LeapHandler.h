@@ -1,49 +1,117 @@
-#pragma once
-#include <thread>
-#include <string>
-#include <iostream>
-#include <map>
-#include <vector>
-#include <chrono>
-#include <sstream> 
-
-#include "GraphicsManager.h"
-
-extern "C" {
-	#include <LeapC.h>
-}
-
-class LeapHandler
-{
-	using steady_clock = std::chrono::steady_clock;
-	using time_point = steady_clock::time_point;
-	using duration = steady_clock::duration;
-
-public:
-	static LeapHandler* getInstance();
-
-	LeapHandler();
-	~LeapHandler();
-
-	bool openConnection();
-	bool swipeDetected();
-	void join();
-
-private:
-	void pollController();
-	void updateBrightUpperPixels(int width, int height, uint8_t* image);
-	uint32_t countLastBUPIncreasing();
-
-	std::thread m_pollingThread;
-	bool m_started { false };
-	bool m_swipeDetected { false };
-
-	LEAP_CONNECTION m_connection;
-	uint64_t m_lastDistortionMatrixVersion { 0 };
-
-	std::vector<uint32_t> m_brightUpperPixelsRingbuffer;
-	uint32_t m_bupRBNextIndex { 0 };
-
-	time_point m_lastSwipeDetected;
-};
-
+#pragma once
+#include <thread>
+#include <string>
+#include <iostream>
+#include <map>
+#include <vector>
+#include <chrono>
+#include <sstream> 
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include "GraphicsManager.h"
+#include "StereoMatcher.h"
+#include "SwipePipeline.h"
+#include "ImagePyramid.h"
+#include "BlobTracker.h"
+#include "TrackingDetector.h"
+#include "FrameGenerator.h"
+#include "SessionFile.h"
+#include "ConnectionMonitor.h"
+#include "Clock.h"
+#include "Trace.h"
+#include "Log.h"
+
+extern "C" {
+	#include <LeapC.h>
+}
+
+const int64_t k_maxTrackingPrediction = 30000; // microseconds the tracked hand is extrapolated into the future at most
+
+class LeapHandler
+{
+public:
+	static LeapHandler* getInstance();
+
+	LeapHandler();
+	~LeapHandler();
+
+	bool openConnection();
+	bool openSynthetic(const FrameGeneratorConfig& config);
+	bool openReplay(const std::string& path);
+	bool replayUntil(int64_t time);
+	int64_t getReplayStartTime();
+	void setClock(Clock* clock);
+	SwipeDirection pollSwipe();
+	void setSwipeSource(SwipeSource source);
+	SwipeSource getSwipeSource();
+	void setOverlayVisible(bool visible);
+	void setRecording(bool recording);
+	bool isRecording();
+	void setDepthEnabled(bool enabled);
+	bool isDepthEnabled();
+	void updateTracking(int64_t predictedHostTime);
+	std::shared_ptr<const ImagePyramid> getLatestPyramid();
+	HandBlob getHandBlob();
+	void logStatistics();
+	void join();
+
+private:
+	void pollController();
+	void generateFrames();
+	void handleImage(const ImageFrame& frame, int64_t captureTime, int64_t dequeueTime);
+	int64_t leapTimeToHostTime(int64_t leapTime);
+	int64_t hostTimeToLeapTime(int64_t hostTime);
+	void publishSwipe(SwipeDirection direction, int64_t frameTime);
+	void updateImagePolicy();
+	void updateFrameRate();
+	void handlePollError(eLeapRS result);
+	void applyPolicyFlags();
+	void waitUntil(int64_t time); // on m_clock
+
+	std::thread m_pollingThread;
+	std::atomic<bool> m_started { false }; // the connection is opened on a startup thread while the main loop already runs
+	std::atomic<int> m_swipeDirection { SwipeDirection_None };
+
+	LEAP_CONNECTION m_connection;
+	ConnectionMonitor m_connectionMonitor;
+	std::mutex m_connectionMutex; // the polling thread closes and reopens the handle, the main loop interpolates tracking frames with it
+	bool m_connectionOpen { false }; // changed by the polling thread while holding m_connectionMutex
+	uint32_t m_pollErrors { 0 }; // failed polls in a row
+	eLeapRS m_lastPollError { eLeapRS_Success };
+	LEAP_CLOCK_REBASER m_clockRebaser { nullptr };
+	std::mutex m_clockMutex; // the rebaser is used by the polling thread and the main loop
+	uint64_t m_lastDistortionMatrixVersion[2] { 0, 0 };
+	std::unique_ptr<FrameGenerator> m_frameGenerator; // replaces the connection when set
+	SessionReader m_replayReader; // replaces the connection when a session is open, frames are pulled by replayUntil()
+	size_t m_replayIndex { 0 };
+	float m_replayFrameRate { 0.0f };
+	Clock* m_clock;
+	std::atomic<bool> m_recordingRequested { false };
+	SessionWriter m_sessionWriter; // only used by the polling thread
+
+	PyramidPool m_pyramidPool;
+	std::mutex m_latestPyramidMutex;
+	std::shared_ptr<const ImagePyramid> m_latestPyramid;
+	HandBlob m_latestHandBlob;
+
+	SwipePipeline m_swipePipeline; // only used by the polling thread
+	BlobTracker m_blobTracker;
+	std::atomic<bool> m_depthEnabled { false }; // nothing uses the depth map yet, so it is only computed on request
+	std::atomic<int> m_swipeSource { SwipeSource_Motion };
+
+	TrackingDetector m_trackingDetector; // used by the main loop, or by the thread that handles generated and replayed frames
+	TrackingFrame m_latestTrackingFrame; // only used by the polling thread
+	int64_t m_lastTrackingFrameId { -1 }; // of generated and replayed frames, each tracking frame is only detected on once
+	std::vector<uint8_t> m_interpolatedFrame;
+	bool m_trackingActive { false };
+
+	bool m_overlayVisible { false };
+	std::atomic<bool> m_imagesRequested { true }; // applied again by the polling thread whenever the service connects
+
+	std::atomic<int64_t> m_lastSwipeTimestamp { 0 }; // leap clock
+	float m_deviceFrameRate { 0.0f };
+	bool m_frameRateStale { true }; // set when a device shows up, the frame rate is queried again with the next image
+};
+
@@ -1,444 +1,578 @@
-#define GLFW_EXPOSE_NATIVE_WIN32
-
-#include "windows.h"
-#include "resource.h"
-#include <CommCtrl.h>
-#include <iostream>
-#include <vector>
-#include <GL/glew.h>
-#include <GLFW/glfw3.h>
-#include <GLFW/glfw3native.h>
-
-#include <lodepng.h>
-
-#include "LeapHandler.h"
-#include "OVROverlayController.h"
-#include "GraphicsManager.h"
-#include "utils.h"
-
-#define TRAYMENU_EXIT 1
-#define TRAYMENU_SHOW 2
-#define TRAYMENU_INSTALL_MANIFEST 3
-#define TRAYMENU_REMOVE_MANIFEST 4
-#define TRAYMENU_ROTATE_0 5
-#define TRAYMENU_ROTATE_90 6
-#define TRAYMENU_ROTATE_180 7
-#define TRAYMENU_ROTATE_270 8
-#define TRAYMENU_OVERLAY_OPAQUE 9
-#define TRAYMENU_OVERLAY_TRANSPARENT 10
-#define TRAYMENU_TOGGLE_DISTORTION_MAP 11
-#define TRAYMENU_TOGGLE_WIDTH 12
-
-GLuint display_fullscreenQuadVAO;
-GLuint display_fullscreenQuadBuffer;
-GLuint display_fullscreenQuadUVs;
-GLuint display_vertexShader, display_fragmentShader;
-GLuint display_shaderProgram;
-GLuint display_textureSamplerID;
-WNDPROC defaultWndProc;
-GLFWwindow* globalWindow;
-bool globalKeepRunning = true;
-
-const char* display_vertexShaderCode = R"""(
-#version 420 core
-
-layout(location = 0) in vec3 position;
-layout(location = 1) in vec2 uv;
-
-out vec2 vUv;
-
-void main() {
-	vUv = uv;
-	gl_Position = vec4(position, 1.0);
-}
-)""";
-const size_t display_vertexShaderCodeLength = strlen(display_vertexShaderCode);
-
-const char* display_fragmentShaderCode = R"""(
-#version 420 core
-
-layout(location = 0) out vec3 diffuseColor;
-
-uniform sampler2D textureSampler;
-
-in vec2 vUv;
-
-void main() {
-	//diffuseColor = vec4(texture( textureSampler, vec2(vUv.x, vUv.y)).rgb, 1);
-	diffuseColor = texture( textureSampler, vec2(vUv.x, vUv.y));
-}
-)""";
-const GLint display_fragmentShaderCodeLength = strlen(display_fragmentShaderCode);
-
-static const GLfloat g_quad_vertex_buffer_data[] = {
-	-1.0f, -1.0f, 0.0f,
-	1.0f, -1.0f, 0.0f,
-	-1.0f,  1.0f, 0.0f,
-	-1.0f,  1.0f, 0.0f,
-	1.0f,  1.0f, 0.0f,
-	1.0f, -1.0f, 0.0f,
-};
-
-static const GLfloat g_quad_uvs_buffer_data[] = {
-	0.0f, 0.0f,
-	1.0f, 0.0f,
-	0.0f,  1.0f,
-	0.0f,  1.0f,
-	1.0f,  1.0f,
-	1.0f, 0.0f,
-};
-
-GLFWimage loadResource(HINSTANCE hInstance, int id) {
-	GLFWimage result = { 0 };
-
-	HRSRC hResource = FindResource(hInstance, MAKEINTRESOURCE(id), L"PNG");
-	DWORD imageSize = SizeofResource(hInstance, hResource);
-
-	const void* data = LockResource(LoadResource(hInstance, hResource));
-
-	std::vector<unsigned char> pngfile((unsigned char*)data, (unsigned char*)data + imageSize);
-
-	std::vector<uint8_t> pixels;
-	unsigned width, height;
-
-	lodepng::decode(pixels, width, height, pngfile);
-
-	std::vector<unsigned char>* pixelData = new std::vector<unsigned char>(pixels);
-
-	result.width = width;
-	result.height = height;
-	result.pixels = pixelData->data();
-
-	return result;
-}
-
-void display_init() {
-	GLint Result = GL_FALSE;
-	int InfoLogLength;
-	std::stringstream output;
-
-	display_vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(display_vertexShader, 1, &display_vertexShaderCode, (GLint*)&display_vertexShaderCodeLength);
-	glCompileShader(display_vertexShader);
-
-	glGetShaderiv(display_vertexShader, GL_COMPILE_STATUS, &Result);
-	glGetShaderiv(display_vertexShader, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	if (InfoLogLength > 0) {
-		std::vector<char> VertexShaderErrorMessage(InfoLogLength + 1);
-		glGetShaderInfoLog(display_vertexShader, InfoLogLength, NULL, &VertexShaderErrorMessage[0]);
-
-		output << &VertexShaderErrorMessage[0];
-		outputStringStream(output);
-	}
-
-	display_fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(display_fragmentShader, 1, &display_fragmentShaderCode, &display_fragmentShaderCodeLength);
-	glCompileShader(display_fragmentShader);
-
-	glGetShaderiv(display_fragmentShader, GL_COMPILE_STATUS, &Result);
-	glGetShaderiv(display_fragmentShader, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	if (InfoLogLength > 0) {
-		std::vector<char> FragmentShaderErrorMessage(InfoLogLength + 1);
-		glGetShaderInfoLog(display_fragmentShader, InfoLogLength, NULL, &FragmentShaderErrorMessage[0]);
-
-		output << &FragmentShaderErrorMessage[0];
-		outputStringStream(output);
-	}
-
-	display_shaderProgram = glCreateProgram();
-	glAttachShader(display_shaderProgram, display_vertexShader);
-	glAttachShader(display_shaderProgram, display_fragmentShader);
-	glLinkProgram(display_shaderProgram);
-
-	// Check the program
-	glGetProgramiv(display_shaderProgram, GL_LINK_STATUS, &Result);
-	glGetProgramiv(display_shaderProgram, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	if (InfoLogLength > 0) {
-		std::vector<char> ProgramErrorMessage(InfoLogLength + 1);
-		glGetProgramInfoLog(display_shaderProgram, InfoLogLength, NULL, &ProgramErrorMessage[0]);
-
-		output << &ProgramErrorMessage[0];
-		outputStringStream(output);
-	}
-
-	display_textureSamplerID = glGetUniformLocation(display_shaderProgram, "textureSampler");
-
-	glGenVertexArrays(1, &display_fullscreenQuadVAO);
-	glBindVertexArray(display_fullscreenQuadVAO);
-
-	glGenBuffers(1, &display_fullscreenQuadBuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, display_fullscreenQuadBuffer);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(g_quad_vertex_buffer_data), g_quad_vertex_buffer_data, GL_STATIC_DRAW);
-
-	glGenBuffers(1, &display_fullscreenQuadUVs);
-	glBindBuffer(GL_ARRAY_BUFFER, display_fullscreenQuadUVs);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(g_quad_uvs_buffer_data), g_quad_uvs_buffer_data, GL_STATIC_DRAW);
-}
-
-void display_render() {
-	GraphicsManager* graphicsManager = GraphicsManager::getInstance();
-
-	glClear(GL_COLOR_BUFFER_BIT);
-
-	glUseProgram(display_shaderProgram);
-
-	glUniform1i(display_textureSamplerID, 0);
-	glBindTexture(GL_TEXTURE_2D, graphicsManager->getVideoTexture());
-
-	glEnableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, display_fullscreenQuadBuffer);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-
-	glEnableVertexAttribArray(1);
-	glBindBuffer(GL_ARRAY_BUFFER, display_fullscreenQuadUVs);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
-
-	glDrawArrays(GL_TRIANGLES, 0, 6);
-	glDisableVertexAttribArray(0);
-	glDisableVertexAttribArray(1);
-
-	glEnd();
-	glFlush();
-}
-
-void addTrayIcon(HINSTANCE hInstance, HWND hWnd, UINT uID) {
-	NOTIFYICONDATA nid;
-	nid.hWnd = hWnd;
-	nid.uID = uID;
-	nid.uFlags = NIF_TIP | NIF_MESSAGE | NIF_ICON;
-	nid.uCallbackMessage = WM_APP;
-	nid.hIcon = LoadIcon(hInstance, MAKEINTRESOURCE(IDI_ICON1));
-	wcscpy_s(nid.szTip, L"Leap Motion SteamVR Overlay");
-	
-	Shell_NotifyIcon(NIM_ADD, &nid);
-}
-
-void removeTrayIcon(HWND hWnd, UINT uID) {
-	NOTIFYICONDATA nid;
-	nid.hWnd = hWnd;
-	nid.uID = uID;
-
-	Shell_NotifyIcon(NIM_DELETE, &nid);
-}
-
-void showTrayMenu(HWND hWnd, POINT *curpos, int wDefaultItem) {
-	OVROverlayController* vrController = OVROverlayController::getInstance();
-
-	HMENU hPopup = CreatePopupMenu();
-	uint32_t pos = 0;
-
-	InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_ROTATE_0, L"Reset overlay rotation");
-	InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_ROTATE_90, L"Rotate overlay 90 degrees");
-	InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_ROTATE_180, L"Rotate overlay 180 degrees");
-	InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_ROTATE_270, L"Rotate overlay 270 degrees");
-	InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_OVERLAY_OPAQUE, L"Set overlay to be opaque");
-	InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_OVERLAY_TRANSPARENT, L"Set overlay to be transparent");
-	InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_TOGGLE_DISTORTION_MAP, L"Toggle distortion correction");
-	InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_TOGGLE_WIDTH, L"Toggle smaller overlay");
-
-	InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_SEPARATOR, 0, 0);
-
-	InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_SHOW, L"Show Window");
-
-	if (vrController->isManifestInstalled()) {
-		InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_REMOVE_MANIFEST, L"Unregister from SteamVR");
-	} else {
-		InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_INSTALL_MANIFEST, L"Register with SteamVR");
-	}
-
-	InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_EXIT, L"Exit");
-
-	POINT pt;
-	if (!curpos) {
-		GetCursorPos(&pt);
-		curpos = &pt;
-	}
-
-	WORD cmd = TrackPopupMenu(hPopup, TPM_LEFTALIGN | TPM_RIGHTBUTTON | TPM_RETURNCMD | TPM_NONOTIFY, curpos->x, curpos->y, 0, hWnd, NULL);
-	SendMessage(hWnd, WM_COMMAND, cmd, 0);
-
-	DestroyMenu(hPopup);
-}
-
-static LRESULT CALLBACK WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam, UINT_PTR uIdSubclass, DWORD_PTR dwRefData) {
-	OVROverlayController* vrController = OVROverlayController::getInstance();
-	GraphicsManager* graphicsManager = GraphicsManager::getInstance();
-
-	switch (uMsg) {
-		case WM_APP:
-			switch (lParam) {
-				case WM_LBUTTONDBLCLK:
-					glfwShowWindow(globalWindow);
-					return 0;
-				case WM_RBUTTONUP:
-					SetForegroundWindow(hWnd);
-					showTrayMenu(hWnd, NULL, -1);
-					return 0;
-			}
-			return 0;
-		case WM_COMMAND:
-			switch (wParam) {
-				case TRAYMENU_EXIT:
-					globalKeepRunning = false;
-					return 0;
-				case TRAYMENU_SHOW:
-					glfwShowWindow(globalWindow);
-					return 0;
-				case TRAYMENU_INSTALL_MANIFEST:
-					vrController->installManifest();
-					return 0;
-				case TRAYMENU_REMOVE_MANIFEST:
-					vrController->removeManifest();
-					return 0;
-				case TRAYMENU_ROTATE_0:
-					vrController->setOverlayRotation(0);
-					return 0;
-				case TRAYMENU_ROTATE_90:
-					vrController->setOverlayRotation(3);
-					return 0;
-				case TRAYMENU_ROTATE_180:
-					vrController->setOverlayRotation(2);
-					return 0;
-				case TRAYMENU_ROTATE_270:
-					vrController->setOverlayRotation(1);
-					return 0;
-				case TRAYMENU_OVERLAY_OPAQUE:
-					vrController->setOverlayAlpha(1.0f);
-					return 0;
-				case TRAYMENU_OVERLAY_TRANSPARENT:
-					vrController->setOverlayAlpha(0.5f);
-					return 0;
-				case TRAYMENU_TOGGLE_DISTORTION_MAP:
-					graphicsManager->setDistortionMapActive(!graphicsManager->getDistortionMapActive());
-					return 0;
-				case TRAYMENU_TOGGLE_WIDTH: {
-					float currentWidth = vrController->getOverlayWidth();
-					vrController->setOverlayWidth((currentWidth > 0.4) ? 0.3 : 0.5);
-					return 0;
-				}
-			}
-			return 0;
-		case WM_NCDESTROY:
-			RemoveWindowSubclass(hWnd, WndProc, uIdSubclass);
-			return DefSubclassProc(hWnd, uMsg, wParam, lParam);
-	}
-
-	return DefSubclassProc(hWnd, uMsg, wParam, lParam);
-}
-
-int APIENTRY WinMain(HINSTANCE hInstance,
-	HINSTANCE /*hPrevInstance*/,
-	LPSTR /*lpCmdLine*/,
-	int /*cmdShow*/)
-{
-	std::stringstream msg;
-
-	if (!glfwInit()) {
-		MessageBox(NULL, L"GLFW failed to initialize!", L"Leap Motion SteamVR Overlay", MB_OK | MB_ICONERROR);
-		msg << "GLFW failed to initialize!" << std::endl;
-		outputStringStream(msg);
-		return 1;
-	}
-	
-
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
-	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
-	globalWindow = glfwCreateWindow(640, 480, "Leap Motion SteamVR Overlay", NULL, NULL);
-	HWND windowHandle = glfwGetWin32Window(globalWindow);
-
-	//defaultWndProc = (WNDPROC)GetWindowLongPtr(windowHandle, GWLP_WNDPROC);
-	//SetWindowLongPtr(windowHandle, GWLP_WNDPROC, (long)WndProc);
-
-	SetWindowSubclass(windowHandle, WndProc, 1, 0);
-
-	glfwMakeContextCurrent(globalWindow);
-	glfwSwapInterval(1);
-
-	GLenum err = glewInit();
-	if (err != GLEW_OK) {
-		MessageBox(NULL, L"GLEW failed to initialize!", L"Leap Motion SteamVR Overlay", MB_OK | MB_ICONERROR);
-		msg << "glewInit Error: " << glewGetErrorString(err) << std::endl;
-		outputStringStream(msg);
-		return 1;
-	}
-
-	msg << "OpenGL version: " << glGetString(GL_VERSION) << std::endl;
-	outputStringStream(msg);
-
-	OVROverlayController* vrController = OVROverlayController::getInstance();
-	LeapHandler* leapHandler = LeapHandler::getInstance();
-	GraphicsManager* graphicsManager = GraphicsManager::getInstance();
-
-	if (!graphicsManager->init()) {
-		MessageBox(NULL, L"GraphicsManager failed to initialize!", L"Leap Motion SteamVR Overlay", MB_OK | MB_ICONERROR);
-		msg << "Graphics Manager initialization failed!" << std::endl;
-		outputStringStream(msg);
-		return 1;
-	}
-
-	addTrayIcon(hInstance, windowHandle, 1);
-
-	// more window setup
-	GLFWimage windowIcon = loadResource(hInstance, IDB_PNG1);
-	glfwSetWindowIcon(globalWindow, 1, &windowIcon);
-
-	vrController->init();
-	leapHandler->openConnection();
-
-	display_init();
-
-	//vrController->showOverlay();
-
-	glfwSetWindowCloseCallback(globalWindow, [](GLFWwindow* wnd) {
-		glfwHideWindow(wnd);
-	});
-
-	while (globalKeepRunning && vrController->isConnected()) {
-		graphicsManager->updateTexture();
-
-		if (leapHandler->swipeDetected()) {
-			vrController->toggleOverlay();
-		}
-
-		if (graphicsManager->wasUpdated()) {
-			//std::cout << "update " << graphicsManager->getVideoTexture() << std::endl;
-			vrController->setTexture(graphicsManager->getVideoTexture());
-		}
-
-		if (glfwGetWindowAttrib(globalWindow, GLFW_VISIBLE)) {
-			int width, height;
-
-			// bind output window as framebuffer
-			glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-			glfwGetFramebufferSize(globalWindow, &width, &height);
-
-			glViewport(0, 0, width, height);
-
-			display_render();
-
-			glfwSwapBuffers(globalWindow);
-
-			glfwPollEvents();
-		} else {
-			glfwWaitEventsTimeout(1.0 / 60.0); // aim for roughly 60fps when no window is displayed
-		}
-
-		vrController->pollEvents();
-	}
-
-	removeTrayIcon(windowHandle, 1);
-
-	glfwDestroyWindow(globalWindow);
-	glfwTerminate();
-
-	leapHandler->join();
-
-    return 0;
-}
-
-int main(int argc, char** argv)
-{
-	return WinMain(GetModuleHandle(NULL), NULL, GetCommandLineA(), SW_SHOWNORMAL);
+#define GLFW_EXPOSE_NATIVE_WIN32
+
+#include "windows.h"
+#include "resource.h"
+#include <CommCtrl.h>
+#include <iostream>
+#include <vector>
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <GLFW/glfw3native.h>
+
+#include "LeapHandler.h"
+#include "OVROverlayController.h"
+#include "GraphicsManager.h"
+#include "LatencyTracker.h"
+#include "StereoMatcher.h"
+#include "PipelineBenchmark.h"
+#include "Evaluation.h"
+#include "Replay.h"
+#include "MainLoop.h"
+#include "StartupGraph.h"
+#include "StartupBenchmark.h"
+#include "ProgramCache.h"
+#include "Trace.h"
+#include "Log.h"
+#include "utils.h"
+#include "BakedAssets.h"
+
+#define TRAYMENU_EXIT 1
+#define TRAYMENU_SHOW 2
+#define TRAYMENU_INSTALL_MANIFEST 3
+#define TRAYMENU_REMOVE_MANIFEST 4
+#define TRAYMENU_ROTATE_0 5
+#define TRAYMENU_ROTATE_90 6
+#define TRAYMENU_ROTATE_180 7
+#define TRAYMENU_ROTATE_270 8
+#define TRAYMENU_OVERLAY_OPAQUE 9
+#define TRAYMENU_OVERLAY_TRANSPARENT 10
+#define TRAYMENU_TOGGLE_DISTORTION_MAP 11
+#define TRAYMENU_TOGGLE_WIDTH 12
+#define TRAYMENU_LOG_STATISTICS 13
+#define TRAYMENU_TOGGLE_REPROJECTION 14
+#define TRAYMENU_WRITE_TRACE 15
+#define TRAYMENU_TOGGLE_STEREO 16
+#define TRAYMENU_TOGGLE_SWIPE_SOURCE 17
+#define TRAYMENU_TOGGLE_HAND_HIGHLIGHT 18
+#define TRAYMENU_TOGGLE_RECORDING 19
+#define TRAYMENU_TOGGLE_DEPTH 20
+
+GLuint display_fullscreenQuadVAO;
+GLuint display_fullscreenQuadBuffer;
+GLuint display_fullscreenQuadUVs;
+GLuint display_shaderProgram;
+GLuint display_textureSamplerID;
+WNDPROC defaultWndProc;
+GLFWwindow* globalWindow;
+bool globalKeepRunning = true;
+
+const char* display_vertexShaderCode = k_fullscreenVertexShader;
+const GLint display_vertexShaderCodeLength = sizeof(k_fullscreenVertexShader) - 1;
+
+const char* display_fragmentShaderCode = k_previewFragmentShader;
+const GLint display_fragmentShaderCodeLength = sizeof(k_previewFragmentShader) - 1;
+
+static const GLfloat g_quad_vertex_buffer_data[] = {
+	-1.0f, -1.0f, 0.0f,
+	1.0f, -1.0f, 0.0f,
+	-1.0f,  1.0f, 0.0f,
+	-1.0f,  1.0f, 0.0f,
+	1.0f,  1.0f, 0.0f,
+	1.0f, -1.0f, 0.0f,
+};
+
+static const GLfloat g_quad_uvs_buffer_data[] = {
+	0.0f, 0.0f,
+	1.0f, 0.0f,
+	0.0f,  1.0f,
+	0.0f,  1.0f,
+	1.0f,  1.0f,
+	1.0f, 0.0f,
+};
+
+bool display_init() {
+	display_shaderProgram = ProgramCache::getInstance()->linkProgram("preview", display_vertexShaderCode, display_vertexShaderCodeLength, display_fragmentShaderCode, display_fragmentShaderCodeLength);
+
+	if (display_shaderProgram == 0) return false;
+
+	display_textureSamplerID = glGetUniformLocation(display_shaderProgram, "textureSampler");
+
+	glGenVertexArrays(1, &display_fullscreenQuadVAO);
+	glBindVertexArray(display_fullscreenQuadVAO);
+
+	glGenBuffers(1, &display_fullscreenQuadBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, display_fullscreenQuadBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(g_quad_vertex_buffer_data), g_quad_vertex_buffer_data, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &display_fullscreenQuadUVs);
+	glBindBuffer(GL_ARRAY_BUFFER, display_fullscreenQuadUVs);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(g_quad_uvs_buffer_data), g_quad_uvs_buffer_data, GL_STATIC_DRAW);
+
+	return true;
+}
+
+void display_render() {
+	TRACE_SCOPE("display_render");
+
+	GraphicsManager* graphicsManager = GraphicsManager::getInstance();
+
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	glUseProgram(display_shaderProgram);
+
+	glUniform1i(display_textureSamplerID, 0);
+	glBindTexture(GL_TEXTURE_2D, graphicsManager->getVideoTexture());
+
+	glEnableVertexAttribArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, display_fullscreenQuadBuffer);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+	glEnableVertexAttribArray(1);
+	glBindBuffer(GL_ARRAY_BUFFER, display_fullscreenQuadUVs);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+	glDrawArrays(GL_TRIANGLES, 0, 6);
+	glDisableVertexAttribArray(0);
+	glDisableVertexAttribArray(1);
+
+	glEnd();
+	glFlush();
+}
+
+void addTrayIcon(HINSTANCE hInstance, HWND hWnd, UINT uID) {
+	NOTIFYICONDATA nid;
+	nid.hWnd = hWnd;
+	nid.uID = uID;
+	nid.uFlags = NIF_TIP | NIF_MESSAGE | NIF_ICON;
+	nid.uCallbackMessage = WM_APP;
+	nid.hIcon = LoadIcon(hInstance, MAKEINTRESOURCE(IDI_ICON1));
+	wcscpy_s(nid.szTip, L"Leap Motion SteamVR Overlay");
+	
+	Shell_NotifyIcon(NIM_ADD, &nid);
+}
+
+void removeTrayIcon(HWND hWnd, UINT uID) {
+	NOTIFYICONDATA nid;
+	nid.hWnd = hWnd;
+	nid.uID = uID;
+
+	Shell_NotifyIcon(NIM_DELETE, &nid);
+}
+
+void showTrayMenu(HWND hWnd, POINT *curpos, int wDefaultItem) {
+	OVROverlayController* vrController = OVROverlayController::getInstance();
+
+	HMENU hPopup = CreatePopupMenu();
+	uint32_t pos = 0;
+
+	InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_ROTATE_0, L"Reset overlay rotation");
+	InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_ROTATE_90, L"Rotate overlay 90 degrees");
+	InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_ROTATE_180, L"Rotate overlay 180 degrees");
+	InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_ROTATE_270, L"Rotate overlay 270 degrees");
+	InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_OVERLAY_OPAQUE, L"Set overlay to be opaque");
+	InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_OVERLAY_TRANSPARENT, L"Set overlay to be transparent");
+	InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_TOGGLE_DISTORTION_MAP, L"Toggle distortion correction");
+	InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_TOGGLE_WIDTH, L"Toggle smaller overlay");
+	InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_TOGGLE_REPROJECTION, L"Toggle head motion compensation");
+	InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_TOGGLE_STEREO, L"Toggle stereo overlay");
+	InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_TOGGLE_SWIPE_SOURCE, L"Switch swipe detection method");
+	InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_TOGGLE_HAND_HIGHLIGHT, L"Toggle hand highlight");
+
+	InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_SEPARATOR, 0, 0);
+
+	InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_SHOW, L"Show Window");
+	InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_LOG_STATISTICS, L"Log frame statistics");
+#ifdef ENABLE_TRACING
+	InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_WRITE_TRACE, L"Write trace file");
+#endif
+	InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_TOGGLE_RECORDING, LeapHandler::getInstance()->isRecording() ? L"Stop recording camera images" : L"Record camera images");
+	InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_TOGGLE_DEPTH, LeapHandler::getInstance()->isDepthEnabled() ? L"Stop estimating depth" : L"Estimate depth (experimental)");
+
+	// the manifest can only be changed through a running SteamVR
+	if (vrController->isManifestInstalled()) {
+		InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_REMOVE_MANIFEST, L"Unregister from SteamVR");
+	} else if (vrController->isConnected()) {
+		InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_INSTALL_MANIFEST, L"Register with SteamVR");
+	}
+
+	InsertMenu(hPopup, pos++, MF_BYPOSITION | MF_STRING, TRAYMENU_EXIT, L"Exit");
+
+	POINT pt;
+	if (!curpos) {
+		GetCursorPos(&pt);
+		curpos = &pt;
+	}
+
+	WORD cmd = TrackPopupMenu(hPopup, TPM_LEFTALIGN | TPM_RIGHTBUTTON | TPM_RETURNCMD | TPM_NONOTIFY, curpos->x, curpos->y, 0, hWnd, NULL);
+	SendMessage(hWnd, WM_COMMAND, cmd, 0);
+
+	DestroyMenu(hPopup);
+}
+
+static LRESULT CALLBACK WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam, UINT_PTR uIdSubclass, DWORD_PTR dwRefData) {
+	OVROverlayController* vrController = OVROverlayController::getInstance();
+	GraphicsManager* graphicsManager = GraphicsManager::getInstance();
+
+	switch (uMsg) {
+		case WM_APP:
+			switch (lParam) {
+				case WM_LBUTTONDBLCLK:
+					glfwShowWindow(globalWindow);
+					return 0;
+				case WM_RBUTTONUP:
+					SetForegroundWindow(hWnd);
+					showTrayMenu(hWnd, NULL, -1);
+					return 0;
+			}
+			return 0;
+		case WM_COMMAND:
+			switch (wParam) {
+				case TRAYMENU_EXIT:
+					globalKeepRunning = false;
+					return 0;
+				case TRAYMENU_SHOW:
+					glfwShowWindow(globalWindow);
+					return 0;
+				case TRAYMENU_INSTALL_MANIFEST:
+					if (vrController->installManifest()) {
+						MessageBox(NULL, L"Application successfully registered!", L"Leap Motion Overlay", MB_OK | MB_ICONINFORMATION);
+					} else {
+						MessageBox(NULL, L"Manifest installation failed!", L"Leap Motion Overlay", MB_OK | MB_ICONERROR);
+					}
+					return 0;
+				case TRAYMENU_REMOVE_MANIFEST:
+					if (vrController->removeManifest()) {
+						MessageBox(NULL, L"Application successfully unregistered!", L"Leap Motion Overlay", MB_OK | MB_ICONINFORMATION);
+					} else {
+						MessageBox(NULL, L"Manifest removal failed!", L"Leap Motion Overlay", MB_OK | MB_ICONERROR);
+					}
+					return 0;
+				case TRAYMENU_ROTATE_0:
+					vrController->setOverlayRotation(0);
+					return 0;
+				case TRAYMENU_ROTATE_90:
+					vrController->setOverlayRotation(3);
+					return 0;
+				case TRAYMENU_ROTATE_180:
+					vrController->setOverlayRotation(2);
+					return 0;
+				case TRAYMENU_ROTATE_270:
+					vrController->setOverlayRotation(1);
+					return 0;
+				case TRAYMENU_OVERLAY_OPAQUE:
+					vrController->setOverlayAlpha(1.0f);
+					return 0;
+				case TRAYMENU_OVERLAY_TRANSPARENT:
+					vrController->setOverlayAlpha(0.5f);
+					return 0;
+				case TRAYMENU_TOGGLE_DISTORTION_MAP:
+					graphicsManager->setDistortionMapActive(!graphicsManager->getDistortionMapActive());
+					return 0;
+				case TRAYMENU_TOGGLE_REPROJECTION:
+					vrController->setReprojectionEnabled(!vrController->getReprojectionEnabled());
+					return 0;
+				case TRAYMENU_TOGGLE_SWIPE_SOURCE: {
+					LeapHandler* leapHandler = LeapHandler::getInstance();
+					SwipeSource source = static_cast<SwipeSource>((leapHandler->getSwipeSource() + 1) % SwipeSource_Count);
+					leapHandler->setSwipeSource(source);
+
+					const char* sourceNames[SwipeSource_Count] = { "motion", "foreground", "tracking" };
+					LOG_INFO("Swipe detection uses {}", sourceNames[source]);
+					return 0;
+				}
+				case TRAYMENU_TOGGLE_RECORDING:
+					LeapHandler::getInstance()->setRecording(!LeapHandler::getInstance()->isRecording());
+					return 0;
+				case TRAYMENU_TOGGLE_DEPTH:
+					LeapHandler::getInstance()->setDepthEnabled(!LeapHandler::getInstance()->isDepthEnabled());
+					LOG_INFO("Depth estimation {}", LeapHandler::getInstance()->isDepthEnabled() ? "on" : "off");
+					return 0;
+				case TRAYMENU_TOGGLE_HAND_HIGHLIGHT:
+					graphicsManager->setHighlightEnabled(!graphicsManager->getHighlightEnabled());
+					return 0;
+				case TRAYMENU_TOGGLE_STEREO:
+					vrController->setStereo(!vrController->getStereo());
+					graphicsManager->setStereo(vrController->getStereo());
+					return 0;
+				case TRAYMENU_LOG_STATISTICS:
+					vrController->logStatistics();
+					graphicsManager->logStatistics();
+					LatencyTracker::getInstance()->logStatistics();
+					if (LeapHandler::getInstance()->isDepthEnabled()) {
+						StereoMatcher::getInstance()->logStatistics();
+					}
+					LeapHandler::getInstance()->logStatistics();
+					return 0;
+				case TRAYMENU_WRITE_TRACE: {
+					std::filesystem::path tracePath = std::filesystem::current_path() / "trace.json";
+
+					if (Tracer::getInstance()->writeChromeTrace(tracePath)) {
+						LOG_INFO("Trace written to {}", tracePath.string());
+					} else {
+						LOG_ERROR("Failed to write trace to {}", tracePath.string());
+					}
+
+					return 0;
+				}
+				case TRAYMENU_TOGGLE_WIDTH: {
+					float currentWidth = vrController->getOverlayWidth();
+					vrController->setOverlayWidth((currentWidth > 0.4) ? 0.3 : 0.5);
+					return 0;
+				}
+			}
+			return 0;
+		case WM_NCDESTROY:
+			RemoveWindowSubclass(hWnd, WndProc, uIdSubclass);
+			return DefSubclassProc(hWnd, uMsg, wParam, lParam);
+	}
+
+	return DefSubclassProc(hWnd, uMsg, wParam, lParam);
+}
+
+int APIENTRY WinMain(HINSTANCE hInstance,
+	HINSTANCE /*hPrevInstance*/,
+	LPSTR /*lpCmdLine*/,
+	int /*cmdShow*/)
+{
+	int64_t startTime = getHostTimeMicroseconds();
+
+	TRACE_THREAD_NAME("Main");
+
+	// LEAP_OVERLAY_LOG can be set to "stderr" or a file path to get the log somewhere other than the debugger
+	char logTarget[MAX_PATH];
+	DWORD logTargetLength = GetEnvironmentVariableA("LEAP_OVERLAY_LOG", logTarget, MAX_PATH);
+	if (logTargetLength > 0 && logTargetLength < MAX_PATH) {
+		if (strcmp(logTarget, "stderr") == 0) {
+			Logger::getInstance()->addSink(std::make_unique<StderrSink>());
+		} else {
+			Logger::getInstance()->addSink(std::make_unique<FileSink>(logTarget));
+		}
+	}
+
+	bool synthetic = false;
+	int startupBenchmarkRuns = 0;
+	const char* startupTimingsPath = nullptr;
+
+	for (int i = 1; i < __argc; i++) {
+		// --pipeline-benchmark [frame rate] [submit latency] runs generated frames through the whole pipeline into a mock compositor and exits
+		if (strcmp(__argv[i], "--pipeline-benchmark") == 0) {
+			int frameRate = (i + 1 < __argc) ? atoi(__argv[i + 1]) : 0;
+			int64_t submitLatency = (i + 2 < __argc) ? atoll(__argv[i + 2]) : 0;
+			int result = runPipelineBenchmark("pipeline-benchmark.json", frameRate, submitLatency);
+			Logger::getInstance()->shutdown();
+			return result;
+		}
+
+		// --replay <session> [foreground|tracking] runs a recording through the swipe detection and the overlay logic as fast as possible and exits
+		if (strcmp(__argv[i], "--replay") == 0 && i + 1 < __argc) {
+			SwipeSource source = SwipeSource_Motion;
+
+			if (i + 2 < __argc && strcmp(__argv[i + 2], "foreground") == 0) {
+				source = SwipeSource_Foreground;
+			} else if (i + 2 < __argc && strcmp(__argv[i + 2], "tracking") == 0) {
+				source = SwipeSource_Tracking;
+			}
+
+			int result = runReplay(__argv[i + 1], source);
+			Logger::getInstance()->shutdown();
+			return result;
+		}
+
+		// --evaluate <directory> scores the swipe detection on the recorded sessions in a directory and exits
+		if (strcmp(__argv[i], "--evaluate") == 0 && i + 1 < __argc) {
+			int result = runEvaluation(__argv[i + 1]);
+			Logger::getInstance()->shutdown();
+			return result;
+		}
+
+		// --generate-sessions <directory> [count] writes labelled synthetic sessions to evaluate on
+		if (strcmp(__argv[i], "--generate-sessions") == 0 && i + 1 < __argc) {
+			int result = generateSessions(__argv[i + 1], (i + 2 < __argc) ? atoi(__argv[i + 2]) : 4);
+			Logger::getInstance()->shutdown();
+			return result;
+		}
+
+		// --startup-benchmark [runs] starts the application over and over and measures how long each part of the startup takes
+		if (strcmp(__argv[i], "--startup-benchmark") == 0) {
+			startupBenchmarkRuns = (i + 1 < __argc) ? atoi(__argv[i + 1]) : 0;
+			if (startupBenchmarkRuns <= 0) startupBenchmarkRuns = 10;
+		}
+
+		// --startup-timings <file> writes how long each startup task took and exits once all of them are done
+		if (strcmp(__argv[i], "--startup-timings") == 0 && i + 1 < __argc) {
+			startupTimingsPath = __argv[i + 1];
+		}
+
+		// --synthetic replaces the Leap Motion controller with generated frames and a swipe every few seconds
+		if (strcmp(__argv[i], "--synthetic") == 0) {
+			synthetic = true;
+		}
+	}
+
+	if (startupBenchmarkRuns > 0) {
+		int result = runStartupBenchmark("startup-benchmark.json", startupBenchmarkRuns, synthetic);
+		Logger::getInstance()->shutdown();
+		return result;
+	}
+
+	OVROverlayController* vrController = OVROverlayController::getInstance();
+	LeapHandler* leapHandler = LeapHandler::getInstance();
+	GraphicsManager* graphicsManager = GraphicsManager::getInstance();
+	MainLoop mainLoop(SteadyClock::getInstance());
+	vrController->setSink(std::make_unique<OpenVROverlaySink>());
+
+	// the window and everything on its GL context stay on this thread, VR_Init and the Leap connection
+	// each get a thread of their own. The singletons above are created first since they are not safe to race for
+	StartupGraph startup(startTime);
+	HWND windowHandle = NULL;
+
+	StartupGraph::TaskId windowTask = startup.addTask("window", [&]() {
+		if (!glfwInit()) {
+			MessageBox(NULL, L"GLFW failed to initialize!", L"Leap Motion SteamVR Overlay", MB_OK | MB_ICONERROR);
+			LOG_ERROR("GLFW failed to initialize!");
+			return false;
+		}
+
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		globalWindow = glfwCreateWindow(640, 480, "Leap Motion SteamVR Overlay", NULL, NULL);
+		windowHandle = glfwGetWin32Window(globalWindow);
+
+		//defaultWndProc = (WNDPROC)GetWindowLongPtr(windowHandle, GWLP_WNDPROC);
+		//SetWindowLongPtr(windowHandle, GWLP_WNDPROC, (long)WndProc);
+
+		SetWindowSubclass(windowHandle, WndProc, 1, 0);
+
+		glfwMakeContextCurrent(globalWindow);
+		glfwSwapInterval(0); // the loop is paced by the compositor, not by the monitor
+		return true;
+	}, {}, true);
+
+	StartupGraph::TaskId glewTask = startup.addTask("GLEW", [&]() {
+		GLenum err = glewInit();
+		if (err != GLEW_OK) {
+			MessageBox(NULL, L"GLEW failed to initialize!", L"Leap Motion SteamVR Overlay", MB_OK | MB_ICONERROR);
+			LOG_ERROR("glewInit Error: {}", glewGetErrorString(err));
+			return false;
+		}
+
+		LOG_INFO("OpenGL version: {}", glGetString(GL_VERSION));
+		return true;
+	}, { windowTask }, true);
+
+	StartupGraph::TaskId graphicsTask = startup.addTask("graphics", [&]() {
+		if (!graphicsManager->init()) {
+			MessageBox(NULL, L"GraphicsManager failed to initialize!", L"Leap Motion SteamVR Overlay", MB_OK | MB_ICONERROR);
+			LOG_ERROR("Graphics Manager initialization failed!");
+			return false;
+		}
+
+		return true;
+	}, { glewTask }, true);
+
+	StartupGraph::TaskId displayTask = startup.addTask("preview window", [&]() {
+		// only the window shown from the tray menu needs this, the overlay works without it
+		return display_init();
+	}, { glewTask }, true);
+
+	startup.addTask("tray icon", [&]() {
+		addTrayIcon(hInstance, windowHandle, 1);
+		return true;
+	}, { windowTask }, true);
+
+	// the icon is decoded and scaled down at build time by AssetBaker
+	startup.addTask("window icon", [&]() {
+		GLFWimage images[std::size(k_iconImages)];
+
+		for (size_t i = 0; i < std::size(k_iconImages); i++) {
+			images[i] = { k_iconImages[i].width, k_iconImages[i].height, const_cast<unsigned char*>(k_iconImages[i].pixels) };
+		}
+
+		glfwSetWindowIcon(globalWindow, static_cast<int>(std::size(images)), images);
+		return true;
+	}, { windowTask }, true);
+
+	// the overlay only needs the runtime, the texture is created on the main thread anyway
+	StartupGraph::TaskId vrTask = startup.addTask("VR runtime", [&]() {
+		vrController->init();
+		return vrController->isConnected();
+	});
+
+	// the Leap service takes up to a second to answer, frames show up in the overlay whenever it is connected
+	startup.addTask("Leap Motion", [&]() {
+		if (synthetic) {
+			FrameGeneratorConfig config;
+			config.swipes = makeSwipeSequence(12, 3000000, 400000);
+			config.loopDuration = 13 * 3000000;
+			return leapHandler->openSynthetic(config);
+		} else {
+			return leapHandler->openConnection();
+		}
+	});
+
+	startup.run({ graphicsTask, displayTask, vrTask });
+
+	if (!startup.succeeded(graphicsTask)) {
+		startup.join();
+		leapHandler->join();
+		Logger::getInstance()->shutdown();
+		return 1;
+	}
+
+	// the startup benchmark only measures the way up, including the tasks nobody waited for
+	if (startupTimingsPath != nullptr) {
+		startup.join();
+		startup.writeTimings(startupTimingsPath);
+		globalKeepRunning = false;
+	}
+
+	//vrController->showOverlay();
+
+	glfwSetWindowCloseCallback(globalWindow, [](GLFWwindow* wnd) {
+		glfwHideWindow(wnd);
+	});
+
+	bool firstFrameSubmitted = false;
+
+	while (globalKeepRunning) {
+		MainLoopTick tick = mainLoop.tick();
+
+		if (tick.frameSubmitted && !firstFrameSubmitted) {
+			firstFrameSubmitted = true;
+			LOG_INFO("Startup: first frame submitted after {} ms", (getHostTimeMicroseconds() - startTime) / 1000.0);
+		}
+
+		bool previewVisible = glfwGetWindowAttrib(globalWindow, GLFW_VISIBLE);
+
+		if (previewVisible) {
+			int width, height;
+
+			// bind output window as framebuffer
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+			glfwGetFramebufferSize(globalWindow, &width, &height);
+
+			glViewport(0, 0, width, height);
+
+			display_render();
+
+			glfwSwapBuffers(globalWindow);
+		}
+
+		if (tick.submitting) {
+			glfwPollEvents();
+		} else if (vrController->isConnected() || previewVisible) {
+			glfwWaitEventsTimeout(1.0 / 60.0); // aim for roughly 60fps when the overlay is not displayed
+		} else {
+			glfwWaitEventsTimeout(0.25); // nothing is shown anywhere until SteamVR is back, the tray menu still wakes the loop
+		}
+	}
+
+	removeTrayIcon(windowHandle, 1);
+
+	glfwDestroyWindow(globalWindow);
+	glfwTerminate();
+
+	startup.join();
+	leapHandler->join();
+
+	Logger::getInstance()->shutdown();
+
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+	return WinMain(GetModuleHandle(NULL), NULL, GetCommandLineA(), SW_SHOWNORMAL);
 }
\ No newline at end of file
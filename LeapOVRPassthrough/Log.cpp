@@ -0,0 +1,332 @@
+#include "Log.h"
+#include "utils.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+const char* levelNames[] = { "debug", "info", "warning", "error" };
+
+// hands the ring back to the logger when the thread exits, thread pool and startup threads come and go
+struct ThreadLogRing {
+	LogRing* ring { nullptr };
+
+	~ThreadLogRing() {
+		if (ring != nullptr) {
+			ring->retire();
+			ring = nullptr;
+		}
+	}
+};
+
+thread_local ThreadLogRing t_logRing;
+
+Logger* s_logger = nullptr;
+
+LogRing::LogRing() :
+	m_records(new LogRecord[k_capacity])
+{
+}
+
+LogRecord* LogRing::beginWrite()
+{
+	uint64_t write = m_writeIndex.load(std::memory_order_relaxed);
+
+	if (write - m_readIndex.load(std::memory_order_acquire) >= k_capacity) {
+		return nullptr; // full, the record gets dropped
+	}
+
+	return &m_records[write & (k_capacity - 1)];
+}
+
+void LogRing::endWrite()
+{
+	m_writeIndex.store(m_writeIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+const LogRecord* LogRing::peek()
+{
+	uint64_t read = m_readIndex.load(std::memory_order_relaxed);
+
+	if (read == m_writeIndex.load(std::memory_order_acquire)) {
+		return nullptr;
+	}
+
+	return &m_records[read & (k_capacity - 1)];
+}
+
+void LogRing::pop()
+{
+	m_readIndex.store(m_readIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void LogRing::retire()
+{
+	m_retired.store(true, std::memory_order_release);
+}
+
+bool LogRing::isRetired()
+{
+	return m_retired.load(std::memory_order_acquire);
+}
+
+void LogRing::reuse()
+{
+	// the read index has caught up with the write index, so the ring is empty already
+	m_retired.store(false, std::memory_order_relaxed);
+}
+
+void DebugOutputSink::write(LogLevel, const char* line)
+{
+#ifdef _WIN32
+	OutputDebugStringA(line);
+#else
+	(void)line;
+#endif
+}
+
+void StderrSink::write(LogLevel, const char* line)
+{
+	fputs(line, stderr);
+}
+
+FileSink::FileSink(const std::string& path)
+{
+	if (fopen_s(&m_file, path.c_str(), "a") != 0) {
+		m_file = nullptr;
+	}
+}
+
+FileSink::~FileSink()
+{
+	if (m_file != nullptr) {
+		fclose(m_file);
+	}
+}
+
+bool FileSink::isOpen()
+{
+	return m_file != nullptr;
+}
+
+void FileSink::write(LogLevel, const char* line)
+{
+	if (m_file != nullptr) {
+		fputs(line, m_file);
+		fflush(m_file);
+	}
+}
+
+Logger* Logger::getInstance()
+{
+	if (s_logger == nullptr) {
+		s_logger = new Logger();
+	}
+
+	return s_logger;
+}
+
+Logger::Logger() :
+	m_startTime(now())
+{
+	m_sinks.push_back(std::make_unique<DebugOutputSink>());
+
+	m_thread = std::thread([this]() {
+		this->run();
+	});
+}
+
+Logger::~Logger()
+{
+	shutdown();
+}
+
+void Logger::addSink(std::unique_ptr<LogSink> sink)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_addedSinks.push_back(std::move(sink));
+}
+
+void Logger::shutdown()
+{
+	if (m_running.exchange(false) && m_thread.joinable()) {
+		m_thread.join();
+	}
+}
+
+uint64_t Logger::getDroppedCount()
+{
+	return m_dropped.load(std::memory_order_relaxed);
+}
+
+LogRing* Logger::threadRing()
+{
+	if (t_logRing.ring == nullptr) {
+		t_logRing.ring = getInstance()->registerThread();
+	}
+
+	return t_logRing.ring;
+}
+
+int64_t Logger::now()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Logger::packString(LogRecord& record, LogArg& packed, const char* str, size_t length)
+{
+	uint32_t available = k_logStringStorage - record.stringsUsed;
+
+	packed.type = LogArgType_String;
+	packed.value.stringOffset = record.stringsUsed;
+
+	if (available == 0) {
+		return; // can't happen for the first string, later ones get truncated to nothing
+	}
+
+	size_t copied = (length < available - 1) ? length : available - 1;
+	memcpy(&record.strings[record.stringsUsed], str, copied);
+	record.strings[record.stringsUsed + copied] = '\0';
+	record.stringsUsed += static_cast<uint32_t>(copied + 1);
+}
+
+LogRing* Logger::registerThread()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (!m_freeRings.empty()) {
+		m_rings.push_back(std::move(m_freeRings.back()));
+		m_freeRings.pop_back();
+		m_rings.back()->reuse();
+	} else {
+		m_rings.push_back(std::make_unique<LogRing>());
+	}
+
+	return m_rings.back().get();
+}
+
+void Logger::run()
+{
+	while (m_running.load()) {
+		if (!drain()) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+	}
+
+	drain(); // write out whatever was logged during shutdown
+}
+
+bool Logger::drain()
+{
+	char line[1024];
+	bool wroteSomething = false;
+
+	{
+		// only the logger thread removes rings, so the pointers stay valid after unlocking
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		m_drainRings.clear();
+
+		for (auto& ring : m_rings) {
+			m_drainRings.push_back(ring.get());
+		}
+
+		for (auto& sink : m_addedSinks) {
+			m_sinks.push_back(std::move(sink));
+		}
+
+		m_addedSinks.clear();
+	}
+
+	for (LogRing* ring : m_drainRings) {
+		// checked before draining, a retired ring is empty afterwards because its thread is gone
+		bool retired = ring->isRetired();
+		const LogRecord* record;
+
+		while ((record = ring->peek()) != nullptr) {
+			format(*record, line, sizeof(line));
+
+			for (auto& sink : m_sinks) {
+				sink->write(record->level, line);
+			}
+
+			ring->pop();
+			wroteSomething = true;
+		}
+
+		if (retired) {
+			releaseRing(ring);
+		}
+	}
+
+	return wroteSomething;
+}
+
+void Logger::releaseRing(LogRing* ring)
+{
+	std::unique_ptr<LogRing> released;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		for (auto it = m_rings.begin(); it != m_rings.end(); ++it) {
+			if (it->get() == ring) {
+				released = std::move(*it);
+				m_rings.erase(it);
+				break;
+			}
+		}
+
+		if (released != nullptr && m_freeRings.size() < k_maxFreeRings) {
+			m_freeRings.push_back(std::move(released));
+		}
+	}
+
+	// anything that isn't kept is freed outside the lock
+}
+
+size_t Logger::format(const LogRecord& record, char* output, size_t size)
+{
+	int64_t elapsed = record.timestamp - m_startTime;
+	int written = snprintf(output, size, "[%lld.%03lld %s] ", static_cast<long long>(elapsed / 1000000), static_cast<long long>((elapsed / 1000) % 1000), levelNames[record.level]);
+	size_t pos = (written > 0) ? static_cast<size_t>(written) : 0;
+
+	const char* fmt = record.format;
+	uint32_t argIndex = 0;
+
+	// always keep space for the newline and the terminator
+	while (*fmt != '\0' && pos < size - 2) {
+		if (fmt[0] == '{' && fmt[1] == '}' && argIndex < record.argCount) {
+			const LogArg& arg = record.args[argIndex++];
+			size_t available = size - 1 - pos;
+
+			switch (arg.type) {
+				case LogArgType_Int:
+					written = snprintf(&output[pos], available, "%lld", static_cast<long long>(arg.value.i));
+					break;
+				case LogArgType_UInt:
+					written = snprintf(&output[pos], available, "%llu", static_cast<unsigned long long>(arg.value.u));
+					break;
+				case LogArgType_Double:
+					written = snprintf(&output[pos], available, "%g", arg.value.d);
+					break;
+				case LogArgType_String:
+					written = snprintf(&output[pos], available, "%s", &record.strings[arg.value.stringOffset]);
+					break;
+			}
+
+			if (written > 0) {
+				pos += (static_cast<size_t>(written) < available) ? written : available - 1;
+			}
+
+			fmt += 2;
+		} else {
+			output[pos++] = *fmt++;
+		}
+	}
+
+	output[pos++] = '\n';
+	output[pos] = '\0';
+
+	return pos;
+}
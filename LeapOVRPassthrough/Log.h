@@ -0,0 +1,213 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Asynchronous logger. The calling thread only copies the format string pointer and the raw arguments into
+// its own preallocated ring buffer, formatting and writing to the sinks happens on a background thread.
+// Placeholders in the format string are written as {}. A thread's ring goes back to the logger when the thread
+// exits and is reused by the next thread that logs.
+//
+// Log statements below LOG_MIN_LEVEL are removed at compile time.
+
+enum LogLevel {
+	LogLevel_Debug = 0,
+	LogLevel_Info,
+	LogLevel_Warning,
+	LogLevel_Error,
+};
+
+#ifndef LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define LOG_MIN_LEVEL LogLevel_Info
+#else
+#define LOG_MIN_LEVEL LogLevel_Debug
+#endif
+#endif
+
+const uint32_t k_maxLogArgs = 6;
+const uint32_t k_logStringStorage = 384;
+
+enum LogArgType : uint8_t {
+	LogArgType_Int,
+	LogArgType_UInt,
+	LogArgType_Double,
+	LogArgType_String, // copied into LogRecord::strings, value.stringOffset points at it
+};
+
+struct LogArg {
+	LogArgType type;
+	union {
+		int64_t i;
+		uint64_t u;
+		double d;
+		uint32_t stringOffset;
+	} value;
+};
+
+struct LogRecord {
+	LogLevel level;
+	int64_t timestamp;
+	const char* format; // has to be a string literal
+	uint32_t argCount;
+	uint32_t stringsUsed;
+	LogArg args[k_maxLogArgs];
+	char strings[k_logStringStorage];
+};
+
+// single producer (the owning thread), single consumer (the logger thread)
+class LogRing
+{
+public:
+	static const uint32_t k_capacity = 1024; // has to be a power of two
+
+	LogRing();
+
+	LogRecord* beginWrite();
+	void endWrite();
+	const LogRecord* peek();
+	void pop();
+
+	// called by the owning thread when it exits, nothing gets written after that
+	void retire();
+	bool isRetired();
+	void reuse();
+
+private:
+	std::unique_ptr<LogRecord[]> m_records;
+	std::atomic<uint64_t> m_writeIndex { 0 };
+	std::atomic<uint64_t> m_readIndex { 0 };
+	std::atomic<bool> m_retired { false };
+};
+
+class LogSink
+{
+public:
+	virtual ~LogSink() {}
+	virtual void write(LogLevel level, const char* line) = 0;
+};
+
+// OutputDebugString, visible in the debugger or DebugView. Writes nothing on other platforms
+class DebugOutputSink : public LogSink
+{
+public:
+	void write(LogLevel level, const char* line) override;
+};
+
+class StderrSink : public LogSink
+{
+public:
+	void write(LogLevel level, const char* line) override;
+};
+
+class FileSink : public LogSink
+{
+public:
+	FileSink(const std::string& path);
+	~FileSink();
+
+	bool isOpen();
+	void write(LogLevel level, const char* line) override;
+
+private:
+	FILE* m_file { nullptr };
+};
+
+class Logger
+{
+public:
+	static Logger* getInstance();
+
+	Logger();
+	~Logger();
+
+	void addSink(std::unique_ptr<LogSink> sink);
+	void shutdown();
+	uint64_t getDroppedCount();
+
+	template<typename... Args>
+	static void log(LogLevel level, const char* format, const Args&... args) {
+		LogRing* ring = threadRing();
+		LogRecord* record = ring->beginWrite();
+
+		if (record == nullptr) {
+			getInstance()->m_dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		record->level = level;
+		record->timestamp = now();
+		record->format = format;
+		record->argCount = 0;
+		record->stringsUsed = 0;
+
+		(packArg(*record, args), ...);
+
+		ring->endWrite();
+	}
+
+private:
+	static LogRing* threadRing();
+	static int64_t now();
+
+	template<typename T>
+	static void packArg(LogRecord& record, const T& arg) {
+		if (record.argCount >= k_maxLogArgs) return;
+
+		LogArg& packed = record.args[record.argCount++];
+
+		if constexpr (std::is_floating_point<T>::value) {
+			packed.type = LogArgType_Double;
+			packed.value.d = static_cast<double>(arg);
+		} else if constexpr (std::is_enum<T>::value) {
+			packed.type = LogArgType_Int;
+			packed.value.i = static_cast<int64_t>(arg);
+		} else if constexpr (std::is_integral<T>::value && std::is_signed<T>::value) {
+			packed.type = LogArgType_Int;
+			packed.value.i = static_cast<int64_t>(arg);
+		} else if constexpr (std::is_integral<T>::value) {
+			packed.type = LogArgType_UInt;
+			packed.value.u = static_cast<uint64_t>(arg);
+		} else if constexpr (std::is_same<T, std::string>::value) {
+			packString(record, packed, arg.c_str(), arg.length());
+		} else {
+			// anything else has to be some kind of C string (char arrays, const char*, const GLubyte*)
+			const char* str = static_cast<const char*>(static_cast<const void*>(arg));
+			packString(record, packed, str, (str != nullptr) ? strlen(str) : 0);
+		}
+	}
+
+	static void packString(LogRecord& record, LogArg& packed, const char* str, size_t length);
+
+	LogRing* registerThread();
+	void run();
+	bool drain();
+	void releaseRing(LogRing* ring);
+	size_t format(const LogRecord& record, char* output, size_t size);
+
+	static const size_t k_maxFreeRings = 4; // kept for the next thread, any more retired rings are freed
+
+	std::mutex m_mutex; // guards m_rings, m_freeRings and m_addedSinks
+	std::vector<std::unique_ptr<LogRing>> m_rings;
+	std::vector<std::unique_ptr<LogRing>> m_freeRings;
+	std::vector<std::unique_ptr<LogSink>> m_addedSinks; // picked up by the logger thread on its next drain
+	// only used by the logger thread, so that formatting and the sinks run without holding m_mutex
+	std::vector<LogRing*> m_drainRings;
+	std::vector<std::unique_ptr<LogSink>> m_sinks;
+	std::atomic<bool> m_running { true };
+	std::atomic<uint64_t> m_dropped { 0 };
+	int64_t m_startTime;
+	std::thread m_thread;
+};
+
+#define LOG_AT(level, ...) do { if constexpr ((level) >= LOG_MIN_LEVEL) { Logger::log((level), __VA_ARGS__); } } while (0)
+#define LOG_DEBUG(...) LOG_AT(LogLevel_Debug, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LogLevel_Info, __VA_ARGS__)
+#define LOG_WARNING(...) LOG_AT(LogLevel_Warning, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LogLevel_Error, __VA_ARGS__)
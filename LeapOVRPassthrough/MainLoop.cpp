@@ -0,0 +1,55 @@
+#include "MainLoop.h"
+#include "LeapHandler.h"
+#include "GraphicsManager.h"
+#include "OVROverlayController.h"
+#include "Clock.h"
+#include "Trace.h"
+
+MainLoop::MainLoop(Clock* clock) :
+	m_clock(clock),
+	m_leapHandler(LeapHandler::getInstance()),
+	m_graphicsManager(GraphicsManager::getInstance()),
+	m_vrController(OVROverlayController::getInstance())
+{
+	m_leapHandler->setClock(clock);
+	m_graphicsManager->setClock(clock);
+	m_vrController->setClock(clock);
+}
+
+MainLoopTick MainLoop::tick()
+{
+	TRACE_SCOPE("MainLoop::tick");
+
+	MainLoopTick tick;
+	tick.time = m_clock->now();
+
+	// SteamVR going away doesn't end the loop, the controller reconnects once it is back
+	m_vrController->updateConnection();
+	m_vrController->pollEvents();
+
+	m_leapHandler->setOverlayVisible(m_vrController->isOverlayVisible());
+	m_leapHandler->updateTracking(m_vrController->getPredictedPhotonTime());
+
+	tick.swipe = m_leapHandler->pollSwipe();
+
+	if (tick.swipe != SwipeDirection_None) {
+		m_vrController->handleSwipe(tick.swipe);
+	}
+
+	// the compositor tells us when nobody is looking at the overlay, no need to submit frames then
+	tick.submitting = m_vrController->isOverlayVisible() && !m_vrController->isStandby();
+
+	if (tick.submitting) {
+		// sleep until just before the compositor's deadline so that we upload the freshest frame
+		m_vrController->waitForSubmitWindow();
+	}
+
+	m_graphicsManager->updateTexture();
+
+	if (tick.submitting && m_graphicsManager->wasUpdated()) {
+		m_vrController->submitFrame(m_graphicsManager->getVideoTexture(), m_graphicsManager->getFrameTimestamps());
+		tick.frameSubmitted = true;
+	}
+
+	return tick;
+}
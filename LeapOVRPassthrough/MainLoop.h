@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+
+#include "SwipeDetector.h"
+
+class Clock;
+class LeapHandler;
+class GraphicsManager;
+class OVROverlayController;
+
+// what one pass of the main loop did
+struct MainLoopTick {
+	int64_t time { 0 }; // clock time the pass started at
+	SwipeDirection swipe { SwipeDirection_None };
+	bool submitting { false }; // the overlay is shown, so the pass waited for the compositor
+	bool frameSubmitted { false };
+};
+
+// One pass of the main loop: the SteamVR connection and its events, swipes, the texture and frame submission.
+// The application and the replay both run it, so a replay goes through the logic that ships instead of a copy of it.
+// The constructor hands the clock to every singleton that reads the time, the overlay sink is set on the OVROverlayController
+// before its init() as usual. Waiting between passes while nothing is submitted is up to the caller: the application
+// waits for window events, the replay moves its VirtualClock forward.
+class MainLoop
+{
+public:
+	MainLoop(Clock* clock);
+
+	MainLoopTick tick();
+
+private:
+	Clock* m_clock;
+	LeapHandler* m_leapHandler;
+	GraphicsManager* m_graphicsManager;
+	OVROverlayController* m_vrController;
+};
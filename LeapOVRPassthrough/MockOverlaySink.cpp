@@ -0,0 +1,217 @@
+#include "MockOverlaySink.h"
+
+MockOverlaySink::MockOverlaySink(float displayFrequency, Clock* clock) :
+	m_displayFrequency(displayFrequency),
+	m_clock(clock),
+	m_startTime(clock->now())
+{ }
+
+void MockOverlaySink::setSubmitLatency(int64_t microseconds)
+{
+	m_submitLatency = microseconds;
+}
+
+void MockOverlaySink::setRuntimeRunning(bool running)
+{
+	if (!running && m_runtimeRunning && m_connected) {
+		queueEvent(vr::VREvent_Quit);
+	}
+
+	m_runtimeRunning = running;
+}
+
+const std::vector<MockOverlayCall>& MockOverlaySink::getCalls()
+{
+	return m_calls;
+}
+
+void MockOverlaySink::clearCalls()
+{
+	m_calls.clear();
+}
+
+bool MockOverlaySink::isRuntimeRunning()
+{
+	return m_runtimeRunning;
+}
+
+bool MockOverlaySink::connect(vr::HmdError& error)
+{
+	error = m_runtimeRunning ? vr::VRInitError_None : vr::VRInitError_Init_NoServerForBackgroundApp;
+	m_connected = m_runtimeRunning;
+	return m_connected;
+}
+
+void MockOverlaySink::disconnect()
+{
+	m_connected = false;
+	m_overlayCreated = false;
+	m_visible = false;
+	m_events.clear();
+}
+
+bool MockOverlaySink::createOverlay(const char*, const char*)
+{
+	m_overlayCreated = m_connected;
+	return m_overlayCreated;
+}
+
+bool MockOverlaySink::pollEvent(vr::VREvent_t& evt)
+{
+	if (m_events.empty()) return false;
+
+	evt = m_events.front();
+	m_events.pop_front();
+	return true;
+}
+
+vr::VROverlayError MockOverlaySink::showOverlay()
+{
+	if (!m_overlayCreated) return vr::VROverlayError_InvalidHandle;
+
+	if (!m_visible) {
+		m_visible = true;
+		queueEvent(vr::VREvent_OverlayShown);
+	}
+
+	return record({ MockOverlayCall_Show });
+}
+
+vr::VROverlayError MockOverlaySink::hideOverlay()
+{
+	if (!m_overlayCreated) return vr::VROverlayError_InvalidHandle;
+
+	if (m_visible) {
+		m_visible = false;
+		queueEvent(vr::VREvent_OverlayHidden);
+	}
+
+	return record({ MockOverlayCall_Hide });
+}
+
+bool MockOverlaySink::isOverlayVisible()
+{
+	return m_visible;
+}
+
+vr::VROverlayError MockOverlaySink::setTexture(GLuint id)
+{
+	if (m_submitLatency > 0) {
+		m_clock->sleepFor(m_submitLatency);
+	}
+
+	MockOverlayCall call { MockOverlayCall_SetTexture };
+	call.texture = id;
+	return record(call);
+}
+
+vr::VROverlayError MockOverlaySink::setAlpha(float alpha)
+{
+	MockOverlayCall call { MockOverlayCall_SetAlpha };
+	call.value = alpha;
+	return record(call);
+}
+
+vr::VROverlayError MockOverlaySink::setWidth(float width)
+{
+	MockOverlayCall call { MockOverlayCall_SetWidth };
+	call.value = width;
+	return record(call);
+}
+
+vr::VROverlayError MockOverlaySink::setTransform(const vr::HmdMatrix34_t& transform)
+{
+	MockOverlayCall call { MockOverlayCall_SetTransform };
+	call.transform = transform;
+	return record(call);
+}
+
+vr::VROverlayError MockOverlaySink::setStereo(bool stereo)
+{
+	MockOverlayCall call { MockOverlayCall_SetStereo };
+	call.value = stereo ? 1.0f : 0.0f;
+	return record(call);
+}
+
+float MockOverlaySink::getDisplayFrequency()
+{
+	return m_displayFrequency;
+}
+
+float MockOverlaySink::getSecondsFromVsyncToPhotons()
+{
+	return 0.0f;
+}
+
+bool MockOverlaySink::getTimeSinceLastVsync(float& seconds, uint64_t& frameCounter)
+{
+	if (!m_connected) return false;
+
+	double elapsed = (m_clock->now() - m_startTime) / 1e6;
+	double frames = elapsed * m_displayFrequency;
+
+	frameCounter = static_cast<uint64_t>(frames);
+	seconds = static_cast<float>((frames - frameCounter) / m_displayFrequency);
+	return true;
+}
+
+float MockOverlaySink::getFrameTimeRemaining()
+{
+	float sinceVsync;
+	uint64_t frameCounter;
+
+	if (!getTimeSinceLastVsync(sinceVsync, frameCounter)) return 0.0f;
+
+	// the deadline is the next vsync, there is no scene application taking its share of the frame
+	return 1.0f / m_displayFrequency - sinceVsync;
+}
+
+bool MockOverlaySink::getHmdPose(float, vr::TrackedDevicePose_t& pose)
+{
+	pose = {};
+	pose.mDeviceToAbsoluteTracking = {
+		1.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, 1.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f
+	};
+	pose.bPoseIsValid = m_connected;
+	return pose.bPoseIsValid;
+}
+
+bool MockOverlaySink::isManifestInstalled(const char*)
+{
+	return m_connected && m_manifestInstalled;
+}
+
+bool MockOverlaySink::installManifest(const char*)
+{
+	m_manifestInstalled = m_connected;
+	return m_manifestInstalled;
+}
+
+bool MockOverlaySink::removeManifest(const char*)
+{
+	if (!m_connected) return false;
+
+	m_manifestInstalled = false;
+	return true;
+}
+
+vr::VROverlayError MockOverlaySink::record(MockOverlayCall call)
+{
+	if (!m_overlayCreated) return vr::VROverlayError_InvalidHandle;
+
+	float sinceVsync = 0.0f;
+	getTimeSinceLastVsync(sinceVsync, call.frameCounter);
+
+	call.time = m_clock->now();
+	m_calls.push_back(call);
+	return vr::VROverlayError_None;
+}
+
+void MockOverlaySink::queueEvent(uint32_t eventType)
+{
+	vr::VREvent_t evt = {};
+	evt.eventType = eventType;
+	m_events.push_back(evt);
+}
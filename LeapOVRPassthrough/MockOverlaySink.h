@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "OverlaySink.h"
+#include "Clock.h"
+
+enum MockOverlayCallType {
+	MockOverlayCall_Show = 0,
+	MockOverlayCall_Hide,
+	MockOverlayCall_SetTexture,
+	MockOverlayCall_SetAlpha,
+	MockOverlayCall_SetWidth,
+	MockOverlayCall_SetTransform,
+	MockOverlayCall_SetStereo,
+};
+
+struct MockOverlayCall {
+	MockOverlayCallType type;
+	int64_t time { 0 }; // clock time when the call returned
+	uint64_t frameCounter { 0 }; // compositor frame the call returned in
+	GLuint texture { 0 }; // only for SetTexture
+	float value { 0.0f }; // alpha, width, or 1 when stereo was turned on
+	vr::HmdMatrix34_t transform {}; // only for SetTransform
+};
+
+// In-process stand-in for the compositor. Vsync ticks at the display frequency of the given clock from the moment it is created, the pose
+// never changes, and every call that changes the overlay is recorded with its arguments. Showing and hiding the overlay and
+// the runtime quitting queue the same events SteamVR would send. Not thread safe, just like the main loop using it.
+class MockOverlaySink : public OverlaySink
+{
+public:
+	MockOverlaySink(float displayFrequency, Clock* clock);
+
+	void setSubmitLatency(int64_t microseconds); // setTexture blocks this long, like a busy compositor
+	void setRuntimeRunning(bool running); // stopping it sends a connected client VREvent_Quit, connecting fails until it runs again
+	const std::vector<MockOverlayCall>& getCalls();
+	void clearCalls();
+
+	bool isRuntimeRunning() override;
+	bool connect(vr::HmdError& error) override;
+	void disconnect() override;
+	bool createOverlay(const char* key, const char* name) override;
+	bool pollEvent(vr::VREvent_t& evt) override;
+
+	vr::VROverlayError showOverlay() override;
+	vr::VROverlayError hideOverlay() override;
+	bool isOverlayVisible() override;
+	vr::VROverlayError setTexture(GLuint id) override;
+	vr::VROverlayError setAlpha(float alpha) override;
+	vr::VROverlayError setWidth(float width) override;
+	vr::VROverlayError setTransform(const vr::HmdMatrix34_t& transform) override;
+	vr::VROverlayError setStereo(bool stereo) override;
+
+	float getDisplayFrequency() override;
+	float getSecondsFromVsyncToPhotons() override;
+	bool getTimeSinceLastVsync(float& seconds, uint64_t& frameCounter) override;
+	float getFrameTimeRemaining() override;
+	bool getHmdPose(float secondsFromNow, vr::TrackedDevicePose_t& pose) override;
+
+	bool isManifestInstalled(const char* key) override;
+	bool installManifest(const char* path) override;
+	bool removeManifest(const char* key) override;
+
+private:
+	vr::VROverlayError record(MockOverlayCall call);
+	void queueEvent(uint32_t eventType);
+
+	float m_displayFrequency;
+	Clock* m_clock;
+	int64_t m_startTime;
+	int64_t m_submitLatency { 0 };
+	bool m_runtimeRunning { true };
+	bool m_connected { false };
+	bool m_manifestInstalled { false };
+	bool m_overlayCreated { false };
+	bool m_visible { false };
+	std::deque<vr::VREvent_t> m_events;
+	std::vector<MockOverlayCall> m_calls;
+};
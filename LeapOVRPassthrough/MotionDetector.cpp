@@ -0,0 +1,243 @@
+#include "MotionDetector.h"
+#include "Log.h"
+#include "Trace.h"
+#include "utils.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define MOTION_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+const int k_searchSize = 2 * k_motionSearchRadius + 1;
+const int k_levelScale = 1 << k_motionPyramidLevel;
+
+uint32_t blockSAD(const uint8_t* a, const uint8_t* b, int stride) {
+#ifdef MOTION_USE_SSE2
+	__m128i sum = _mm_setzero_si128();
+
+	// two 8 pixel rows per register
+	for (int y = 0; y < k_motionBlockSize; y += 2) {
+		__m128i va = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)(a + y * stride)), _mm_loadl_epi64((const __m128i*)(a + (y + 1) * stride)));
+		__m128i vb = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)(b + y * stride)), _mm_loadl_epi64((const __m128i*)(b + (y + 1) * stride)));
+		sum = _mm_add_epi64(sum, _mm_sad_epu8(va, vb));
+	}
+
+	return _mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+#else
+	uint32_t sum = 0;
+
+	for (int y = 0; y < k_motionBlockSize; y++) {
+		for (int x = 0; x < k_motionBlockSize; x++) {
+			sum += std::abs(a[y * stride + x] - b[y * stride + x]);
+		}
+	}
+
+	return sum;
+#endif
+}
+
+MotionDetector::MotionDetector() :
+	m_computeHistogram("Motion estimation (ms)", 0.0, 5.0, 50)
+{ }
+
+SwipeDirection MotionDetector::processFrame(const std::shared_ptr<const ImagePyramid>& pyramid, int64_t timestamp)
+{
+	TRACE_SCOPE("MotionDetector::processFrame");
+
+	std::shared_ptr<const ImagePyramid> previous = m_previous;
+	int64_t previousTimestamp = m_previousTimestamp;
+	m_previous = pyramid;
+	m_previousTimestamp = timestamp;
+
+	if (!previous) {
+		return SwipeDirection_None;
+	}
+
+	int64_t start = getHostTimeMicroseconds();
+
+	PyramidLevel current = pyramid->getLevel(0, k_motionPyramidLevel);
+	m_lastEstimate = estimateMotion(previous->getLevel(0, k_motionPyramidLevel), current);
+
+	m_computeHistogram.record((getHostTimeMicroseconds() - start) / 1000.0);
+
+	if (m_lastEstimate.coverage < m_thresholds.minCoverage || m_lastEstimate.coherence < m_thresholds.minCoherence) {
+		// single noisy frames in the middle of a sweep are skipped, only a real pause resets the state
+		if (timestamp - m_lastMovingTimestamp > k_motionMaxGap) {
+			m_accumulatedX = 0.0f;
+			m_accumulatedY = 0.0f;
+			m_movingSince = -1;
+			m_waitForRest = false;
+		}
+
+		return SwipeDirection_None;
+	}
+
+	m_lastMovingTimestamp = timestamp;
+
+	if (m_waitForRest) {
+		return SwipeDirection_None;
+	}
+
+	if (m_movingSince < 0) {
+		m_movingSince = previousTimestamp;
+	}
+
+	// travel is a sum over frames and thereby independent of the frame rate, only the duration needs to be measured in time
+	m_accumulatedX += m_lastEstimate.dx;
+	m_accumulatedY += m_lastEstimate.dy;
+
+	float fullWidth = static_cast<float>(current.width * k_levelScale);
+	float fullHeight = static_cast<float>(current.height * k_levelScale);
+
+	// travel relative to the image size along each axis, the larger one decides the direction
+	float travelX = m_accumulatedX / fullWidth;
+	float travelY = m_accumulatedY / fullHeight;
+
+	if (timestamp - m_movingSince < k_motionMinDuration || (std::max)(std::abs(travelX), std::abs(travelY)) < m_thresholds.minTravel) {
+		return SwipeDirection_None;
+	}
+
+	m_accumulatedX = 0.0f;
+	m_accumulatedY = 0.0f;
+	m_movingSince = -1;
+	m_waitForRest = true;
+
+	// a hand moving down the image came in from the top
+	if (std::abs(travelY) >= std::abs(travelX)) {
+		return (travelY > 0.0f) ? SwipeDirection_FromTop : SwipeDirection_FromBottom;
+	} else {
+		return (travelX > 0.0f) ? SwipeDirection_FromLeft : SwipeDirection_FromRight;
+	}
+}
+
+MotionEstimate MotionDetector::getLastEstimate()
+{
+	return m_lastEstimate;
+}
+
+void MotionDetector::reset()
+{
+	m_previous.reset();
+	m_accumulatedX = 0.0f;
+	m_accumulatedY = 0.0f;
+	m_movingSince = -1;
+	m_waitForRest = false;
+}
+
+void MotionDetector::setThresholds(const MotionThresholds& thresholds)
+{
+	m_thresholds = thresholds;
+}
+
+void MotionDetector::logStatistics()
+{
+	m_computeHistogram.log();
+}
+
+MotionEstimate MotionDetector::estimateMotion(const PyramidLevel& previous, const PyramidLevel& current)
+{
+	// a block only moved if its best match is clearly better than staying in place, and it changed noticeably at all
+	const uint32_t improvementRatio = 130; // percent
+	const uint32_t minChange = k_motionBlockSize * k_motionBlockSize * 8;
+
+	MotionEstimate result;
+
+	if (previous.width != current.width || previous.height != current.height) {
+		return result;
+	}
+
+	int width = current.width;
+	int blocksX = (current.width - 2 * k_motionSearchRadius) / k_motionBlockSize;
+	int blocksY = (current.height - 2 * k_motionSearchRadius) / k_motionBlockSize;
+
+	if (blocksX <= 0 || blocksY <= 0) {
+		return result;
+	}
+
+	// votes per displacement of every moving block
+	uint32_t votes[k_searchSize][k_searchSize] = { 0 };
+	uint32_t changedBlocks = 0;
+
+	for (int by = 0; by < blocksY; by++) {
+		for (int bx = 0; bx < blocksX; bx++) {
+			int x = k_motionSearchRadius + bx * k_motionBlockSize;
+			int y = k_motionSearchRadius + by * k_motionBlockSize;
+			const uint8_t* block = current.data + y * width + x;
+
+			uint32_t zeroCost = blockSAD(block, previous.data + y * width + x, width);
+
+			if (zeroCost < minChange) continue;
+
+			changedBlocks++;
+
+			uint32_t bestCost = zeroCost;
+			int bestX = 0;
+			int bestY = 0;
+
+			// where in the previous frame did this block come from
+			for (int dy = -k_motionSearchRadius; dy <= k_motionSearchRadius; dy++) {
+				for (int dx = -k_motionSearchRadius; dx <= k_motionSearchRadius; dx++) {
+					uint32_t cost = blockSAD(block, previous.data + (y - dy) * width + (x - dx), width);
+
+					if (cost < bestCost) {
+						bestCost = cost;
+						bestX = dx;
+						bestY = dy;
+					}
+				}
+			}
+
+			if ((bestX != 0 || bestY != 0) && bestCost * improvementRatio < zeroCost * 100) {
+				votes[bestY + k_motionSearchRadius][bestX + k_motionSearchRadius]++;
+			}
+		}
+	}
+
+	// the dominant motion is the 3x3 neighbourhood of displacements with the most votes
+	uint32_t bestVotes = 0;
+	int centerX = 0;
+	int centerY = 0;
+
+	for (int cy = 0; cy < k_searchSize; cy++) {
+		for (int cx = 0; cx < k_searchSize; cx++) {
+			uint32_t sum = 0;
+
+			for (int ny = (std::max)(cy - 1, 0); ny <= (std::min)(cy + 1, k_searchSize - 1); ny++) {
+				for (int nx = (std::max)(cx - 1, 0); nx <= (std::min)(cx + 1, k_searchSize - 1); nx++) {
+					sum += votes[ny][nx];
+				}
+			}
+
+			if (sum > bestVotes) {
+				bestVotes = sum;
+				centerX = cx;
+				centerY = cy;
+			}
+		}
+	}
+
+	if (bestVotes == 0) {
+		return result;
+	}
+
+	float sumX = 0.0f;
+	float sumY = 0.0f;
+
+	for (int ny = (std::max)(centerY - 1, 0); ny <= (std::min)(centerY + 1, k_searchSize - 1); ny++) {
+		for (int nx = (std::max)(centerX - 1, 0); nx <= (std::min)(centerX + 1, k_searchSize - 1); nx++) {
+			sumX += votes[ny][nx] * static_cast<float>(nx - k_motionSearchRadius);
+			sumY += votes[ny][nx] * static_cast<float>(ny - k_motionSearchRadius);
+		}
+	}
+
+	result.dx = sumX / bestVotes * k_levelScale;
+	result.dy = sumY / bestVotes * k_levelScale;
+	result.coverage = static_cast<float>(bestVotes) / (blocksX * blocksY);
+	result.coherence = static_cast<float>(bestVotes) / changedBlocks;
+
+	return result;
+}
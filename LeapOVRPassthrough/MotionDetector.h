@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+
+#include "ImagePyramid.h"
+#include "SwipeDetector.h"
+#include "Histogram.h"
+
+const int k_motionPyramidLevel = 2; // block matching runs on the 1/4 scale images
+const int k_motionBlockSize = 8;
+const int k_motionSearchRadius = 4; // in pixels of the 1/4 scale image, i.e. 16 full resolution pixels per frame
+const int64_t k_motionMinDuration = 30000; // microseconds of continuous motion for a swipe, about 3 frames at 90 Hz
+const int64_t k_motionMaxGap = 50000; // motion that pauses for longer than this starts over
+
+// most of what changed has to move the same way, and the hand has to travel a third of the image overall.
+// a hand is mostly uniformly bright, so only its outline produces moving blocks and the coverage stays low
+struct MotionThresholds {
+	float minCoverage { 0.05f }; // fraction of all blocks
+	// fraction of the changed blocks. 0.35 rather than 0.5 since the outline of a hand at 60 Hz moves further than the search
+	// radius and splits into several motions: on 24 generated sessions (--evaluate) recall goes from 0.36 to 0.57, precision
+	// from 0.75 to 0.63
+	float minCoherence { 0.35f };
+	float minTravel { 0.33f }; // fraction of the image size
+};
+
+struct MotionEstimate {
+	float dx { 0.0f }; // dominant motion in full resolution pixels per frame
+	float dy { 0.0f };
+	float coverage { 0.0f }; // fraction of all blocks that moved along with the dominant motion
+	float coherence { 0.0f }; // fraction of the changed blocks that did so
+};
+
+// Coarse block matching optical flow between consecutive frames of the left camera.
+// A swipe is a hand moving coherently across a good part of the view, which brightness changes (e.g. lights coming on) never do.
+class MotionDetector
+{
+public:
+	MotionDetector();
+
+	SwipeDirection processFrame(const std::shared_ptr<const ImagePyramid>& pyramid, int64_t timestamp);
+	MotionEstimate getLastEstimate();
+	void reset();
+	void setThresholds(const MotionThresholds& thresholds);
+
+	void logStatistics();
+
+private:
+	MotionEstimate estimateMotion(const PyramidLevel& previous, const PyramidLevel& current);
+
+	std::shared_ptr<const ImagePyramid> m_previous; // pyramids are immutable, so holding on to the last one is all the history we need
+	int64_t m_previousTimestamp { 0 };
+	MotionEstimate m_lastEstimate;
+	MotionThresholds m_thresholds;
+
+	float m_accumulatedX { 0.0f };
+	float m_accumulatedY { 0.0f };
+	int64_t m_movingSince { -1 }; // timestamp of the frame the current motion started from, -1 while nothing moves
+	int64_t m_lastMovingTimestamp { 0 };
+	bool m_waitForRest { false }; // one sweep only counts once, even if the hand keeps going
+
+	Histogram m_computeHistogram;
+};
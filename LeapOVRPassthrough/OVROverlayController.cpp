@@ -1,305 +1,652 @@
-#include "OVROverlayController.h"
-
-#define APPLICATION_KEY "de.literalchaos.leap_motion_ovr_overlay"
-
-OVROverlayController* s_shareInstance = nullptr;
-
-OVROverlayController * OVROverlayController::getInstance()
-{
-	if (s_shareInstance == nullptr) {
-		s_shareInstance = new OVROverlayController();
-	}
-
-	return s_shareInstance;
-}
-
-OVROverlayController::OVROverlayController()
-	: m_eLastHmdError( vr::VRInitError_None ),
-	  m_eCompositorError ( vr::VRInitError_None ),
-	  m_eOverlayError( vr::VRInitError_None ),
-	  m_ulOverlayHandle( vr::k_ulOverlayHandleInvalid ),
-	  m_rTrackedDevicePose()
-{
-}
-
-
-OVROverlayController::~OVROverlayController()
-{
-}
-
-bool OVROverlayController::init()
-{
-	std::stringstream output;
-	bool success = true;
-
-	success = connectToVRRuntime();
-
-	success &= vr::VRCompositor() != NULL;
-
-	if (vr::VROverlay()) {
-		std::string name = "Leap Motion Overlay";
-		std::string key = "de.literalchaos.leap_motion_ovr_overlay";
-		vr::VROverlayError overlayError = vr::VROverlay()->CreateOverlay(key.c_str(), name.c_str(), &m_ulOverlayHandle);
-
-		success &= overlayError == vr::VROverlayError_None;
-	}
-
-	if (success) {
-		updateOverlaySizeAndPosition();
-
-		output << "Successfully created overlay" << std::endl;
-		outputStringStream(output);
-	} else {
-		output << "Error creating overlay" << std::endl;
-		outputStringStream(output);
-	}
-
-	return true;
-}
-
-void OVROverlayController::shutdown()
-{
-	disconnectFromVRRuntime();
-}
-
-void OVROverlayController::pollEvents()
-{
-	if (m_VRSystem == nullptr) return;
-
-	uint8_t eventBuffer[1024];
-	vr::VREvent_t* evt = (vr::VREvent_t*)eventBuffer;
-
-	if (m_VRSystem->PollNextEvent(evt, 1024)) {
-		if (evt->eventType == vr::VREvent_Quit || evt->eventType == vr::VREvent_ProcessQuit) {
-			disconnectFromVRRuntime();
-		}
-	}
-}
-
-bool OVROverlayController::isConnected()
-{
-	return m_connected;
-}
-
-void OVROverlayController::showOverlay()
-{
-	vr::VROverlayError err = vr::VROverlay()->ShowOverlay(m_ulOverlayHandle);
-
-	if (err != vr::VROverlayError_None) {
-		std::stringstream output;
-		output << "showOverlay error: " << err << std::endl;
-		outputStringStream(output);
-	}
-}
-
-void OVROverlayController::hideOverlay()
-{
-	vr::VROverlayError err = vr::VROverlay()->HideOverlay(m_ulOverlayHandle);
-
-	if (err != vr::VROverlayError_None) {
-		std::stringstream output;
-		output << "hideOverlay error: " << err << std::endl;
-		outputStringStream(output);
-	}
-}
-
-void OVROverlayController::toggleOverlay()
-{
-	if (vr::VROverlay()->IsOverlayVisible(m_ulOverlayHandle)) {
-		vr::VROverlay()->HideOverlay(m_ulOverlayHandle);
-	} else {
-		vr::VROverlay()->ShowOverlay(m_ulOverlayHandle);
-	}
-}
-
-void OVROverlayController::setTexture(GLuint id)
-{
-	vr::Texture_t texture;
-	texture.handle = (void*)(uintptr_t)id;
-	texture.eType = vr::TextureType_OpenGL;
-	texture.eColorSpace = vr::ColorSpace_Auto;
-
-	vr::VROverlayError err = vr::VROverlay()->SetOverlayTexture(m_ulOverlayHandle, &texture);
-
-	if (err != vr::VROverlayError_None) {
-		std::stringstream output;
-		output << "setTexture error: " << err << std::endl;
-		outputStringStream(output);
-	}
-}
-
-void OVROverlayController::setOverlayRotation(int rotation)
-{
-	m_overlayRotation = rotation;
-	updateOverlaySizeAndPosition();
-}
-
-void OVROverlayController::setOverlayAlpha(float alpha)
-{
-	vr::VROverlayError err = vr::VROverlay()->SetOverlayAlpha(m_ulOverlayHandle, alpha);
-
-	if (err != vr::VROverlayError_None) {
-		std::stringstream output;
-		output << "SetOverlayAlpha error: " << err << std::endl;
-		outputStringStream(output);
-	}
-}
-
-void OVROverlayController::setOverlayWidth(float width)
-{
-	m_overlayWidth = width;
-	updateOverlaySizeAndPosition();
-}
-
-float OVROverlayController::getOverlayWidth()
-{
-	return m_overlayWidth;
-}
-
-void OVROverlayController::setOverlayDistance(float zDistance)
-{
-	m_overlayZDistance = zDistance;
-	updateOverlaySizeAndPosition();
-}
-
-float OVROverlayController::getOverlayDistance()
-{
-	return m_overlayZDistance;
-}
-
-void OVROverlayController::installManifest()
-{
-	std::stringstream output;
-
-	if (!isManifestInstalled()) {
-		output << "Installing manifest" << std::endl;
-		outputStringStream(output);
-
-		std::filesystem::path manifest_path = std::filesystem::current_path() / "manifest.vrmanifest";
-
-		vr::EVRApplicationError err = vr::VRApplications()->AddApplicationManifest(manifest_path.string().c_str());
-		if (err != vr::VRApplicationError_None) {
-			output << "Error while adding manifest: " << vr::VRApplications()->GetApplicationsErrorNameFromEnum(err) << std::endl;
-			outputStringStream(output);
-			MessageBox(NULL, L"Manifest installation failed!", L"Leap Motion Overlay", MB_OK | MB_ICONERROR);
-		} else {
-			MessageBox(NULL, L"Application successfully registered!", L"Leap Motion Overlay", MB_OK | MB_ICONINFORMATION);
-		}
-	}
-}
-
-void OVROverlayController::removeManifest()
-{
-	std::stringstream output;
-
-	if (isManifestInstalled()) {
-		output << "Removing manifest" << std::endl;
-		outputStringStream(output);
-
-		//vr::EVRApplicationProperpty
-
-		char manifestPathBase[512] = { 0 };
-		uint32_t reqSize = vr::VRApplications()->GetApplicationPropertyString(APPLICATION_KEY, vr::VRApplicationProperty_WorkingDirectory_String, manifestPathBase, 512, nullptr);
-
-		std::string manifestPathBaseStr(manifestPathBase);
-		std::filesystem::path manifest_path = std::filesystem::path(manifestPathBaseStr) / "manifest.vrmanifest";
-
-		vr::EVRApplicationError err = vr::VRApplications()->RemoveApplicationManifest(manifest_path.string().c_str());
-		if (err != vr::VRApplicationError_None) {
-			output << "Error while removing manifest: " << vr::VRApplications()->GetApplicationsErrorNameFromEnum(err) << std::endl;
-			outputStringStream(output);
-			MessageBox(NULL, L"Manifest removal failed!", L"Leap Motion Overlay", MB_OK | MB_ICONERROR);
-		} else {
-			MessageBox(NULL, L"Application successfully unregistered!", L"Leap Motion Overlay", MB_OK | MB_ICONINFORMATION);
-		}
-	}
-}
-
-bool OVROverlayController::isManifestInstalled()
-{
-	return vr::VRApplications()->IsApplicationInstalled(APPLICATION_KEY);
-}
-
-bool OVROverlayController::BHMDAvailable()
-{
-	return vr::VRSystem() != NULL;
-}
-
-vr::HmdError OVROverlayController::getLastHmdError()
-{
-	return m_eLastHmdError;
-}
-
-bool OVROverlayController::connectToVRRuntime()
-{
-	m_eLastHmdError = vr::VRInitError_None;
-	m_VRSystem = vr::VR_Init(&m_eLastHmdError, vr::VRApplication_Overlay);
-
-	if (m_eLastHmdError != vr::VRInitError_None) {
-		m_strVRDriver = "No Driver";
-		m_strVRDisplay = "No Display";
-		return false;
-	}
-
-	//m_strVRDriver = GetTrackedDeviceString(pVRSystem, vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_TrackingSystemName_String);
-	//m_strVRDisplay = GetTrackedDeviceString(pVRSystem, vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_SerialNumber_String);
-
-	m_connected = true;
-
-	return true;
-}
-
-void OVROverlayController::disconnectFromVRRuntime()
-{
-	vr::VR_Shutdown();
-	m_connected = false;
-}
-
-void OVROverlayController::updateOverlaySizeAndPosition()
-{
-	std::stringstream output;
-
-	vr::VROverlayError err = vr::VROverlay()->SetOverlayWidthInMeters(m_ulOverlayHandle, m_overlayWidth);
-	if (err != vr::VROverlayError_None) {
-		output << "SetOverlayWidthInMeters error: " << err << std::endl;
-		outputStringStream(output);
-	}
-
-	vr::HmdMatrix34_t position = createOverlayMatrix(m_overlayZDistance);
-	err = vr::VROverlay()->SetOverlayTransformTrackedDeviceRelative(m_ulOverlayHandle, 0, &position);
-
-	if (err != vr::VROverlayError_None) {
-		output << "SetOverlayTransformAbsolute error: " << err << std::endl;
-		outputStringStream(output);
-	}
-}
-
-vr::HmdMatrix34_t OVROverlayController::createOverlayMatrix(float zDistance)
-{
-	switch (m_overlayRotation) {
-	case 1:
-		return {
-			0.0f, -1.0f, 0.0f, 0.0f,
-			1.0f, 0.0f, 0.0f, 0.0f,
-			0.0f, 0.0f, 1.0f, -zDistance
-		};
-	case 2:
-		return {
-			-1.0f, 0.0f, 0.0f, 0.0f,
-			0.0f, -1.0f, 0.0f, 0.0f,
-			0.0f, 0.0f, 1.0f, -zDistance
-		};
-	case 3:
-		return {
-			0.0f, 1.0f, 0.0f, 0.0f,
-			-1.0f, 0.0f, 0.0f, 0.0f,
-			0.0f, 0.0f, 1.0f, -zDistance
-		};
-	default:
-		return {
-			1.0f, 0.0f, 0.0f, 0.0f,
-			0.0f, 1.0f, 0.0f, 0.0f,
-			0.0f, 0.0f, 1.0f, -zDistance
-		};
-	}
-}
+#include "OVROverlayController.h"
+
+#define APPLICATION_KEY "de.literalchaos.leap_motion_ovr_overlay"
+
+// upper bounds for a single pollEvents() call, anything left over stays queued for the next tick
+const uint32_t k_maxEventsPerTick = 64;
+const std::chrono::microseconds k_maxPumpDuration(2000);
+
+// backoff between attempts to reconnect while SteamVR is not running, each one is a VR_Init on the main loop
+const int64_t k_vrRetryDelay = 2000000;
+const int64_t k_vrMaxRetryDelay = 8000000;
+
+// how long before the compositor's deadline we want to start uploading and submitting a frame
+const float k_submitLeadTime = 0.004f;
+
+// don't try to compensate for frames older than this, the pose history doesn't reach back that far
+const float k_maxReprojectionAge = 0.1f;
+
+const vr::HmdMatrix34_t k_identityMatrix = {
+	1.0f, 0.0f, 0.0f, 0.0f,
+	0.0f, 1.0f, 0.0f, 0.0f,
+	0.0f, 0.0f, 1.0f, 0.0f
+};
+
+// multiplies two rigid transforms, treating them as 4x4 matrices with an implicit last row of (0, 0, 0, 1)
+vr::HmdMatrix34_t multiplyMatrices(const vr::HmdMatrix34_t& a, const vr::HmdMatrix34_t& b) {
+	vr::HmdMatrix34_t result;
+
+	for (int row = 0; row < 3; row++) {
+		for (int col = 0; col < 4; col++) {
+			result.m[row][col] = a.m[row][0] * b.m[0][col] + a.m[row][1] * b.m[1][col] + a.m[row][2] * b.m[2][col];
+		}
+		result.m[row][3] += a.m[row][3];
+	}
+
+	return result;
+}
+
+// rotation delta that takes something fixed in head space at the time of capture into head space at display time
+vr::HmdMatrix34_t rotationDelta(const vr::HmdMatrix34_t& capture, const vr::HmdMatrix34_t& display) {
+	vr::HmdMatrix34_t result = k_identityMatrix;
+
+	for (int row = 0; row < 3; row++) {
+		for (int col = 0; col < 3; col++) {
+			// transpose(display) * capture
+			result.m[row][col] = display.m[0][row] * capture.m[0][col] + display.m[1][row] * capture.m[1][col] + display.m[2][row] * capture.m[2][col];
+		}
+	}
+
+	return result;
+}
+
+const std::map<uint32_t, OVROverlayController::EventHandler> OVROverlayController::s_eventHandlers = {
+	{ vr::VREvent_Quit, &OVROverlayController::onQuit },
+	{ vr::VREvent_ProcessQuit, &OVROverlayController::onQuit },
+	{ vr::VREvent_EnterStandbyMode, &OVROverlayController::onStandbyChanged },
+	{ vr::VREvent_LeaveStandbyMode, &OVROverlayController::onStandbyChanged },
+	{ vr::VREvent_OverlayShown, &OVROverlayController::onOverlayVisibilityChanged },
+	{ vr::VREvent_OverlayHidden, &OVROverlayController::onOverlayVisibilityChanged },
+	{ vr::VREvent_DashboardActivated, &OVROverlayController::onDashboardChanged },
+	{ vr::VREvent_DashboardDeactivated, &OVROverlayController::onDashboardChanged },
+	{ vr::VREvent_ChaperoneDataHasChanged, &OVROverlayController::onChaperoneChanged },
+	{ vr::VREvent_ChaperoneUniverseHasChanged, &OVROverlayController::onChaperoneChanged },
+	{ vr::VREvent_ChaperoneSettingsHaveChanged, &OVROverlayController::onChaperoneChanged },
+};
+
+OVROverlayController* s_shareInstance = nullptr;
+
+OVROverlayController * OVROverlayController::getInstance()
+{
+	if (s_shareInstance == nullptr) {
+		s_shareInstance = new OVROverlayController();
+	}
+
+	return s_shareInstance;
+}
+
+OVROverlayController::OVROverlayController()
+	: m_connectionMonitor( "SteamVR", k_vrRetryDelay, k_vrMaxRetryDelay ),
+	  m_reprojectionRotation( k_identityMatrix ),
+	  m_clock( SteadyClock::getInstance() ),
+	  m_submitMarginHistogram( "Submit margin to compositor deadline (ms)", -10.0, 20.0, 60 ),
+	  m_eLastHmdError( vr::VRInitError_None ),
+	  m_eCompositorError ( vr::VRInitError_None ),
+	  m_eOverlayError( vr::VRInitError_None )
+{
+}
+
+
+OVROverlayController::~OVROverlayController()
+{
+}
+
+void OVROverlayController::setSink(std::unique_ptr<OverlaySink> sink)
+{
+	m_sink = std::move(sink);
+}
+
+void OVROverlayController::setClock(Clock* clock)
+{
+	m_clock = clock;
+	m_connectionMonitor.setClock(clock);
+}
+
+bool OVROverlayController::init()
+{
+	// only the first attempt may start SteamVR, updateConnection() waits for it to be running
+	if (!openOverlay(true)) {
+		LOG_ERROR("Error creating overlay, trying again once SteamVR is running");
+	}
+
+	return true;
+}
+
+void OVROverlayController::shutdown()
+{
+	disconnectFromVRRuntime("shutdown");
+}
+
+void OVROverlayController::updateConnection()
+{
+	if (m_connected || !m_connectionMonitor.isAttemptDue()) return;
+
+	TRACE_SCOPE("OVROverlayController::updateConnection");
+
+	openOverlay(false);
+}
+
+void OVROverlayController::pollEvents()
+{
+	if (!m_connected) return;
+
+	TRACE_SCOPE("OVROverlayController::pollEvents");
+
+	auto start = std::chrono::steady_clock::now();
+	uint32_t count = 0;
+	vr::VREvent_t evt;
+
+	// drain both the system and the overlay queue, but never spend more than the budget on it
+	while (m_connected && count < k_maxEventsPerTick && std::chrono::steady_clock::now() - start < k_maxPumpDuration) {
+		if (!m_sink->pollEvent(evt)) {
+			break;
+		}
+
+		dispatchEvent(evt);
+
+		count++;
+	}
+
+	auto pumpDuration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+	m_eventPumpStats.lastEventsPerTick = count;
+	m_eventPumpStats.maxEventsPerTick = (std::max)(m_eventPumpStats.maxEventsPerTick, count);
+	m_eventPumpStats.totalEvents += count;
+	m_eventPumpStats.maxPumpDuration = (std::max)(m_eventPumpStats.maxPumpDuration, pumpDuration);
+}
+
+bool OVROverlayController::isConnected()
+{
+	return m_connected;
+}
+
+bool OVROverlayController::isStandby()
+{
+	return m_standby;
+}
+
+bool OVROverlayController::isOverlayVisible()
+{
+	return m_overlayVisible;
+}
+
+bool OVROverlayController::isDashboardActive()
+{
+	return m_dashboardActive;
+}
+
+EventPumpStats OVROverlayController::getEventPumpStats()
+{
+	return m_eventPumpStats;
+}
+
+void OVROverlayController::logStatistics()
+{
+	LOG_INFO("OpenVR events: {} total, {} last tick, {} max per tick, {}us max pump time",
+		m_eventPumpStats.totalEvents, m_eventPumpStats.lastEventsPerTick, m_eventPumpStats.maxEventsPerTick, m_eventPumpStats.maxPumpDuration.count());
+
+	m_submitMarginHistogram.log();
+	m_connectionMonitor.logStatistics();
+}
+
+void OVROverlayController::showOverlay()
+{
+	if (!m_connected) return;
+
+	vr::VROverlayError err = m_sink->showOverlay();
+
+	if (err != vr::VROverlayError_None) {
+		LOG_ERROR("showOverlay error: {}", err);
+	}
+}
+
+void OVROverlayController::hideOverlay()
+{
+	if (!m_connected) return;
+
+	vr::VROverlayError err = m_sink->hideOverlay();
+
+	if (err != vr::VROverlayError_None) {
+		LOG_ERROR("hideOverlay error: {}", err);
+	}
+}
+
+void OVROverlayController::toggleOverlay()
+{
+	if (!m_connected) return;
+
+	TRACE_SCOPE("OVROverlayController::toggleOverlay");
+
+	if (m_sink->isOverlayVisible()) {
+		m_sink->hideOverlay();
+	} else {
+		m_sink->showOverlay();
+	}
+}
+
+void OVROverlayController::handleSwipe(SwipeDirection swipe)
+{
+	// the detector works in camera image space, turn that into what the user sees on the (rotated) overlay
+	swipe = SwipeDetector::rotateDirection(swipe, -m_overlayRotation);
+
+	LOG_DEBUG("Swipe detected {}", SwipeDetector::directionToString(swipe));
+
+	if (swipe == SwipeDirection_FromTop) {
+		toggleOverlay();
+	} else if (m_overlayVisible) {
+		// the other gestures only adjust the overlay while it is shown
+		switch (swipe) {
+			case SwipeDirection_FromBottom:
+				setOverlayAlpha(m_overlayAlpha < 1.0f ? 1.0f : 0.5f);
+				break;
+			case SwipeDirection_FromLeft:
+				setOverlayRotation((m_overlayRotation + 1) % 4);
+				break;
+			case SwipeDirection_FromRight:
+				setOverlayRotation((m_overlayRotation + 3) % 4);
+				break;
+			default:
+				break;
+		}
+	}
+}
+
+void OVROverlayController::waitForSubmitWindow()
+{
+	if (!m_connected) return;
+
+	TRACE_SCOPE("OVROverlayController::waitForSubmitWindow");
+
+	float sinceVsync;
+	uint64_t frameCounter;
+
+	if (!m_sink->getTimeSinceLastVsync(sinceVsync, frameCounter)) {
+		// no timing information at all, fall back to roughly the display rate
+		m_pacedFrameCounter = 0;
+		sleepFor(1.0f / m_displayFrequency);
+		return;
+	}
+
+	float wait = getSecondsToDeadline() - k_submitLeadTime;
+
+	if (frameCounter == m_pacedFrameCounter) {
+		// this compositor frame has already been served, aim for the next one
+		wait += 1.0f / m_displayFrequency;
+	}
+
+	if (wait > 0.0f) {
+		sleepFor((std::min)(wait, 2.0f / m_displayFrequency));
+	}
+
+	if (!m_sink->getTimeSinceLastVsync(sinceVsync, m_pacedFrameCounter)) {
+		m_pacedFrameCounter = 0;
+	}
+}
+
+int64_t OVROverlayController::getPredictedPhotonTime()
+{
+	// the next frame lights up after the next vsync plus the display's own delay
+	float secondsToPhotons = getSecondsToDeadline() + m_secondsFromVsyncToPhotons;
+	return m_clock->now() + static_cast<int64_t>(secondsToPhotons * 1e6f);
+}
+
+FrameTimestamps OVROverlayController::submitFrame(GLuint id, FrameTimestamps timestamps)
+{
+	TRACE_SCOPE("Submit frame");
+
+	updateReprojection(timestamps.stages[FrameStage_Capture]);
+	setTexture(id);
+
+	timestamps.stamp(FrameStage_Submit, m_clock->now());
+	LatencyTracker::getInstance()->recordFrame(timestamps);
+
+	return timestamps;
+}
+
+void OVROverlayController::setTexture(GLuint id)
+{
+	TRACE_SCOPE("OVROverlayController::setTexture");
+
+	vr::VROverlayError err = m_sink->setTexture(id);
+
+	if (err != vr::VROverlayError_None) {
+		LOG_ERROR("setTexture error: {}", err);
+		return;
+	}
+
+	float sinceVsync;
+	uint64_t frameCounter;
+
+	if (m_pacedFrameCounter != 0 && m_sink->getTimeSinceLastVsync(sinceVsync, frameCounter) && frameCounter != m_pacedFrameCounter) {
+		// we missed the frame we were aiming for, count how late we were as a negative margin
+		m_submitMarginHistogram.record(-sinceVsync * 1000.0);
+	} else {
+		m_submitMarginHistogram.record(getSecondsToDeadline() * 1000.0);
+	}
+}
+
+void OVROverlayController::setOverlayRotation(int rotation)
+{
+	m_overlayRotation = rotation;
+	updateOverlaySizeAndPosition();
+}
+
+int OVROverlayController::getOverlayRotation()
+{
+	return m_overlayRotation;
+}
+
+void OVROverlayController::setOverlayAlpha(float alpha)
+{
+	m_overlayAlpha = alpha;
+
+	if (!m_connected) return;
+
+	vr::VROverlayError err = m_sink->setAlpha(alpha);
+
+	if (err != vr::VROverlayError_None) {
+		LOG_ERROR("SetOverlayAlpha error: {}", err);
+	}
+}
+
+float OVROverlayController::getOverlayAlpha()
+{
+	return m_overlayAlpha;
+}
+
+void OVROverlayController::setOverlayWidth(float width)
+{
+	m_overlayWidth = width;
+	updateOverlaySizeAndPosition();
+}
+
+float OVROverlayController::getOverlayWidth()
+{
+	return m_overlayWidth;
+}
+
+void OVROverlayController::setOverlayDistance(float zDistance)
+{
+	m_overlayZDistance = zDistance;
+	updateOverlaySizeAndPosition();
+}
+
+float OVROverlayController::getOverlayDistance()
+{
+	return m_overlayZDistance;
+}
+
+void OVROverlayController::setReprojectionEnabled(bool enabled)
+{
+	m_reprojectionEnabled = enabled;
+
+	if (!enabled) {
+		m_reprojectionRotation = k_identityMatrix;
+		updateOverlayTransform();
+	}
+}
+
+bool OVROverlayController::getReprojectionEnabled()
+{
+	return m_reprojectionEnabled;
+}
+
+void OVROverlayController::setStereo(bool stereo)
+{
+	m_stereo = stereo;
+
+	if (!m_connected) return;
+
+	vr::VROverlayError err = m_sink->setStereo(stereo);
+	if (err != vr::VROverlayError_None) {
+		LOG_ERROR("SetOverlayFlag error: {}", err);
+	}
+}
+
+bool OVROverlayController::getStereo()
+{
+	return m_stereo;
+}
+
+void OVROverlayController::updateReprojection(int64_t captureTime)
+{
+	if (!m_reprojectionEnabled || !m_connected || captureTime == 0) return;
+
+	TRACE_SCOPE("OVROverlayController::updateReprojection");
+
+	float secondsSinceCapture = (m_clock->now() - captureTime) / 1e6f;
+	float secondsToPhotons = getSecondsToDeadline() + m_secondsFromVsyncToPhotons;
+
+	if (secondsSinceCapture < 0.0f || secondsSinceCapture > k_maxReprojectionAge) {
+		return;
+	}
+
+	vr::TrackedDevicePose_t capturePose;
+	vr::TrackedDevicePose_t displayPose;
+
+	if (!m_sink->getHmdPose(-secondsSinceCapture, capturePose) || !m_sink->getHmdPose(secondsToPhotons, displayPose)) {
+		m_reprojectionRotation = k_identityMatrix;
+	} else {
+		m_reprojectionRotation = rotationDelta(capturePose.mDeviceToAbsoluteTracking, displayPose.mDeviceToAbsoluteTracking);
+	}
+
+	updateOverlayTransform();
+}
+
+bool OVROverlayController::installManifest()
+{
+	if (!m_connected || isManifestInstalled()) return false;
+
+	LOG_INFO("Installing manifest");
+
+	std::filesystem::path manifest_path = std::filesystem::current_path() / "manifest.vrmanifest";
+	return m_sink->installManifest(manifest_path.string().c_str());
+}
+
+bool OVROverlayController::removeManifest()
+{
+	if (!m_connected || !isManifestInstalled()) return false;
+
+	LOG_INFO("Removing manifest");
+
+	return m_sink->removeManifest(APPLICATION_KEY);
+}
+
+bool OVROverlayController::isManifestInstalled()
+{
+	return m_connected && m_sink->isManifestInstalled(APPLICATION_KEY);
+}
+
+vr::HmdError OVROverlayController::getLastHmdError()
+{
+	return m_eLastHmdError;
+}
+
+bool OVROverlayController::openOverlay(bool startRuntime)
+{
+	if ((!startRuntime && !m_sink->isRuntimeRunning()) || !connectToVRRuntime()) {
+		m_connectionMonitor.backOff();
+		return false;
+	}
+
+	if (!m_sink->createOverlay(APPLICATION_KEY, "Leap Motion Overlay")) {
+		disconnectFromVRRuntime("the overlay could not be created");
+		return false;
+	}
+
+	// the settings outlive the connection, a new overlay gets the ones the old one had
+	updateOverlaySizeAndPosition();
+	setStereo(m_stereo);
+	setOverlayAlpha(m_overlayAlpha);
+
+	float displayFrequency = m_sink->getDisplayFrequency();
+	if (displayFrequency > 0.0f) {
+		m_displayFrequency = displayFrequency;
+	}
+
+	m_secondsFromVsyncToPhotons = m_sink->getSecondsFromVsyncToPhotons();
+
+	if (m_showAfterReconnect) {
+		showOverlay();
+	}
+
+	m_connectionMonitor.setState(ConnectionState_Connected, "overlay created");
+	LOG_INFO("Successfully created overlay");
+
+	return true;
+}
+
+bool OVROverlayController::connectToVRRuntime()
+{
+	m_eLastHmdError = vr::VRInitError_None;
+
+	if (!m_sink->connect(m_eLastHmdError)) {
+		m_strVRDriver = "No Driver";
+		m_strVRDisplay = "No Display";
+		return false;
+	}
+
+	//m_strVRDriver = GetTrackedDeviceString(pVRSystem, vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_TrackingSystemName_String);
+	//m_strVRDisplay = GetTrackedDeviceString(pVRSystem, vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_SerialNumber_String);
+
+	m_connected = true;
+
+	return true;
+}
+
+void OVROverlayController::disconnectFromVRRuntime(const char* reason)
+{
+	if (m_connectionMonitor.getState() == ConnectionState_Connected) {
+		m_showAfterReconnect = m_overlayVisible;
+	}
+
+	m_sink->disconnect();
+	m_connected = false;
+
+	// none of the events that would reset these come while disconnected
+	m_standby = false;
+	m_overlayVisible = false;
+	m_dashboardActive = false;
+	m_pacedFrameCounter = 0;
+	m_reprojectionRotation = k_identityMatrix;
+
+	// SteamVR may still accept clients while it shuts down, so the next attempt waits
+	m_connectionMonitor.setState(ConnectionState_Disconnected, reason);
+	m_connectionMonitor.backOff();
+}
+
+void OVROverlayController::dispatchEvent(const vr::VREvent_t& evt)
+{
+	auto handler = s_eventHandlers.find(evt.eventType);
+
+	if (handler != s_eventHandlers.end()) {
+		(this->*(handler->second))(evt);
+	}
+}
+
+void OVROverlayController::onQuit(const vr::VREvent_t&)
+{
+	disconnectFromVRRuntime("SteamVR quit");
+}
+
+void OVROverlayController::onStandbyChanged(const vr::VREvent_t& evt)
+{
+	m_standby = evt.eventType == vr::VREvent_EnterStandbyMode;
+}
+
+void OVROverlayController::onOverlayVisibilityChanged(const vr::VREvent_t& evt)
+{
+	m_overlayVisible = evt.eventType == vr::VREvent_OverlayShown;
+}
+
+void OVROverlayController::onDashboardChanged(const vr::VREvent_t& evt)
+{
+	m_dashboardActive = evt.eventType == vr::VREvent_DashboardActivated;
+}
+
+void OVROverlayController::onChaperoneChanged(const vr::VREvent_t& evt)
+{
+	LOG_INFO("Chaperone changed (event {})", evt.eventType);
+}
+
+void OVROverlayController::updateOverlaySizeAndPosition()
+{
+	if (!m_connected) return;
+
+	vr::VROverlayError err = m_sink->setWidth(m_overlayWidth);
+	if (err != vr::VROverlayError_None) {
+		LOG_ERROR("SetOverlayWidthInMeters error: {}", err);
+	}
+
+	updateOverlayTransform();
+}
+
+void OVROverlayController::updateOverlayTransform()
+{
+	if (!m_connected) return;
+
+	TRACE_SCOPE("OVROverlayController::updateOverlayTransform");
+
+	// the overlay is head locked, so rotating it by the head motion since capture keeps the image in place in the world
+	vr::HmdMatrix34_t position = multiplyMatrices(m_reprojectionRotation, createOverlayMatrix(m_overlayZDistance));
+	vr::VROverlayError err = m_sink->setTransform(position);
+
+	if (err != vr::VROverlayError_None) {
+		LOG_ERROR("SetOverlayTransformTrackedDeviceRelative error: {}", err);
+	}
+}
+
+float OVROverlayController::getSecondsToDeadline()
+{
+	float remaining = m_sink->getFrameTimeRemaining();
+
+	if (remaining > 0.0f) {
+		return remaining;
+	}
+
+	// no frame timing available (e.g. no scene application running), derive the deadline from the last vsync instead
+	float sinceVsync;
+	uint64_t frameCounter;
+
+	if (m_sink->getTimeSinceLastVsync(sinceVsync, frameCounter)) {
+		float period = 1.0f / m_displayFrequency;
+		return period - std::fmod(sinceVsync, period);
+	}
+
+	return 0.0f;
+}
+
+void OVROverlayController::sleepFor(float seconds)
+{
+	m_clock->sleepFor(static_cast<int64_t>(seconds * 1e6f));
+}
+
+vr::HmdMatrix34_t OVROverlayController::createOverlayMatrix(float zDistance)
+{
+	switch (m_overlayRotation) {
+	case 1:
+		return {
+			0.0f, -1.0f, 0.0f, 0.0f,
+			1.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 1.0f, -zDistance
+		};
+	case 2:
+		return {
+			-1.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, -1.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 1.0f, -zDistance
+		};
+	case 3:
+		return {
+			0.0f, 1.0f, 0.0f, 0.0f,
+			-1.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 1.0f, -zDistance
+		};
+	default:
+		return {
+			1.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, 1.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 1.0f, -zDistance
+		};
+	}
+}
@@ -1,67 +1,132 @@
-#pragma once
-
-#include <Windows.h>
-#include <GL/glew.h>
-#include <openvr.h>
-#include <iostream>
-#include <filesystem>
-
-#include "utils.h"
-
-
-class OVROverlayController
-{
-public:
-	static OVROverlayController* getInstance();
-
-	OVROverlayController();
-	~OVROverlayController();
-
-	bool init();
-	void shutdown();
-
-	void pollEvents();
-	bool isConnected();
-
-	void showOverlay();
-	void hideOverlay();
-	void toggleOverlay();
-	void setTexture(GLuint id);
-	void setOverlayRotation(int rotation);
-	void setOverlayAlpha(float alpha);
-	void setOverlayWidth(float width);
-	float getOverlayWidth();
-	void setOverlayDistance(float zDistance);
-	float getOverlayDistance();
-
-	void installManifest();
-	void removeManifest();
-	bool isManifestInstalled();
-
-	bool BHMDAvailable();
-	//vr::IVRSystem* getVRSystem();
-	vr::HmdError getLastHmdError();
-
-private:
-	bool connectToVRRuntime();
-	void disconnectFromVRRuntime();
-	void updateOverlaySizeAndPosition();
-	vr::HmdMatrix34_t createOverlayMatrix(float zDistance);
-
-	bool m_connected { false };
-	int m_overlayRotation{ 0 };
-	float m_overlayWidth{ 0.5f };
-	float m_overlayZDistance{ 0.3f };
-	vr::IVRSystem* m_VRSystem { nullptr };
-
-	std::string m_strVRDriver { "No Driver" };
-	std::string m_strVRDisplay { "No Display" };
-
-	vr::TrackedDevicePose_t m_rTrackedDevicePose[vr::k_unMaxTrackedDeviceCount];
-	vr::HmdError m_eLastHmdError;
-
-	vr::HmdError m_eCompositorError;
-	vr::HmdError m_eOverlayError;
-	vr::VROverlayHandle_t m_ulOverlayHandle;
-};
-
+#pragma once
+
+#include <GL/glew.h>
+#include <openvr.h>
+#include <iostream>
+#include <filesystem>
+#include <chrono>
+#include <algorithm>
+#include <thread>
+#include <cmath>
+#include <map>
+
+#include "utils.h"
+#include "Log.h"
+#include "Histogram.h"
+#include "Trace.h"
+#include "OverlaySink.h"
+#include "Clock.h"
+#include "SwipeDetector.h"
+#include "LatencyTracker.h"
+#include "ConnectionMonitor.h"
+
+
+struct EventPumpStats {
+	uint32_t lastEventsPerTick { 0 };
+	uint32_t maxEventsPerTick { 0 };
+	uint64_t totalEvents { 0 };
+	std::chrono::microseconds maxPumpDuration { 0 };
+};
+
+class OVROverlayController
+{
+	using EventHandler = void (OVROverlayController::*)(const vr::VREvent_t&);
+
+public:
+	static OVROverlayController* getInstance();
+
+	OVROverlayController();
+	~OVROverlayController();
+
+	void setSink(std::unique_ptr<OverlaySink> sink); // before init(), the OpenVROverlaySink live and a MockOverlaySink elsewhere
+	void setClock(Clock* clock);
+	bool init();
+	void shutdown();
+
+	void updateConnection(); // reconnects once SteamVR is back, with backoff between the attempts
+	void pollEvents();
+	bool isConnected();
+	bool isStandby();
+	bool isOverlayVisible();
+	bool isDashboardActive();
+	EventPumpStats getEventPumpStats();
+	void logStatistics();
+
+	void showOverlay();
+	void hideOverlay();
+	void toggleOverlay();
+	void handleSwipe(SwipeDirection swipe);
+	void waitForSubmitWindow();
+	int64_t getPredictedPhotonTime();
+	FrameTimestamps submitFrame(GLuint id, FrameTimestamps timestamps);
+	void setTexture(GLuint id);
+	void setOverlayRotation(int rotation);
+	int getOverlayRotation();
+	void setOverlayAlpha(float alpha);
+	float getOverlayAlpha();
+	void setOverlayWidth(float width);
+	float getOverlayWidth();
+	void setOverlayDistance(float zDistance);
+	float getOverlayDistance();
+	void setReprojectionEnabled(bool enabled);
+	bool getReprojectionEnabled();
+	void updateReprojection(int64_t captureTime);
+	void setStereo(bool stereo);
+	bool getStereo();
+
+	bool installManifest(); // false if it failed, the tray menu tells the user
+	bool removeManifest();
+	bool isManifestInstalled();
+
+	//vr::IVRSystem* getVRSystem();
+	vr::HmdError getLastHmdError();
+
+private:
+	bool openOverlay(bool startRuntime);
+	bool connectToVRRuntime();
+	void disconnectFromVRRuntime(const char* reason);
+	void updateOverlaySizeAndPosition();
+	void updateOverlayTransform();
+	vr::HmdMatrix34_t createOverlayMatrix(float zDistance);
+	float getSecondsToDeadline();
+	void sleepFor(float seconds);
+
+	void dispatchEvent(const vr::VREvent_t& evt);
+	void onQuit(const vr::VREvent_t& evt);
+	void onStandbyChanged(const vr::VREvent_t& evt);
+	void onOverlayVisibilityChanged(const vr::VREvent_t& evt);
+	void onDashboardChanged(const vr::VREvent_t& evt);
+	void onChaperoneChanged(const vr::VREvent_t& evt);
+
+	static const std::map<uint32_t, EventHandler> s_eventHandlers;
+
+	bool m_connected { false };
+	ConnectionMonitor m_connectionMonitor;
+	bool m_showAfterReconnect { false }; // the overlay comes back the way it was
+	bool m_standby { false };
+	bool m_overlayVisible { false };
+	bool m_dashboardActive { false };
+	EventPumpStats m_eventPumpStats;
+	int m_overlayRotation{ 0 };
+	float m_overlayAlpha{ 1.0f };
+	float m_overlayWidth{ 0.5f };
+	float m_overlayZDistance{ 0.3f };
+	float m_displayFrequency{ 90.0f };
+	float m_secondsFromVsyncToPhotons{ 0.0f };
+	bool m_reprojectionEnabled{ true };
+	bool m_stereo{ true };
+	vr::HmdMatrix34_t m_reprojectionRotation;
+	uint64_t m_pacedFrameCounter{ 0 };
+	Clock* m_clock;
+	Histogram m_submitMarginHistogram;
+	std::unique_ptr<OverlaySink> m_sink;
+
+	std::string m_strVRDriver { "No Driver" };
+	std::string m_strVRDisplay { "No Display" };
+
+	vr::HmdError m_eLastHmdError;
+
+	vr::HmdError m_eCompositorError;
+	vr::HmdError m_eOverlayError;
+};
+
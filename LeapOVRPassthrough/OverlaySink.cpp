@@ -0,0 +1,171 @@
+#include "OverlaySink.h"
+#include "Log.h"
+
+#include <filesystem>
+
+bool OpenVROverlaySink::isRuntimeRunning()
+{
+	// a background application is turned away instead of starting SteamVR, so this can't bring back a runtime the user quit
+	vr::HmdError error = vr::VRInitError_None;
+	vr::VR_Init(&error, vr::VRApplication_Background);
+
+	if (error != vr::VRInitError_None) {
+		return false;
+	}
+
+	vr::VR_Shutdown();
+	return true;
+}
+
+bool OpenVROverlaySink::connect(vr::HmdError& error)
+{
+	m_VRSystem = vr::VR_Init(&error, vr::VRApplication_Overlay);
+
+	if (error != vr::VRInitError_None) {
+		m_VRSystem = nullptr;
+		return false;
+	}
+
+	return true;
+}
+
+void OpenVROverlaySink::disconnect()
+{
+	vr::VR_Shutdown();
+	m_VRSystem = nullptr;
+	m_overlayHandle = vr::k_ulOverlayHandleInvalid;
+}
+
+bool OpenVROverlaySink::createOverlay(const char* key, const char* name)
+{
+	if (vr::VRCompositor() == NULL || vr::VROverlay() == NULL) {
+		return false;
+	}
+
+	return vr::VROverlay()->CreateOverlay(key, name, &m_overlayHandle) == vr::VROverlayError_None;
+}
+
+bool OpenVROverlaySink::pollEvent(vr::VREvent_t& evt)
+{
+	if (m_VRSystem == nullptr) return false;
+
+	// system events first, then the ones for our overlay
+	return m_VRSystem->PollNextEvent(&evt, sizeof(evt)) || vr::VROverlay()->PollNextOverlayEvent(m_overlayHandle, &evt, sizeof(evt));
+}
+
+vr::VROverlayError OpenVROverlaySink::showOverlay()
+{
+	return vr::VROverlay()->ShowOverlay(m_overlayHandle);
+}
+
+vr::VROverlayError OpenVROverlaySink::hideOverlay()
+{
+	return vr::VROverlay()->HideOverlay(m_overlayHandle);
+}
+
+bool OpenVROverlaySink::isOverlayVisible()
+{
+	return vr::VROverlay()->IsOverlayVisible(m_overlayHandle);
+}
+
+vr::VROverlayError OpenVROverlaySink::setTexture(GLuint id)
+{
+	vr::Texture_t texture;
+	texture.handle = (void*)(uintptr_t)id;
+	texture.eType = vr::TextureType_OpenGL;
+	texture.eColorSpace = vr::ColorSpace_Auto;
+
+	return vr::VROverlay()->SetOverlayTexture(m_overlayHandle, &texture);
+}
+
+vr::VROverlayError OpenVROverlaySink::setAlpha(float alpha)
+{
+	return vr::VROverlay()->SetOverlayAlpha(m_overlayHandle, alpha);
+}
+
+vr::VROverlayError OpenVROverlaySink::setWidth(float width)
+{
+	return vr::VROverlay()->SetOverlayWidthInMeters(m_overlayHandle, width);
+}
+
+vr::VROverlayError OpenVROverlaySink::setTransform(const vr::HmdMatrix34_t& transform)
+{
+	return vr::VROverlay()->SetOverlayTransformTrackedDeviceRelative(m_overlayHandle, vr::k_unTrackedDeviceIndex_Hmd, &transform);
+}
+
+vr::VROverlayError OpenVROverlaySink::setStereo(bool stereo)
+{
+	// the left half of the texture is shown to the left eye and the right half to the right eye
+	return vr::VROverlay()->SetOverlayFlag(m_overlayHandle, vr::VROverlayFlags_SideBySide_Parallel, stereo);
+}
+
+float OpenVROverlaySink::getDisplayFrequency()
+{
+	if (m_VRSystem == nullptr) return 0.0f;
+
+	return m_VRSystem->GetFloatTrackedDeviceProperty(vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_DisplayFrequency_Float);
+}
+
+float OpenVROverlaySink::getSecondsFromVsyncToPhotons()
+{
+	if (m_VRSystem == nullptr) return 0.0f;
+
+	return m_VRSystem->GetFloatTrackedDeviceProperty(vr::k_unTrackedDeviceIndex_Hmd, vr::Prop_SecondsFromVsyncToPhotons_Float);
+}
+
+bool OpenVROverlaySink::getTimeSinceLastVsync(float& seconds, uint64_t& frameCounter)
+{
+	if (m_VRSystem == nullptr) return false;
+
+	return m_VRSystem->GetTimeSinceLastVsync(&seconds, &frameCounter);
+}
+
+float OpenVROverlaySink::getFrameTimeRemaining()
+{
+	if (vr::VRCompositor() == NULL) return 0.0f;
+
+	return vr::VRCompositor()->GetFrameTimeRemaining();
+}
+
+bool OpenVROverlaySink::getHmdPose(float secondsFromNow, vr::TrackedDevicePose_t& pose)
+{
+	if (m_VRSystem == nullptr) return false;
+
+	// the hmd is always device 0, so we only need to fetch the first pose
+	m_VRSystem->GetDeviceToAbsoluteTrackingPose(vr::TrackingUniverseStanding, secondsFromNow, &pose, 1);
+	return pose.bPoseIsValid;
+}
+
+bool OpenVROverlaySink::isManifestInstalled(const char* key)
+{
+	return vr::VRApplications() != NULL && vr::VRApplications()->IsApplicationInstalled(key);
+}
+
+bool OpenVROverlaySink::installManifest(const char* path)
+{
+	vr::EVRApplicationError err = vr::VRApplications()->AddApplicationManifest(path);
+
+	if (err != vr::VRApplicationError_None) {
+		LOG_ERROR("Error while adding manifest: {}", vr::VRApplications()->GetApplicationsErrorNameFromEnum(err));
+		return false;
+	}
+
+	return true;
+}
+
+bool OpenVROverlaySink::removeManifest(const char* key)
+{
+	char manifestPathBase[512] = { 0 };
+	vr::VRApplications()->GetApplicationPropertyString(key, vr::VRApplicationProperty_WorkingDirectory_String, manifestPathBase, 512, nullptr);
+
+	std::filesystem::path manifest_path = std::filesystem::path(manifestPathBase) / "manifest.vrmanifest";
+
+	vr::EVRApplicationError err = vr::VRApplications()->RemoveApplicationManifest(manifest_path.string().c_str());
+
+	if (err != vr::VRApplicationError_None) {
+		LOG_ERROR("Error while removing manifest: {}", vr::VRApplications()->GetApplicationsErrorNameFromEnum(err));
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <openvr.h>
+#include <cstdint>
+
+// Everything the OVROverlayController needs from the compositor: the overlay itself, its events and the frame timing.
+// Besides SteamVR this can be the in-process MockOverlaySink (see MockOverlaySink.h), so the submit path and the reconnects
+// run without a VR runtime.
+class OverlaySink
+{
+public:
+	virtual ~OverlaySink() {}
+
+	virtual bool isRuntimeRunning() = 0; // must not start the runtime, reconnecting asks this first
+	virtual bool connect(vr::HmdError& error) = 0;
+	virtual void disconnect() = 0;
+	virtual bool createOverlay(const char* key, const char* name) = 0;
+	virtual bool pollEvent(vr::VREvent_t& evt) = 0;
+
+	virtual vr::VROverlayError showOverlay() = 0;
+	virtual vr::VROverlayError hideOverlay() = 0;
+	virtual bool isOverlayVisible() = 0;
+	virtual vr::VROverlayError setTexture(GLuint id) = 0;
+	virtual vr::VROverlayError setAlpha(float alpha) = 0;
+	virtual vr::VROverlayError setWidth(float width) = 0;
+	virtual vr::VROverlayError setTransform(const vr::HmdMatrix34_t& transform) = 0; // relative to the hmd
+	virtual vr::VROverlayError setStereo(bool stereo) = 0;
+
+	virtual float getDisplayFrequency() = 0; // 0 if unknown
+	virtual float getSecondsFromVsyncToPhotons() = 0;
+	virtual bool getTimeSinceLastVsync(float& seconds, uint64_t& frameCounter) = 0;
+	virtual float getFrameTimeRemaining() = 0; // 0 if there is no frame timing
+	virtual bool getHmdPose(float secondsFromNow, vr::TrackedDevicePose_t& pose) = 0;
+
+	// the manifest that registers the overlay with SteamVR so that it starts along with it
+	virtual bool isManifestInstalled(const char* key) = 0;
+	virtual bool installManifest(const char* path) = 0;
+	virtual bool removeManifest(const char* key) = 0; // the one in the directory the application was registered from
+};
+
+class OpenVROverlaySink : public OverlaySink
+{
+public:
+	bool isRuntimeRunning() override;
+	bool connect(vr::HmdError& error) override;
+	void disconnect() override;
+	bool createOverlay(const char* key, const char* name) override;
+	bool pollEvent(vr::VREvent_t& evt) override;
+
+	vr::VROverlayError showOverlay() override;
+	vr::VROverlayError hideOverlay() override;
+	bool isOverlayVisible() override;
+	vr::VROverlayError setTexture(GLuint id) override;
+	vr::VROverlayError setAlpha(float alpha) override;
+	vr::VROverlayError setWidth(float width) override;
+	vr::VROverlayError setTransform(const vr::HmdMatrix34_t& transform) override;
+	vr::VROverlayError setStereo(bool stereo) override;
+
+	float getDisplayFrequency() override;
+	float getSecondsFromVsyncToPhotons() override;
+	bool getTimeSinceLastVsync(float& seconds, uint64_t& frameCounter) override;
+	float getFrameTimeRemaining() override;
+	bool getHmdPose(float secondsFromNow, vr::TrackedDevicePose_t& pose) override;
+
+	bool isManifestInstalled(const char* key) override;
+	bool installManifest(const char* path) override;
+	bool removeManifest(const char* key) override;
+
+private:
+	vr::IVRSystem* m_VRSystem { nullptr };
+	vr::VROverlayHandle_t m_overlayHandle { vr::k_ulOverlayHandleInvalid };
+};
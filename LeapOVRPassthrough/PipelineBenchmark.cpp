@@ -0,0 +1,189 @@
+#include "PipelineBenchmark.h"
+#include "LeapHandler.h"
+#include "GraphicsManager.h"
+#include "OVROverlayController.h"
+#include "MockOverlaySink.h"
+#include "LatencyTracker.h"
+#include "FrameGenerator.h"
+#include "Histogram.h"
+#include "Log.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <set>
+#include <vector>
+
+const int k_pipelineFrameRates[] = { 60, 90, 120, 144, 240 };
+const int64_t k_pipelineWarmup = 500000; // microseconds, the first frames size all the buffers
+const int64_t k_pipelineDuration = 5000000; // microseconds measured per frame rate
+const float k_compositorRate = 90.0f;
+
+struct SubmittedFrame {
+	int64_t frameId;
+	int64_t captureTime;
+	int64_t submitTime;
+};
+
+struct PipelineResult {
+	int frameRate { 0 };
+	double seconds { 0.0 };
+	uint64_t produced { 0 };
+	uint64_t submitted { 0 }; // distinct frames
+	uint64_t repeated { 0 }; // submits that had no new frame and showed the last one again
+	uint64_t missedVsyncs { 0 }; // compositor frames without any submit
+	double ageP50 { 0.0 }; // milliseconds from capture to submit
+	double ageP99 { 0.0 };
+	double ageP999 { 0.0 };
+};
+
+int64_t getLatestFrameId(LeapHandler* leapHandler) {
+	std::shared_ptr<const ImagePyramid> pyramid = leapHandler->getLatestPyramid();
+	return pyramid ? pyramid->getFrameId() : -1;
+}
+
+PipelineResult runPipeline(int frameRate, MockOverlaySink* sink) {
+	LeapHandler* leapHandler = LeapHandler::getInstance();
+	GraphicsManager* graphicsManager = GraphicsManager::getInstance();
+	OVROverlayController* vrController = OVROverlayController::getInstance();
+
+	// swipes keep the detectors as busy as they are in use
+	FrameGeneratorConfig config;
+	config.frameRate = frameRate;
+	config.swipes = makeSwipeSequence(4, 1500000, 400000);
+	config.loopDuration = 5 * 1500000;
+
+	leapHandler->openSynthetic(config);
+
+	std::vector<SubmittedFrame> submissions;
+	submissions.reserve(static_cast<size_t>(k_compositorRate * (k_pipelineWarmup + k_pipelineDuration) / 1e6) + 1);
+	sink->clearCalls();
+
+	int64_t startTime = getHostTimeMicroseconds();
+	int64_t measureStart = startTime + k_pipelineWarmup;
+	int64_t measureEnd = measureStart + k_pipelineDuration;
+	int64_t firstFrameId = -1;
+
+	// the submit part of the main loop, paced by the mock compositor
+	while (getHostTimeMicroseconds() < measureEnd) {
+		vrController->waitForSubmitWindow();
+
+		if (firstFrameId < 0 && getHostTimeMicroseconds() >= measureStart) {
+			firstFrameId = getLatestFrameId(leapHandler);
+			LatencyTracker::getInstance()->reset();
+		}
+
+		graphicsManager->updateTexture();
+
+		if (graphicsManager->wasUpdated()) {
+			FrameTimestamps timestamps = vrController->submitFrame(graphicsManager->getVideoTexture(), graphicsManager->getFrameTimestamps());
+
+			if (timestamps.stages[FrameStage_Submit] >= measureStart) {
+				submissions.push_back({ timestamps.frameId, timestamps.stages[FrameStage_Capture], timestamps.stages[FrameStage_Submit] });
+			}
+		}
+
+		vrController->pollEvents();
+	}
+
+	int64_t lastFrameId = getLatestFrameId(leapHandler);
+	leapHandler->join();
+
+	// every compositor frame in the measured window should have gotten a texture
+	std::set<uint64_t> servedFrames;
+	uint64_t firstVsync = UINT64_MAX;
+	uint64_t lastVsync = 0;
+
+	for (const MockOverlayCall& call : sink->getCalls()) {
+		if (call.type != MockOverlayCall_SetTexture || call.time < measureStart) continue;
+
+		servedFrames.insert(call.frameCounter);
+		firstVsync = (std::min)(firstVsync, call.frameCounter);
+		lastVsync = (std::max)(lastVsync, call.frameCounter);
+	}
+
+	PipelineResult result;
+	result.frameRate = frameRate;
+	result.seconds = k_pipelineDuration / 1e6;
+	result.produced = (firstFrameId >= 0 && lastFrameId > firstFrameId) ? lastFrameId - firstFrameId : 0;
+	result.missedVsyncs = servedFrames.empty() ? 0 : (lastVsync - firstVsync + 1) - servedFrames.size();
+
+	Histogram ageHistogram("Frame age at submit (ms)", 0.0, 100.0, 1000);
+	int64_t previousId = firstFrameId;
+
+	for (const SubmittedFrame& submission : submissions) {
+		if (submission.frameId == previousId) {
+			result.repeated++;
+			continue;
+		}
+
+		// only frames captured in the measured window count, everything older is warmup
+		if (submission.frameId > firstFrameId) {
+			result.submitted++;
+			ageHistogram.record((submission.submitTime - submission.captureTime) / 1000.0);
+		}
+
+		previousId = submission.frameId;
+	}
+
+	result.ageP50 = ageHistogram.getPercentile(50.0);
+	result.ageP99 = ageHistogram.getPercentile(99.0);
+	result.ageP999 = ageHistogram.getPercentile(99.9);
+
+	LOG_INFO("Pipeline at {} Hz: {} frames/s produced, {} frames/s submitted, frame age p50 {} ms, p99 {} ms, p99.9 {} ms",
+		frameRate, result.produced / result.seconds, result.submitted / result.seconds, result.ageP50, result.ageP99, result.ageP999);
+	LatencyTracker::getInstance()->logStatistics();
+
+	return result;
+}
+
+int runPipelineBenchmark(const char* outputPath, int frameRate, int64_t submitLatency) {
+	GraphicsManager::getInstance()->setHeadless(true);
+
+	std::unique_ptr<MockOverlaySink> sink = std::make_unique<MockOverlaySink>(k_compositorRate, SteadyClock::getInstance());
+	MockOverlaySink* mockSink = sink.get();
+	sink->setSubmitLatency(submitLatency);
+
+	OVROverlayController* vrController = OVROverlayController::getInstance();
+	vrController->setSink(std::move(sink));
+	vrController->init();
+	vrController->showOverlay();
+	vrController->pollEvents();
+
+	std::vector<PipelineResult> results;
+
+	if (frameRate > 0) {
+		results.push_back(runPipeline(frameRate, mockSink));
+	} else {
+		for (int rate : k_pipelineFrameRates) {
+			results.push_back(runPipeline(rate, mockSink));
+		}
+	}
+
+	vrController->logStatistics();
+
+	FILE* file = nullptr;
+	if (fopen_s(&file, outputPath, "w") != 0 || file == nullptr) {
+		LOG_ERROR("Could not write pipeline benchmark results to {}", outputPath);
+		return 1;
+	}
+
+	fprintf(file, "{\n\t\"compositor_rate\": %.1f,\n\t\"submit_latency_us\": %lld,\n\t\"pipelines\": [\n", k_compositorRate, static_cast<long long>(submitLatency));
+
+	for (size_t i = 0; i < results.size(); i++) {
+		const PipelineResult& result = results[i];
+
+		// above the compositor rate frames have to be dropped, the drop rate only means something below it
+		double dropRate = (result.produced > 0) ? 1.0 - static_cast<double>(result.submitted) / result.produced : 0.0;
+
+		fprintf(file, "\t\t{ \"frame_rate\": %d, \"seconds\": %.1f, \"produced_per_second\": %.1f, \"submitted_per_second\": %.1f, \"drop_rate\": %.4f, \"repeated_submits\": %llu, \"missed_vsyncs\": %llu, \"age_p50_ms\": %.2f, \"age_p99_ms\": %.2f, \"age_p999_ms\": %.2f }%s\n",
+			result.frameRate, result.seconds, result.produced / result.seconds, result.submitted / result.seconds, dropRate,
+			static_cast<unsigned long long>(result.repeated), static_cast<unsigned long long>(result.missedVsyncs), result.ageP50, result.ageP99, result.ageP999, (i + 1 < results.size()) ? "," : "");
+	}
+
+	fprintf(file, "\t]\n}\n");
+	fclose(file);
+
+	LOG_INFO("Pipeline benchmark results written to {}", outputPath);
+	return 0;
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include <cstdint>
+
+// Runs the whole frame path without the Leap service, SteamVR or a GPU: generated frames go through the LeapHandler,
+// the GraphicsManager and the OVROverlayController into a MockOverlaySink, submitting the way the main loop does.
+// Sustained throughput, dropped frames and the age of frames at submit are written as JSON for each frame rate.
+// A frame rate of 0 measures all of 60, 90, 120, 144 and 240 Hz. submitLatency (microseconds) slows down every submit.
+// Part of the overlay, not the CMake build: the LeapHandler and the OVROverlayController still link LeapC, OpenVR and GLEW,
+// so it only runs on Windows (with or without a GPU or headset) and isn't run by Linux CI. The stages it strings together
+// are covered there by the Benchmark project.
+int runPipelineBenchmark(const char* outputPath, int frameRate, int64_t submitLatency);
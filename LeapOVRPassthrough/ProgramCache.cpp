@@ -0,0 +1,283 @@
+#include "ProgramCache.h"
+#include "Log.h"
+#include "utils.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <vector>
+
+const uint32_t k_programBinaryMagic = 0x42504F4C; // "LOPB"
+const uint32_t k_programBinaryVersion = 1;
+
+struct ProgramBinaryHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;
+	uint32_t format; // as returned by glGetProgramBinary
+	uint32_t length;
+};
+
+uint64_t hashBytes(uint64_t hash, const void* data, size_t length) {
+	// FNV-1a, only has to tell driver versions and shader edits apart
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+	for (size_t i = 0; i < length; i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001B3ull;
+	}
+
+	return hash;
+}
+
+uint64_t hashString(uint64_t hash, const GLubyte* string) {
+	return (string != nullptr) ? hashBytes(hash, string, strlen(reinterpret_cast<const char*>(string)) + 1) : hash;
+}
+
+bool compileShader(GLuint id, const char* code, GLint length) {
+	glShaderSource(id, 1, &code, &length);
+	glCompileShader(id);
+
+	GLint status = GL_FALSE;
+	GLint infoLogLength = 0;
+	glGetShaderiv(id, GL_COMPILE_STATUS, &status);
+	glGetShaderiv(id, GL_INFO_LOG_LENGTH, &infoLogLength);
+
+	if (infoLogLength > 1) {
+		std::vector<char> infoLog(infoLogLength + 1);
+		glGetShaderInfoLog(id, infoLogLength, NULL, infoLog.data());
+
+		if (status == GL_TRUE) {
+			LOG_WARNING("{}", infoLog.data());
+		} else {
+			LOG_ERROR("{}", infoLog.data());
+		}
+	}
+
+	return status == GL_TRUE;
+}
+
+bool checkLinkStatus(GLuint program, bool logErrors) {
+	GLint status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+
+	if (status != GL_TRUE && logErrors) {
+		GLint infoLogLength = 0;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &infoLogLength);
+
+		std::vector<char> infoLog(infoLogLength + 1);
+		glGetProgramInfoLog(program, infoLogLength, NULL, infoLog.data());
+
+		LOG_ERROR("{}", infoLog.data());
+	}
+
+	return status == GL_TRUE;
+}
+
+ProgramCache* s_programCache = nullptr;
+
+ProgramCache* ProgramCache::getInstance()
+{
+	if (s_programCache == nullptr) {
+		s_programCache = new ProgramCache();
+	}
+
+	return s_programCache;
+}
+
+ProgramCache::ProgramCache()
+{
+	char localAppData[MAX_PATH];
+	DWORD length = GetEnvironmentVariableA("LOCALAPPDATA", localAppData, MAX_PATH);
+
+	if (length > 0 && length < MAX_PATH) {
+		m_directory = std::filesystem::path(localAppData) / "LeapMotionOverlay" / "programs";
+	} else {
+		std::error_code error;
+		m_directory = std::filesystem::temp_directory_path(error) / "LeapMotionOverlay" / "programs";
+	}
+}
+
+GLuint ProgramCache::linkProgram(const char* name, const char* vertexCode, GLint vertexLength, const char* fragmentCode, GLint fragmentLength)
+{
+	if (!m_binariesChecked) {
+		GLint formats = 0;
+
+		if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary) {
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		}
+
+		m_binariesChecked = true;
+		m_binariesSupported = formats > 0;
+
+		if (!m_binariesSupported) {
+			LOG_INFO("The driver can't hand out program binaries, shaders are compiled on every start");
+		}
+	}
+
+	int64_t start = getHostTimeMicroseconds();
+
+	std::filesystem::path path = m_directory / (std::string(name) + ".bin");
+	uint64_t key = computeKey(vertexCode, vertexLength, fragmentCode, fragmentLength);
+
+	if (m_binariesSupported) {
+		GLuint program = loadBinary(path, key);
+
+		if (program != 0) {
+			m_stats.hits++;
+			LOG_INFO("Program {} loaded from its binary in {} ms", name, (getHostTimeMicroseconds() - start) / 1000.0);
+			return program;
+		}
+	}
+
+	GLuint program = compileProgram(vertexCode, vertexLength, fragmentCode, fragmentLength);
+
+	if (program == 0) {
+		return 0;
+	}
+
+	m_stats.misses++;
+	LOG_INFO("Program {} compiled in {} ms", name, (getHostTimeMicroseconds() - start) / 1000.0);
+
+	if (m_binariesSupported) {
+		storeBinary(path, key, program);
+	}
+
+	return program;
+}
+
+void ProgramCache::clear()
+{
+	std::error_code error;
+	std::filesystem::remove_all(m_directory, error);
+}
+
+ProgramCacheStats ProgramCache::getStats()
+{
+	return m_stats;
+}
+
+uint64_t ProgramCache::computeKey(const char* vertexCode, GLint vertexLength, const char* fragmentCode, GLint fragmentLength)
+{
+	// a driver update keeps the vendor and renderer but changes the version string
+	uint64_t hash = 0xCBF29CE484222325ull;
+	hash = hashString(hash, glGetString(GL_VENDOR));
+	hash = hashString(hash, glGetString(GL_RENDERER));
+	hash = hashString(hash, glGetString(GL_VERSION));
+	hash = hashBytes(hash, vertexCode, vertexLength);
+	hash = hashBytes(hash, fragmentCode, fragmentLength);
+
+	return hash;
+}
+
+GLuint ProgramCache::loadBinary(const std::filesystem::path& path, uint64_t key)
+{
+	FILE* file = nullptr;
+	if (_wfopen_s(&file, path.c_str(), L"rb") != 0 || file == nullptr) {
+		return 0;
+	}
+
+	ProgramBinaryHeader header;
+	std::vector<uint8_t> binary;
+
+	bool valid = fread(&header, sizeof(header), 1, file) == 1 && header.magic == k_programBinaryMagic &&
+		header.version == k_programBinaryVersion && header.key == key;
+
+	if (valid) {
+		binary.resize(header.length);
+		valid = fread(binary.data(), 1, binary.size(), file) == binary.size();
+	}
+
+	fclose(file);
+
+	if (!valid) {
+		return 0;
+	}
+
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+
+	// drivers may refuse their own binaries, e.g. after an update that kept the version string
+	if (!checkLinkStatus(program, false)) {
+		glDeleteProgram(program);
+		m_stats.rejected++;
+		LOG_WARNING("The driver refused the stored binary {}, compiling from source", path.filename().string());
+		return 0;
+	}
+
+	return program;
+}
+
+void ProgramCache::storeBinary(const std::filesystem::path& path, uint64_t key, GLuint program)
+{
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+
+	if (length <= 0) return;
+
+	std::vector<uint8_t> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+
+	ProgramBinaryHeader header = { k_programBinaryMagic, k_programBinaryVersion, key, format, static_cast<uint32_t>(length) };
+
+	std::error_code error;
+	std::filesystem::create_directories(m_directory, error);
+
+	// written next to the old one and moved over it, so another instance starting up never reads half a file
+	std::filesystem::path temporaryPath = path;
+	temporaryPath += ".tmp";
+
+	FILE* file = nullptr;
+	if (_wfopen_s(&file, temporaryPath.c_str(), L"wb") != 0 || file == nullptr) {
+		LOG_WARNING("Could not store the program binary in {}", m_directory.string());
+		return;
+	}
+
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(binary.data(), 1, length, file) == static_cast<size_t>(length);
+	fclose(file);
+
+	if (written) {
+		std::filesystem::rename(temporaryPath, path, error);
+	}
+
+	if (!written || error) {
+		std::filesystem::remove(temporaryPath, error);
+		LOG_WARNING("Could not store the program binary in {}", m_directory.string());
+	}
+}
+
+GLuint ProgramCache::compileProgram(const char* vertexCode, GLint vertexLength, const char* fragmentCode, GLint fragmentLength)
+{
+	GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+	GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+	GLuint program = 0;
+
+	if (compileShader(vertexShader, vertexCode, vertexLength) && compileShader(fragmentShader, fragmentCode, fragmentLength)) {
+		program = glCreateProgram();
+
+		// without the hint some drivers only hand out a binary that needs recompiling anyway
+		if (m_binariesSupported) {
+			glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+
+		glAttachShader(program, vertexShader);
+		glAttachShader(program, fragmentShader);
+		glLinkProgram(program);
+
+		if (!checkLinkStatus(program, true)) {
+			glDeleteProgram(program);
+			program = 0;
+		} else {
+			glDetachShader(program, vertexShader);
+			glDetachShader(program, fragmentShader);
+		}
+	}
+
+	// the program keeps what it needs, the shader objects are of no use after linking
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	return program;
+}
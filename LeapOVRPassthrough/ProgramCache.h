@@ -0,0 +1,38 @@
+#pragma once
+#include <GL/glew.h>
+#include <cstdint>
+#include <filesystem>
+
+struct ProgramCacheStats {
+	uint32_t hits { 0 }; // programs loaded from a binary
+	uint32_t misses { 0 }; // compiled from source, no usable binary or none stored yet
+	uint32_t rejected { 0 }; // binaries with the right key that the driver refused anyway
+};
+
+// Links the GL programs, or skips compiling and linking them by loading the binary the driver handed out on an earlier start.
+// A binary is only valid for the driver that produced it, so each file carries a key over the vendor, renderer and driver
+// version and the shader sources. A different key or a binary the driver refuses falls back to compiling from source and
+// replaces the file. Only used on the thread that owns the GL context.
+class ProgramCache
+{
+public:
+	static ProgramCache* getInstance();
+
+	ProgramCache();
+
+	// 0 if the program doesn't compile or link, the errors are logged
+	GLuint linkProgram(const char* name, const char* vertexCode, GLint vertexLength, const char* fragmentCode, GLint fragmentLength);
+	void clear(); // deletes every stored binary, doesn't need a GL context
+	ProgramCacheStats getStats();
+
+private:
+	uint64_t computeKey(const char* vertexCode, GLint vertexLength, const char* fragmentCode, GLint fragmentLength);
+	GLuint loadBinary(const std::filesystem::path& path, uint64_t key);
+	void storeBinary(const std::filesystem::path& path, uint64_t key, GLuint program);
+	GLuint compileProgram(const char* vertexCode, GLint vertexLength, const char* fragmentCode, GLint fragmentLength);
+
+	std::filesystem::path m_directory; // %LOCALAPPDATA%\LeapMotionOverlay\programs
+	bool m_binariesChecked { false };
+	bool m_binariesSupported { false }; // some drivers offer the extension but no binary formats
+	ProgramCacheStats m_stats;
+};
@@ -0,0 +1,78 @@
+#include "Replay.h"
+#include "LeapHandler.h"
+#include "GraphicsManager.h"
+#include "OVROverlayController.h"
+#include "MockOverlaySink.h"
+#include "LatencyTracker.h"
+#include "MainLoop.h"
+#include "Clock.h"
+#include "Log.h"
+#include "utils.h"
+
+const float k_replayDisplayFrequency = 90.0f;
+const int64_t k_replayIdleInterval = 16667; // microseconds, the main loop's pace while the overlay is hidden
+
+int runReplay(const char* path, SwipeSource source) {
+	LeapHandler* leapHandler = LeapHandler::getInstance();
+	GraphicsManager* graphicsManager = GraphicsManager::getInstance();
+	OVROverlayController* vrController = OVROverlayController::getInstance();
+
+	if (!leapHandler->openReplay(path)) {
+		LOG_ERROR("Could not replay {}", path);
+		return 1;
+	}
+
+	leapHandler->setSwipeSource(source);
+
+	int64_t startTime = leapHandler->getReplayStartTime();
+	VirtualClock clock(startTime);
+
+	MainLoop mainLoop(&clock);
+	graphicsManager->setHeadless(true);
+
+	std::unique_ptr<MockOverlaySink> sink = std::make_unique<MockOverlaySink>(k_replayDisplayFrequency, &clock);
+	MockOverlaySink* mockSink = sink.get();
+
+	vrController->setSink(std::move(sink));
+	vrController->init();
+
+	int64_t wallStart = getHostTimeMicroseconds();
+	uint32_t swipeCount = 0;
+	bool framesLeft = true;
+
+	// the main loop, except that the frames the polling thread would have handled by now are handled first
+	while (framesLeft) {
+		framesLeft = leapHandler->replayUntil(clock.now());
+
+		MainLoopTick tick = mainLoop.tick();
+
+		if (tick.swipe != SwipeDirection_None) {
+			LOG_INFO("Swipe {} at {} s", SwipeDetector::directionToString(tick.swipe), (tick.time - startTime) / 1e6);
+			swipeCount++;
+		}
+
+		if (!tick.submitting) {
+			clock.sleepFor(k_replayIdleInterval);
+		}
+	}
+
+	uint32_t submitCount = 0;
+
+	for (const MockOverlayCall& call : mockSink->getCalls()) {
+		if (call.type == MockOverlayCall_SetTexture) {
+			submitCount++;
+		}
+	}
+
+	double replayedSeconds = (clock.now() - startTime) / 1e6;
+	double wallSeconds = (getHostTimeMicroseconds() - wallStart) / 1e6;
+
+	LOG_INFO("Replayed {} s in {} s ({}x), {} swipes, {} frames submitted, overlay {} at the end",
+		replayedSeconds, wallSeconds, (wallSeconds > 0.0) ? replayedSeconds / wallSeconds : 0.0, swipeCount, submitCount,
+		vrController->isOverlayVisible() ? "shown" : "hidden");
+
+	leapHandler->logStatistics();
+	LatencyTracker::getInstance()->logStatistics();
+
+	return 0;
+}
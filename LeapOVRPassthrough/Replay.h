@@ -0,0 +1,9 @@
+#pragma once
+#include "SwipePipeline.h"
+
+// Runs a recorded session through the application's logic: swipe detection, the overlay reacting to the swipes and
+// frame submission, headless against a MockOverlaySink. The polling thread is folded into the main loop and everything
+// runs on a VirtualClock driven by the recorded timestamps, so an hour long session takes seconds and every run
+// takes the same decisions. The tracking based detection runs on the tracking frames recorded with the images,
+// so sessions recorded before those were (version 1) can't be replayed with it.
+int runReplay(const char* path, SwipeSource source);
@@ -0,0 +1,359 @@
+#include "SessionFile.h"
+#include "Log.h"
+#include "Trace.h"
+#include "utils.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+#include <ctime>
+#include <fstream>
+
+const char* const k_labelDirectionNames[SwipeDirection_Count] = { "top", "right", "bottom", "left" };
+
+SessionWriter::~SessionWriter()
+{
+	close();
+}
+
+bool SessionWriter::open(const std::string& path, int width, int height, bool dropWhenFull)
+{
+	close();
+
+	if (fopen_s(&m_file, path.c_str(), "wb") != 0 || m_file == nullptr) {
+		LOG_ERROR("Could not create session file {}", path);
+		m_file = nullptr;
+		return false;
+	}
+
+	SessionHeader header = { k_sessionMagic, k_sessionVersion, static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+	fwrite(&header, sizeof(header), 1, m_file);
+
+	m_width = width;
+	m_height = height;
+	m_dropWhenFull = dropWhenFull;
+	m_recordSize = sizeof(SessionFrameHeader) + sizeof(TrackingFrame) + static_cast<size_t>(width) * height * 2;
+
+	// all records are allocated up front, so recording doesn't allocate per frame
+	m_records.resize(k_sessionQueueFrames);
+	for (std::vector<uint8_t>& record : m_records) {
+		record.resize(m_recordSize);
+	}
+
+	m_queueStart = 0;
+	m_queueLength = 0;
+	m_closing = false;
+	m_failed = false;
+	m_droppedCount = 0;
+
+	m_thread = std::thread([this]() {
+		TRACE_THREAD_NAME("Session writer");
+		writeQueuedFrames();
+	});
+
+	return true;
+}
+
+bool SessionWriter::writeFrame(const ImageFrame& frame)
+{
+	if (m_file == nullptr || m_failed || frame.width != m_width || frame.height != m_height) {
+		return false;
+	}
+
+	size_t index;
+
+	{
+		std::unique_lock<std::mutex> lock(m_queueMutex);
+
+		if (m_queueLength == m_records.size()) {
+			if (m_dropWhenFull) {
+				m_droppedCount++;
+				return true;
+			}
+
+			m_queueChanged.wait(lock, [this]() { return m_queueLength < m_records.size() || m_failed; });
+
+			if (m_failed) {
+				return false;
+			}
+		}
+
+		index = (m_queueStart + m_queueLength) % m_records.size();
+	}
+
+	// the writer thread doesn't touch the record until it is queued below, and there is only one caller
+	uint8_t* record = m_records[index].data();
+	size_t imageSize = static_cast<size_t>(m_width) * m_height;
+	SessionFrameHeader header = { frame.frameId, frame.timestamp };
+
+	uint8_t* images = record + sizeof(header) + sizeof(TrackingFrame);
+
+	memcpy(record, &header, sizeof(header));
+	memcpy(record + sizeof(header), &frame.tracking, sizeof(TrackingFrame));
+	memcpy(images, frame.left, imageSize);
+	memcpy(images + imageSize, frame.right, imageSize);
+
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		m_queueLength++;
+	}
+
+	m_queueChanged.notify_all();
+	return true;
+}
+
+void SessionWriter::writeQueuedFrames()
+{
+	std::unique_lock<std::mutex> lock(m_queueMutex);
+
+	while (true) {
+		m_queueChanged.wait(lock, [this]() { return m_queueLength > 0 || m_closing; });
+
+		if (m_queueLength == 0) {
+			return;
+		}
+
+		// the record stays queued while it is written, so writeFrame can't reuse it
+		const std::vector<uint8_t>& record = m_records[m_queueStart];
+		lock.unlock();
+
+		bool success = !m_failed && fwrite(record.data(), m_recordSize, 1, m_file) == 1;
+
+		lock.lock();
+
+		if (!success) {
+			m_failed = true;
+		}
+
+		m_queueStart = (m_queueStart + 1) % m_records.size();
+		m_queueLength--;
+		m_queueChanged.notify_all();
+	}
+}
+
+void SessionWriter::close()
+{
+	if (m_thread.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(m_queueMutex);
+			m_closing = true;
+		}
+
+		m_queueChanged.notify_all();
+		m_thread.join();
+	}
+
+	if (m_file != nullptr) {
+		fclose(m_file);
+		m_file = nullptr;
+	}
+
+	m_records.clear();
+	m_records.shrink_to_fit();
+}
+
+bool SessionWriter::isOpen()
+{
+	return m_file != nullptr;
+}
+
+uint64_t SessionWriter::getDroppedCount()
+{
+	std::lock_guard<std::mutex> lock(m_queueMutex);
+	return m_droppedCount;
+}
+
+SessionReader::~SessionReader()
+{
+	close();
+}
+
+bool SessionReader::open(const std::string& path)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		LOG_ERROR("Could not open session file {}", path);
+		return false;
+	}
+
+	m_file = file;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof(SessionHeader))) {
+		LOG_ERROR("Session file {} is too small", path);
+		close();
+		return false;
+	}
+
+	m_mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	m_data = (m_mapping != NULL) ? static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+
+	if (m_data == nullptr) {
+		LOG_ERROR("Could not map session file {}", path);
+		close();
+		return false;
+	}
+
+	m_dataSize = static_cast<size_t>(fileSize.QuadPart);
+#else
+	int file = ::open(path.c_str(), O_RDONLY);
+	if (file < 0) {
+		LOG_ERROR("Could not open session file {}", path);
+		return false;
+	}
+
+	struct stat fileStat;
+	if (fstat(file, &fileStat) != 0 || fileStat.st_size < static_cast<off_t>(sizeof(SessionHeader))) {
+		LOG_ERROR("Session file {} is too small", path);
+		::close(file);
+		return false;
+	}
+
+	void* data = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	::close(file);
+
+	if (data == MAP_FAILED) {
+		LOG_ERROR("Could not map session file {}", path);
+		return false;
+	}
+
+	m_data = static_cast<const uint8_t*>(data);
+	m_dataSize = static_cast<size_t>(fileStat.st_size);
+	madvise(data, m_dataSize, MADV_SEQUENTIAL);
+#endif
+
+	SessionHeader header;
+	memcpy(&header, m_data, sizeof(header));
+
+	bool knownVersion = header.version == k_sessionVersion || header.version == k_sessionVersionWithoutTracking;
+
+	if (header.magic != k_sessionMagic || !knownVersion || header.width == 0 || header.height == 0) {
+		LOG_ERROR("{} is not a session file of version {} or {}", path, k_sessionVersionWithoutTracking, k_sessionVersion);
+		close();
+		return false;
+	}
+
+	m_width = static_cast<int>(header.width);
+	m_height = static_cast<int>(header.height);
+	m_trackingSize = (header.version == k_sessionVersionWithoutTracking) ? 0 : sizeof(TrackingFrame);
+	m_frameSize = sizeof(SessionFrameHeader) + m_trackingSize + static_cast<size_t>(m_width) * m_height * 2;
+
+	// a recording that was cut off in the middle of a frame just loses that frame
+	m_frameCount = (m_dataSize - sizeof(SessionHeader)) / m_frameSize;
+
+	return true;
+}
+
+void SessionReader::close()
+{
+#ifdef _WIN32
+	if (m_data != nullptr) {
+		UnmapViewOfFile(m_data);
+		m_data = nullptr;
+	}
+
+	if (m_mapping != nullptr) {
+		CloseHandle(m_mapping);
+		m_mapping = nullptr;
+	}
+
+	if (m_file != nullptr) {
+		CloseHandle(m_file);
+		m_file = nullptr;
+	}
+#else
+	if (m_data != nullptr) {
+		munmap(const_cast<uint8_t*>(m_data), m_dataSize);
+		m_data = nullptr;
+	}
+#endif
+
+	m_dataSize = 0;
+	m_frameCount = 0;
+}
+
+size_t SessionReader::getFrameCount()
+{
+	return m_frameCount;
+}
+
+ImageFrame SessionReader::getFrame(size_t index)
+{
+	const uint8_t* record = m_data + sizeof(SessionHeader) + index * m_frameSize;
+
+	SessionFrameHeader header;
+	memcpy(&header, record, sizeof(header));
+
+	ImageFrame frame;
+	frame.frameId = header.frameId;
+	frame.timestamp = header.timestamp;
+
+	if (m_trackingSize > 0) {
+		memcpy(&frame.tracking, record + sizeof(header), sizeof(TrackingFrame));
+	}
+
+	frame.width = m_width;
+	frame.height = m_height;
+	frame.left = record + sizeof(SessionFrameHeader) + m_trackingSize;
+	frame.right = frame.left + static_cast<size_t>(m_width) * m_height;
+
+	return frame;
+}
+
+std::string makeSessionFileName() {
+	time_t now = time(nullptr);
+	tm local;
+	localtime_s(&local, &now);
+
+	char name[64];
+	strftime(name, sizeof(name), "session-%Y%m%d-%H%M%S", &local);
+
+	return std::string(name) + k_sessionExtension;
+}
+
+std::vector<SessionLabel> loadSessionLabels(const std::string& path) {
+	std::vector<SessionLabel> labels;
+	std::ifstream file(path);
+
+	SessionLabel label;
+	std::string direction;
+	int fullPass;
+
+	while (file >> label.start >> label.end >> direction >> fullPass) {
+		label.direction = SwipeDirection_None;
+
+		for (int i = 0; i < SwipeDirection_Count; i++) {
+			if (direction == k_labelDirectionNames[i]) {
+				label.direction = static_cast<SwipeDirection>(i);
+			}
+		}
+
+		if (label.direction == SwipeDirection_None) {
+			LOG_WARNING("Unknown swipe direction {} in {}", direction, path);
+			continue;
+		}
+
+		label.fullPass = fullPass != 0;
+		labels.push_back(label);
+	}
+
+	return labels;
+}
+
+bool saveSessionLabels(const std::string& path, const std::vector<SessionLabel>& labels) {
+	std::ofstream file(path);
+
+	for (const SessionLabel& label : labels) {
+		file << label.start << " " << label.end << " " << k_labelDirectionNames[label.direction] << " " << (label.fullPass ? 1 : 0) << "\n";
+	}
+
+	return file.good();
+}
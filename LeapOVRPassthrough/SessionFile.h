@@ -0,0 +1,117 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SwipeDetector.h"
+#include "TrackingDetector.h"
+
+// both camera images of a frame, from LeapC, the FrameGenerator or a recorded session
+struct ImageFrame {
+	int64_t frameId { 0 };
+	int64_t timestamp { 0 }; // clock of the frame's source, only compared to other timestamps of the same source
+	int width { 0 };
+	int height { 0 };
+	const uint8_t* left { nullptr };
+	const uint8_t* right { nullptr };
+	TrackingFrame tracking; // the latest tracking frame when the images arrived
+};
+
+// A recorded session is a header followed by fixed size frame records, each of which is the frame id, the timestamp,
+// the latest tracking frame (since version 2) and both camera images. The fixed size makes every frame addressable
+// straight from a memory mapping.
+const uint32_t k_sessionMagic = 0x53454C4C; // "LLES"
+const uint32_t k_sessionVersion = 2;
+const uint32_t k_sessionVersionWithoutTracking = 1; // still read, its frames come without tracking
+const char* const k_sessionExtension = ".lsession";
+const char* const k_labelsExtension = ".labels";
+const int k_sessionQueueFrames = 32; // frames waiting for the disk, about 350 ms at 90 Hz or 20 MB at 640x480
+
+struct SessionHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+};
+
+struct SessionFrameHeader {
+	int64_t frameId;
+	int64_t timestamp;
+};
+
+// A swipe in a session, written by hand or by the FrameGenerator. One per line in the session's .labels file:
+// start and end timestamp, direction (top, right, bottom or left) and 1 if it is a full pass that has to be detected, 0 if not
+struct SessionLabel {
+	int64_t start;
+	int64_t end;
+	SwipeDirection direction;
+	bool fullPass;
+};
+
+// Writes on a thread of its own, the caller only copies the frame into one of a fixed number of preallocated records.
+// When the disk can't keep up the queue fills: with dropWhenFull (live recording on the Leap polling thread) the frame
+// is left out and counted, otherwise writeFrame waits for a free record.
+class SessionWriter
+{
+public:
+	~SessionWriter();
+
+	bool open(const std::string& path, int width, int height, bool dropWhenFull = false);
+	bool writeFrame(const ImageFrame& frame); // false once writing to the file failed
+	void close(); // returns when every queued frame is written
+	bool isOpen();
+	uint64_t getDroppedCount();
+
+private:
+	void writeQueuedFrames();
+
+	FILE* m_file { nullptr };
+	int m_width { 0 };
+	int m_height { 0 };
+	bool m_dropWhenFull { false };
+	size_t m_recordSize { 0 };
+	std::vector<std::vector<uint8_t>> m_records; // frame header, tracking frame and both images, exactly as they go into the file
+
+	std::thread m_thread;
+	std::mutex m_queueMutex;
+	std::condition_variable m_queueChanged;
+	size_t m_queueStart { 0 }; // oldest record that isn't written yet
+	size_t m_queueLength { 0 };
+	bool m_closing { false };
+	std::atomic<bool> m_failed { false };
+	uint64_t m_droppedCount { 0 };
+};
+
+// Maps a session into memory read-only, frames are read straight from the page cache without any copies.
+class SessionReader
+{
+public:
+	~SessionReader();
+
+	bool open(const std::string& path);
+	void close();
+
+	size_t getFrameCount();
+	ImageFrame getFrame(size_t index);
+
+private:
+	void* m_file { nullptr }; // Windows only, elsewhere the descriptor is closed right after mapping
+	void* m_mapping { nullptr };
+	const uint8_t* m_data { nullptr };
+	size_t m_dataSize { 0 };
+	size_t m_frameCount { 0 };
+	size_t m_frameSize { 0 };
+	size_t m_trackingSize { 0 }; // 0 for sessions without tracking
+	int m_width { 0 };
+	int m_height { 0 };
+};
+
+// session-<date>-<time>.lsession in the working directory
+std::string makeSessionFileName();
+std::vector<SessionLabel> loadSessionLabels(const std::string& path);
+bool saveSessionLabels(const std::string& path, const std::vector<SessionLabel>& labels);
@@ -0,0 +1,167 @@
+#include "StartupBenchmark.h"
+#include "ProgramCache.h"
+#include "Log.h"
+#include "utils.h"
+
+#include "windows.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+const DWORD k_startupTimeout = 30000; // milliseconds a single run may take before it counts as hung
+
+struct StartupTaskSamples {
+	std::string name;
+	std::vector<double> starts; // milliseconds
+	std::vector<double> durations;
+	int failures { 0 };
+};
+
+struct StartupSeries {
+	std::vector<StartupTaskSamples> samples;
+	std::vector<double> processTimes; // milliseconds
+};
+
+double median(std::vector<double> values) {
+	if (values.empty()) return 0.0;
+
+	std::sort(values.begin(), values.end());
+	size_t middle = values.size() / 2;
+
+	return (values.size() % 2 == 0) ? (values[middle - 1] + values[middle]) / 2.0 : values[middle];
+}
+
+bool readStartupTimings(const std::string& path, std::vector<StartupTaskSamples>& samples) {
+	FILE* file = nullptr;
+	if (fopen_s(&file, path.c_str(), "r") != 0 || file == nullptr) {
+		return false;
+	}
+
+	char name[128];
+	long long start, duration;
+	int succeeded;
+
+	while (fscanf_s(file, " %127[^\t]\t%lld\t%lld\t%d", name, static_cast<unsigned>(sizeof(name)), &start, &duration, &succeeded) == 4) {
+		auto entry = std::find_if(samples.begin(), samples.end(), [&name](const StartupTaskSamples& task) { return task.name == name; });
+
+		if (entry == samples.end()) {
+			samples.push_back({ name });
+			entry = samples.end() - 1;
+		}
+
+		entry->starts.push_back(start / 1000.0);
+		entry->durations.push_back(duration / 1000.0);
+
+		if (!succeeded) {
+			entry->failures++;
+		}
+	}
+
+	fclose(file);
+	return true;
+}
+
+// a cold series deletes the stored program binaries before every run, so the shaders are compiled each time
+bool runStartupSeries(const char* executable, const std::string& timingsPath, int runs, bool synthetic, bool coldProgramCache, StartupSeries& series) {
+	for (int run = 0; run < runs; run++) {
+		std::remove(timingsPath.c_str());
+
+		if (coldProgramCache) {
+			ProgramCache::getInstance()->clear();
+		}
+
+		std::string commandLine = std::string("\"") + executable + "\" --startup-timings \"" + timingsPath + "\"";
+		if (synthetic) {
+			commandLine += " --synthetic";
+		}
+
+		STARTUPINFOA startupInfo = { sizeof(startupInfo) };
+		PROCESS_INFORMATION processInfo = { 0 };
+
+		int64_t start = getHostTimeMicroseconds();
+
+		if (!CreateProcessA(NULL, &commandLine[0], NULL, NULL, FALSE, 0, NULL, NULL, &startupInfo, &processInfo)) {
+			LOG_ERROR("Could not start {}, error {}", executable, GetLastError());
+			return false;
+		}
+
+		DWORD waitResult = WaitForSingleObject(processInfo.hProcess, k_startupTimeout);
+		int64_t end = getHostTimeMicroseconds();
+
+		if (waitResult != WAIT_OBJECT_0) {
+			TerminateProcess(processInfo.hProcess, 1);
+		}
+
+		CloseHandle(processInfo.hThread);
+		CloseHandle(processInfo.hProcess);
+
+		if (waitResult != WAIT_OBJECT_0 || !readStartupTimings(timingsPath, series.samples)) {
+			LOG_ERROR("Startup benchmark run {} did not finish", run + 1);
+			continue;
+		}
+
+		series.processTimes.push_back((end - start) / 1000.0);
+		LOG_INFO("Startup benchmark run {} with a {} program cache: {} ms", run + 1, coldProgramCache ? "cold" : "warm", series.processTimes.back());
+	}
+
+	return true;
+}
+
+void writeStartupSeries(FILE* file, const char* name, const StartupSeries& series, bool last) {
+	const std::vector<double>& processTimes = series.processTimes;
+
+	fprintf(file, "\t\"%s\": {\n\t\t\"runs\": %d,\n\t\t\"process_ms_median\": %.2f,\n\t\t\"process_ms_min\": %.2f,\n\t\t\"process_ms_max\": %.2f,\n\t\t\"tasks\": [\n",
+		name, static_cast<int>(processTimes.size()), median(processTimes),
+		*std::min_element(processTimes.begin(), processTimes.end()), *std::max_element(processTimes.begin(), processTimes.end()));
+
+	for (size_t i = 0; i < series.samples.size(); i++) {
+		const StartupTaskSamples& task = series.samples[i];
+
+		fprintf(file, "\t\t\t{ \"name\": \"%s\", \"start_ms_median\": %.2f, \"duration_ms_median\": %.2f, \"failures\": %d }%s\n",
+			task.name.c_str(), median(task.starts), median(task.durations), task.failures, (i + 1 < series.samples.size()) ? "," : "");
+	}
+
+	fprintf(file, "\t\t]\n\t}%s\n", last ? "" : ",");
+}
+
+int runStartupBenchmark(const char* outputPath, int runs, bool synthetic) {
+	char executable[MAX_PATH];
+	DWORD executableLength = GetModuleFileNameA(NULL, executable, MAX_PATH);
+	if (executableLength == 0 || executableLength >= MAX_PATH) {
+		LOG_ERROR("Could not find the executable to start");
+		return 1;
+	}
+
+	std::string timingsPath = (std::filesystem::temp_directory_path() / "leap-overlay-startup.txt").string();
+
+	// the last cold run leaves the binaries behind for the warm ones
+	StartupSeries cold;
+	StartupSeries warm;
+
+	bool success = runStartupSeries(executable, timingsPath, runs, synthetic, true, cold) &&
+		runStartupSeries(executable, timingsPath, runs, synthetic, false, warm);
+
+	std::remove(timingsPath.c_str());
+
+	if (!success || cold.processTimes.empty() || warm.processTimes.empty()) {
+		LOG_ERROR("Not enough startup benchmark runs finished");
+		return 1;
+	}
+
+	FILE* file = nullptr;
+	if (fopen_s(&file, outputPath, "w") != 0 || file == nullptr) {
+		LOG_ERROR("Could not write startup benchmark results to {}", outputPath);
+		return 1;
+	}
+
+	fprintf(file, "{\n\t\"synthetic\": %s,\n", synthetic ? "true" : "false");
+	writeStartupSeries(file, "cold_program_cache", cold, false);
+	writeStartupSeries(file, "warm_program_cache", warm, true);
+	fprintf(file, "}\n");
+	fclose(file);
+
+	LOG_INFO("Startup benchmark results written to {}", outputPath);
+	return 0;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+// Starts the application the given number of times with --startup-timings and writes the median time of every startup task,
+// the time until the overlay was ready and the wall time of the whole process as JSON. This happens twice, first with the
+// stored program binaries deleted before every run and then with them in place, see ProgramCache.
+// Each run starts a fresh process, but after the first one the executable and the runtimes are in the file cache.
+int runStartupBenchmark(const char* outputPath, int runs, bool synthetic);
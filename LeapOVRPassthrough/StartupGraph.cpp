@@ -0,0 +1,226 @@
+#include "StartupGraph.h"
+#include "Trace.h"
+#include "Log.h"
+#include "utils.h"
+
+#include <cstdio>
+
+StartupGraph::StartupGraph(int64_t startTime) :
+	m_startTime(startTime)
+{ }
+
+StartupGraph::~StartupGraph()
+{
+	join();
+}
+
+StartupGraph::TaskId StartupGraph::addTask(const char* name, std::function<bool()> task, const std::vector<TaskId>& dependencies, bool mainThread)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	Task entry;
+	entry.name = name;
+	entry.function = std::move(task);
+	entry.dependencies = dependencies;
+	entry.mainThread = mainThread;
+	m_tasks.push_back(std::move(entry));
+
+	return m_tasks.size() - 1;
+}
+
+bool StartupGraph::run(const std::vector<TaskId>& required)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_started = true;
+		scheduleReadyTasks();
+	}
+
+	// tasks are only added before run(), so the list itself doesn't change from here on
+	for (TaskId id = 0; id < m_tasks.size(); id++) {
+		if (!m_tasks[id].mainThread) continue;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_taskFinished.wait(lock, [this, id] { return dependenciesFinished(m_tasks[id]); });
+
+			if (!dependenciesSucceeded(m_tasks[id])) {
+				m_tasks[id].state = StartupTask_Failed;
+				LOG_ERROR("Startup: skipped {}, a task it depends on failed", m_tasks[id].name);
+				scheduleReadyTasks();
+				m_taskFinished.notify_all();
+				continue;
+			}
+
+			m_tasks[id].state = StartupTask_Running;
+		}
+
+		executeTask(id);
+	}
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_taskFinished.wait(lock, [this, &required] {
+		for (TaskId id : required) {
+			if (!isFinished(id)) return false;
+		}
+		return true;
+	});
+
+	m_readyTime = getHostTimeMicroseconds() - m_startTime;
+
+	bool success = true;
+	for (TaskId id : required) {
+		success = success && m_tasks[id].state == StartupTask_Done;
+	}
+
+	LOG_INFO("Startup: ready after {} ms{}", m_readyTime / 1000.0, success ? "" : ", but some of it failed");
+	return success;
+}
+
+bool StartupGraph::succeeded(TaskId id)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_tasks[id].state == StartupTask_Done;
+}
+
+void StartupGraph::join()
+{
+	std::vector<std::thread> threads;
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		if (!m_started) return;
+
+		// finishing tasks start the ones waiting for them, so the thread list is only complete once every task is finished
+		m_taskFinished.wait(lock, [this] {
+			for (TaskId id = 0; id < m_tasks.size(); id++) {
+				if (!isFinished(id)) return false;
+			}
+			return true;
+		});
+
+		threads.swap(m_threads);
+	}
+
+	for (auto& thread : threads) {
+		thread.join();
+	}
+}
+
+int64_t StartupGraph::getReadyTime()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_readyTime;
+}
+
+std::vector<StartupTiming> StartupGraph::getTimings()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::vector<StartupTiming> timings;
+
+	for (const Task& task : m_tasks) {
+		if (task.state == StartupTask_Done || task.state == StartupTask_Failed) {
+			timings.push_back({ task.name, task.start, task.duration, task.state == StartupTask_Done, task.mainThread });
+		}
+	}
+
+	return timings;
+}
+
+bool StartupGraph::writeTimings(const char* path)
+{
+	FILE* file = nullptr;
+	if (fopen_s(&file, path, "w") != 0 || file == nullptr) {
+		LOG_ERROR("Could not write startup timings to {}", path);
+		return false;
+	}
+
+	for (const StartupTiming& timing : getTimings()) {
+		fprintf(file, "%s\t%lld\t%lld\t%d\n", timing.name.c_str(), static_cast<long long>(timing.start), static_cast<long long>(timing.duration), timing.succeeded ? 1 : 0);
+	}
+
+	fprintf(file, "ready\t0\t%lld\t1\n", static_cast<long long>(getReadyTime()));
+	fclose(file);
+
+	return true;
+}
+
+bool StartupGraph::isFinished(TaskId id)
+{
+	return m_tasks[id].state == StartupTask_Done || m_tasks[id].state == StartupTask_Failed;
+}
+
+bool StartupGraph::dependenciesFinished(const Task& task)
+{
+	for (TaskId dependency : task.dependencies) {
+		if (!isFinished(dependency)) return false;
+	}
+
+	return true;
+}
+
+bool StartupGraph::dependenciesSucceeded(const Task& task)
+{
+	for (TaskId dependency : task.dependencies) {
+		if (m_tasks[dependency].state != StartupTask_Done) return false;
+	}
+
+	return true;
+}
+
+void StartupGraph::scheduleReadyTasks()
+{
+	// skipping a task can make others ready to be skipped, so go around until nothing changes
+	bool changed = true;
+
+	while (changed) {
+		changed = false;
+
+		for (TaskId id = 0; id < m_tasks.size(); id++) {
+			Task& task = m_tasks[id];
+
+			if (task.mainThread || task.state != StartupTask_Pending || !dependenciesFinished(task)) continue;
+
+			if (!dependenciesSucceeded(task)) {
+				task.state = StartupTask_Failed;
+				LOG_ERROR("Startup: skipped {}, a task it depends on failed", task.name);
+				changed = true;
+				continue;
+			}
+
+			task.state = StartupTask_Running;
+			m_threads.emplace_back([this, id] {
+				TRACE_THREAD_NAME(m_tasks[id].name.c_str());
+				executeTask(id);
+			});
+		}
+	}
+}
+
+void StartupGraph::executeTask(TaskId id)
+{
+	Task& task = m_tasks[id];
+
+	int64_t start = getHostTimeMicroseconds();
+	bool success;
+
+	{
+		TRACE_SCOPE_DYNAMIC(task.name.c_str());
+		success = task.function();
+	}
+
+	int64_t end = getHostTimeMicroseconds();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	task.state = success ? StartupTask_Done : StartupTask_Failed;
+	task.start = start - m_startTime;
+	task.duration = end - start;
+
+	LOG_INFO("Startup: {} {} after {} ms on {}, started at {} ms",
+		task.name, success ? "finished" : "failed", task.duration / 1000.0, task.mainThread ? "the main thread" : "its own thread", task.start / 1000.0);
+
+	scheduleReadyTasks();
+	m_taskFinished.notify_all();
+}
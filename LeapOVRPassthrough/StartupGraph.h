@@ -0,0 +1,73 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+enum StartupTaskState {
+	StartupTask_Pending = 0,
+	StartupTask_Running,
+	StartupTask_Done,
+	StartupTask_Failed,
+};
+
+struct StartupTiming {
+	std::string name;
+	int64_t start; // microseconds after the start time of the graph
+	int64_t duration;
+	bool succeeded;
+	bool mainThread;
+};
+
+// Brings the application up as a graph of tasks instead of one after the other.
+// Tasks that need the window or the GL context run on the thread calling run(), in the order they were added. All others get a
+// thread of their own as soon as their dependencies are done. A task whose dependency failed is skipped and counts as failed.
+class StartupGraph
+{
+public:
+	typedef size_t TaskId;
+
+	StartupGraph(int64_t startTime); // host time everything is logged relative to, usually the start of WinMain
+	~StartupGraph(); // waits for the tasks that are still running
+
+	TaskId addTask(const char* name, std::function<bool()> task, const std::vector<TaskId>& dependencies = {}, bool mainThread = false);
+
+	// starts the background tasks, runs the main thread tasks and returns once all of the required tasks are done,
+	// false if any of them failed. Tasks that nobody waits for keep running in the background.
+	bool run(const std::vector<TaskId>& required);
+	bool succeeded(TaskId id);
+	void join();
+
+	int64_t getReadyTime(); // microseconds after the start time at which run() returned
+	std::vector<StartupTiming> getTimings(); // of the finished tasks, in the order they were added
+	bool writeTimings(const char* path); // one "name start duration succeeded" line per task, for the startup benchmark
+
+private:
+	struct Task {
+		std::string name;
+		std::function<bool()> function;
+		std::vector<TaskId> dependencies;
+		bool mainThread;
+		StartupTaskState state { StartupTask_Pending };
+		int64_t start { 0 };
+		int64_t duration { 0 };
+	};
+
+	bool isFinished(TaskId id);
+	bool dependenciesFinished(const Task& task);
+	bool dependenciesSucceeded(const Task& task);
+	void scheduleReadyTasks();
+	void executeTask(TaskId id);
+
+	int64_t m_startTime;
+	int64_t m_readyTime { 0 };
+	bool m_started { false };
+	std::vector<Task> m_tasks;
+	std::vector<std::thread> m_threads;
+
+	std::mutex m_mutex;
+	std::condition_variable m_taskFinished;
+};
@@ -0,0 +1,150 @@
+#include "StereoMatcher.h"
+#include "Log.h"
+#include "Trace.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define STEREO_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+StereoMatcher* s_stereoMatcher = nullptr;
+
+StereoMatcher* StereoMatcher::getInstance()
+{
+	if (s_stereoMatcher == nullptr) {
+		s_stereoMatcher = new StereoMatcher();
+	}
+
+	return s_stereoMatcher;
+}
+
+StereoMatcher::StereoMatcher() :
+	// the calling thread (the leap polling thread) always takes part as well
+	m_threadPool((std::min)((std::max)(std::thread::hardware_concurrency(), 2u) - 1, 3u), "Stereo worker"),
+	m_computeHistogram("Stereo matching (ms)", 0.0, 20.0, 80)
+{ }
+
+void StereoMatcher::compute(const ImagePyramid& pyramid)
+{
+	TRACE_SCOPE("StereoMatcher::compute");
+
+	int64_t start = getHostTimeMicroseconds();
+
+	PyramidLevel left = pyramid.getLevel(0, k_stereoPyramidLevel);
+	PyramidLevel right = pyramid.getLevel(1, k_stereoPyramidLevel);
+
+	m_width = left.width;
+	m_height = left.height;
+	m_left = left.data;
+	m_right = right.data;
+
+	if (m_width < k_stereoBlockWidth + k_stereoMaxDisparity || m_height < k_stereoBlockHeight) {
+		return;
+	}
+
+	m_workingMap.frameId = pyramid.getFrameId();
+	m_workingMap.width = (m_width - k_stereoBlockWidth) / k_stereoCellSize + 1;
+	m_workingMap.height = (m_height - k_stereoBlockHeight) / k_stereoCellSize + 1;
+	m_workingMap.disparity.resize(m_workingMap.width * m_workingMap.height);
+
+	m_threadPool.parallelFor(m_workingMap.height, [this](int row) { matchRow(row); });
+
+	m_workingMap.validCount = 0;
+	m_workingMap.maxDisparity = 0;
+
+	for (uint8_t disparity : m_workingMap.disparity) {
+		if (disparity != k_invalidDisparity) {
+			m_workingMap.validCount++;
+			m_workingMap.maxDisparity = (std::max)(m_workingMap.maxDisparity, disparity);
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_publishMutex);
+		std::swap(m_workingMap, m_publishedMap);
+	}
+
+	m_computeHistogram.record((getHostTimeMicroseconds() - start) / 1000.0);
+}
+
+void StereoMatcher::getDepthMap(DepthMap& depthMap)
+{
+	std::lock_guard<std::mutex> lock(m_publishMutex);
+	depthMap = m_publishedMap;
+}
+
+void StereoMatcher::logStatistics()
+{
+	m_computeHistogram.log();
+
+	std::lock_guard<std::mutex> lock(m_publishMutex);
+	LOG_INFO("Depth map: {}x{}, {} valid samples, max disparity {}", m_publishedMap.width, m_publishedMap.height, m_publishedMap.validCount, m_publishedMap.maxDisparity);
+}
+
+void StereoMatcher::matchRow(int row)
+{
+	// a match only counts if the runner-up (ignoring direct neighbours) is at least this much worse, in percent
+	const uint32_t uniquenessRatio = 115;
+
+	int y = row * k_stereoCellSize;
+	uint8_t* out = m_workingMap.disparity.data() + row * m_workingMap.width;
+
+	for (int cell = 0; cell < m_workingMap.width; cell++) {
+		int x = cell * k_stereoCellSize;
+		int maxDisparity = (std::min)(k_stereoMaxDisparity, x);
+
+		uint32_t costs[k_stereoMaxDisparity + 1];
+		uint32_t bestCost = UINT32_MAX;
+		int bestDisparity = 0;
+
+		for (int d = 0; d <= maxDisparity; d++) {
+			const uint8_t* l = m_left + y * m_width + x;
+			const uint8_t* r = m_right + y * m_width + x - d;
+			uint32_t cost = 0;
+
+#ifdef STEREO_USE_SSE2
+			__m128i sum = _mm_setzero_si128();
+
+			for (int i = 0; i < k_stereoBlockHeight; i++) {
+				__m128i lv = _mm_loadu_si128((const __m128i*)(l + i * m_width));
+				__m128i rv = _mm_loadu_si128((const __m128i*)(r + i * m_width));
+				sum = _mm_add_epi64(sum, _mm_sad_epu8(lv, rv));
+			}
+
+			cost = _mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+#else
+			for (int i = 0; i < k_stereoBlockHeight; i++) {
+				for (int j = 0; j < k_stereoBlockWidth; j++) {
+					cost += std::abs(l[i * m_width + j] - r[i * m_width + j]);
+				}
+			}
+#endif
+
+			costs[d] = cost;
+
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestDisparity = d;
+			}
+		}
+
+		uint32_t secondCost = UINT32_MAX;
+
+		for (int d = 0; d <= maxDisparity; d++) {
+			if (std::abs(d - bestDisparity) > 1) {
+				secondCost = (std::min)(secondCost, costs[d]);
+			}
+		}
+
+		// featureless blocks (e.g. the dark background) match everywhere equally well and are rejected here
+		if (secondCost == UINT32_MAX || static_cast<uint64_t>(bestCost) * uniquenessRatio >= static_cast<uint64_t>(secondCost) * 100) {
+			out[cell] = k_invalidDisparity;
+		} else {
+			out[cell] = static_cast<uint8_t>(bestDisparity);
+		}
+	}
+}
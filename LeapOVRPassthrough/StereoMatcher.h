@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <mutex>
+
+#include "Histogram.h"
+#include "ThreadPool.h"
+#include "ImagePyramid.h"
+
+const int k_stereoPyramidLevel = 1; // matching runs on the half resolution images
+const int k_stereoBlockWidth = 16; // one SSE2 register per block row
+const int k_stereoBlockHeight = 8;
+const int k_stereoCellSize = 4; // distance between two depth map samples, in downsampled pixels
+const int k_stereoMaxDisparity = 48; // in downsampled pixels
+const uint8_t k_invalidDisparity = 255;
+
+// low resolution disparity map of the left camera image, larger values are closer to the sensor
+struct DepthMap {
+	int64_t frameId { -1 };
+	int width { 0 };
+	int height { 0 };
+	uint32_t validCount { 0 };
+	uint8_t maxDisparity { 0 };
+	std::vector<uint8_t> disparity;
+};
+
+// Block matching on the two leap camera images.
+// The cameras sit side by side, so matching happens along image rows. Each depth map row is a separate task on the thread pool.
+// The images aren't rectified first, so towards the edges the matching rows are off and those cells mostly come out invalid.
+// Only runs when enabled through LeapHandler::setDepthEnabled(), nothing consumes the depth map yet.
+class StereoMatcher
+{
+public:
+	static StereoMatcher* getInstance();
+
+	StereoMatcher();
+
+	void compute(const ImagePyramid& pyramid);
+	void getDepthMap(DepthMap& depthMap);
+
+	void logStatistics();
+
+private:
+	void matchRow(int row);
+
+	ThreadPool m_threadPool;
+	Histogram m_computeHistogram;
+
+	// scratch state of the frame currently being matched, only touched by compute() and its tasks
+	int m_width { 0 };
+	int m_height { 0 };
+	const uint8_t* m_left { nullptr };
+	const uint8_t* m_right { nullptr };
+	DepthMap m_workingMap;
+
+	std::mutex m_publishMutex;
+	DepthMap m_publishedMap;
+};
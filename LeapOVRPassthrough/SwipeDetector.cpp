@@ -0,0 +1,231 @@
+#include "SwipeDetector.h"
+#include "Trace.h"
+
+#include <cmath>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define SWIPE_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+const char* swipeDirectionNames[SwipeDirection_Count] = {
+	"from top",
+	"from right",
+	"from bottom",
+	"from left",
+};
+
+SwipeDetector::SwipeDetector() :
+	m_grid(),
+	m_cellArea()
+{
+	setFrameRate(90.0f);
+
+	// by default the outer band of cells along every edge
+	setRegions({
+		{ SwipeDirection_FromTop, 0, 0, k_swipeGridColumns, 1 },
+		{ SwipeDirection_FromRight, k_swipeGridColumns - 2, 0, k_swipeGridColumns, k_swipeGridRows },
+		{ SwipeDirection_FromBottom, 0, k_swipeGridRows - 1, k_swipeGridColumns, k_swipeGridRows },
+		{ SwipeDirection_FromLeft, 0, 0, 2, k_swipeGridRows },
+	});
+}
+
+void SwipeDetector::setRegions(const std::vector<SwipeRegion>& regions)
+{
+	m_regions = regions;
+	resizeHistory(m_history.size());
+}
+
+void SwipeDetector::setFrameRate(float framesPerSecond)
+{
+	size_t capacity = static_cast<size_t>(std::ceil(k_swipeHistoryDuration * framesPerSecond / 1e6)) + 1;
+	resizeHistory((std::max)(capacity, static_cast<size_t>(2)));
+}
+
+void SwipeDetector::resizeHistory(size_t capacity)
+{
+	m_history.resize(capacity);
+	m_historyNextIndex = 0;
+
+	for (FrameCounts& counts : m_history) {
+		counts.timestamp = 0;
+		counts.total = 0;
+		counts.regions.assign(m_regions.size(), 0);
+	}
+}
+
+SwipeDirection SwipeDetector::processFrame(int width, int height, const uint8_t* image, int64_t timestamp)
+{
+	TRACE_SCOPE("SwipeDetector::processFrame");
+
+	countGrid(width, height, image);
+
+	FrameCounts& counts = m_history[m_historyNextIndex];
+	counts.timestamp = timestamp;
+	counts.total = 0;
+
+	for (int y = 0; y < k_swipeGridRows; y++) {
+		for (int x = 0; x < k_swipeGridColumns; x++) {
+			counts.total += m_grid[y][x];
+		}
+	}
+
+	for (size_t i = 0; i < m_regions.size(); i++) {
+		const SwipeRegion& region = m_regions[i];
+		uint32_t sum = 0;
+
+		for (int y = region.cellY0; y < region.cellY1; y++) {
+			for (int x = region.cellX0; x < region.cellX1; x++) {
+				sum += m_grid[y][x];
+			}
+		}
+
+		counts.regions[i] = sum;
+	}
+
+	m_historyNextIndex = (m_historyNextIndex + 1) % m_history.size();
+
+	int increasingFrames = countIncreasingFrames(static_cast<uint32_t>(m_brightFraction * width * height));
+
+	if (increasingFrames == 0) {
+		return SwipeDirection_None;
+	}
+
+	// measured in time instead of frames, so that the detector behaves the same in every camera mode
+	const FrameCounts& riseStart = m_history[(m_historyNextIndex + m_history.size() - increasingFrames) % m_history.size()];
+
+	if (timestamp - riseStart.timestamp < k_swipeMinRiseDuration) {
+		return SwipeDirection_None;
+	}
+
+	// the edge that was brightest when the hand started to cover the sensor is the one it came from
+	return classifyEntry(increasingFrames - 1);
+}
+
+void SwipeDetector::setBrightFraction(float fraction)
+{
+	m_brightFraction = fraction;
+}
+
+SwipeDirection SwipeDetector::rotateDirection(SwipeDirection direction, int quarterTurns)
+{
+	if (direction == SwipeDirection_None) return direction;
+
+	int rotated = (static_cast<int>(direction) + quarterTurns) % SwipeDirection_Count;
+	return static_cast<SwipeDirection>((rotated < 0) ? rotated + SwipeDirection_Count : rotated);
+}
+
+const char* SwipeDetector::directionToString(SwipeDirection direction)
+{
+	if (direction == SwipeDirection_None) return "none";
+
+	return swipeDirectionNames[direction];
+}
+
+void SwipeDetector::countGrid(int width, int height, const uint8_t* image)
+{
+	const uint8_t threshold = 100;
+
+	int columnStart[k_swipeGridColumns + 1];
+	for (int x = 0; x <= k_swipeGridColumns; x++) {
+		columnStart[x] = x * width / k_swipeGridColumns;
+	}
+
+#ifdef SWIPE_USE_SSE2
+	const __m128i thresholdVector = _mm_set1_epi8(static_cast<char>(threshold));
+	const __m128i ones = _mm_set1_epi8(1);
+	const __m128i zero = _mm_setzero_si128();
+#endif
+
+	for (int cellY = 0; cellY < k_swipeGridRows; cellY++) {
+		int rowStart = cellY * height / k_swipeGridRows;
+		int rowEnd = (cellY + 1) * height / k_swipeGridRows;
+
+		for (int cellX = 0; cellX < k_swipeGridColumns; cellX++) {
+			int x0 = columnStart[cellX];
+			int x1 = columnStart[cellX + 1];
+			uint32_t count = 0;
+
+#ifdef SWIPE_USE_SSE2
+			__m128i sum = _mm_setzero_si128();
+#endif
+
+			for (int y = rowStart; y < rowEnd; y++) {
+				const uint8_t* row = image + y * width;
+				int x = x0;
+
+#ifdef SWIPE_USE_SSE2
+				for (; x + 16 <= x1; x += 16) {
+					__m128i pixels = _mm_loadu_si128((const __m128i*)(row + x));
+					// max(p, t) == p <=> p >= t, which yields 0xFF per bright pixel. reduced to 0/1 and summed with psadbw
+					__m128i bright = _mm_cmpeq_epi8(_mm_max_epu8(pixels, thresholdVector), pixels);
+					sum = _mm_add_epi64(sum, _mm_sad_epu8(_mm_and_si128(bright, ones), zero));
+				}
+#endif
+
+				for (; x < x1; x++) {
+					if (row[x] >= threshold) {
+						count++;
+					}
+				}
+			}
+
+#ifdef SWIPE_USE_SSE2
+			count += _mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+#endif
+
+			m_grid[cellY][cellX] = count;
+			m_cellArea[cellY][cellX] = (x1 - x0) * (rowEnd - rowStart);
+		}
+	}
+}
+
+int SwipeDetector::countIncreasingFrames(uint32_t threshold)
+{
+	int result = 0;
+	uint32_t last = UINT32_MAX;
+
+	// walk back from the newest frame for as long as the bright area kept growing
+	for (size_t i = 1; i <= m_history.size(); i++) {
+		size_t index = (m_historyNextIndex + m_history.size() - i) % m_history.size();
+		uint32_t value = m_history[index].total;
+
+		if (value < threshold || value >= last) {
+			break;
+		}
+
+		result++;
+		last = value;
+	}
+
+	return result;
+}
+
+SwipeDirection SwipeDetector::classifyEntry(int frameAge)
+{
+	const FrameCounts& counts = m_history[(m_historyNextIndex + m_history.size() - 1 - frameAge) % m_history.size()];
+
+	SwipeDirection result = SwipeDirection_None;
+	double bestCoverage = 0.0;
+
+	for (size_t i = 0; i < m_regions.size(); i++) {
+		const SwipeRegion& region = m_regions[i];
+		uint32_t area = 0;
+
+		for (int y = region.cellY0; y < region.cellY1; y++) {
+			for (int x = region.cellX0; x < region.cellX1; x++) {
+				area += m_cellArea[y][x];
+			}
+		}
+
+		double coverage = (area > 0) ? static_cast<double>(counts.regions[i]) / area : 0.0;
+
+		if (coverage > bestCoverage) {
+			bestCoverage = coverage;
+			result = region.direction;
+		}
+	}
+
+	return result;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <cstddef>
+
+const int k_swipeGridColumns = 8;
+const int k_swipeGridRows = 4;
+const int64_t k_swipeHistoryDuration = 500000; // microseconds of frames kept, the ring capacity follows from the frame rate
+const int64_t k_swipeMinRiseDuration = 40000; // how long the bright area has to keep growing, about 5 frames at 90 Hz
+
+// the edge of the image a hand entered from, in clockwise order
+enum SwipeDirection {
+	SwipeDirection_None = -1,
+	SwipeDirection_FromTop = 0,
+	SwipeDirection_FromRight,
+	SwipeDirection_FromBottom,
+	SwipeDirection_FromLeft,
+	SwipeDirection_Count
+};
+
+// rectangle of grid cells (end exclusive) whose brightness indicates a hand entering from the given direction
+struct SwipeRegion {
+	SwipeDirection direction;
+	int cellX0, cellY0, cellX1, cellY1;
+};
+
+// Detects a hand sliding over the sensor and the edge it came from.
+// A single pass over the image counts bright pixels per cell of a coarse grid, all regions are then summed from the grid.
+class SwipeDetector
+{
+public:
+	SwipeDetector();
+
+	SwipeDirection processFrame(int width, int height, const uint8_t* image, int64_t timestamp);
+	void setRegions(const std::vector<SwipeRegion>& regions);
+	void setFrameRate(float framesPerSecond);
+	void setBrightFraction(float fraction);
+
+	static SwipeDirection rotateDirection(SwipeDirection direction, int quarterTurns);
+	static const char* directionToString(SwipeDirection direction);
+
+private:
+	struct FrameCounts {
+		int64_t timestamp;
+		uint32_t total;
+		std::vector<uint32_t> regions;
+	};
+
+	void countGrid(int width, int height, const uint8_t* image);
+	int countIncreasingFrames(uint32_t threshold);
+	void resizeHistory(size_t capacity);
+	SwipeDirection classifyEntry(int frameAge);
+
+	std::vector<SwipeRegion> m_regions;
+	float m_brightFraction { 0.2f }; // share of the whole image, bright pixels summed over all cells, a frame below it ends a rise
+	uint32_t m_grid[k_swipeGridRows][k_swipeGridColumns]; // bright pixels per cell
+	uint32_t m_cellArea[k_swipeGridRows][k_swipeGridColumns]; // pixels per cell
+
+	std::vector<FrameCounts> m_history;
+	uint32_t m_historyNextIndex { 0 };
+};
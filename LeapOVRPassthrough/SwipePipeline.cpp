@@ -0,0 +1,38 @@
+#include "SwipePipeline.h"
+
+SwipeDirection SwipePipeline::processFrame(const std::shared_ptr<const ImagePyramid>& pyramid, SwipeSource source, int64_t frameTime)
+{
+	if (source != m_activeSource) {
+		m_activeSource = source;
+		m_motionDetector.reset();
+		m_backgroundModel.reset();
+	}
+
+	if (source == SwipeSource_Motion) {
+		return m_motionDetector.processFrame(pyramid, frameTime);
+	}
+
+	if (source == SwipeSource_Foreground) {
+		// swipes are detected on the foreground mask instead of raw brightness, which makes them independent of the room's lighting
+		m_backgroundModel.processFrame(pyramid->getLevel(0, k_backgroundPyramidLevel));
+		return m_swipeDetector.processFrame(m_backgroundModel.getWidth(), m_backgroundModel.getHeight(), m_backgroundModel.getForegroundMask(), frameTime);
+	}
+
+	return SwipeDirection_None;
+}
+
+void SwipePipeline::setFrameRate(float framesPerSecond)
+{
+	m_swipeDetector.setFrameRate(framesPerSecond);
+}
+
+void SwipePipeline::setThresholds(const SwipeThresholds& thresholds)
+{
+	m_motionDetector.setThresholds(thresholds.motion);
+	m_swipeDetector.setBrightFraction(thresholds.brightFraction);
+}
+
+void SwipePipeline::logStatistics()
+{
+	m_motionDetector.logStatistics();
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+
+#include "ImagePyramid.h"
+#include "SwipeDetector.h"
+#include "BackgroundModel.h"
+#include "MotionDetector.h"
+
+enum SwipeSource {
+	SwipeSource_Motion, // coherent motion across the view, see MotionDetector
+	SwipeSource_Foreground, // foreground entering from an edge, see BackgroundModel and SwipeDetector
+	SwipeSource_Tracking, // palm motion reported by the tracking service, see TrackingDetector
+	SwipeSource_Count,
+};
+
+const int64_t k_swipeCooldown = 2000000; // microseconds between two swipes
+
+struct SwipeThresholds {
+	MotionThresholds motion;
+	float brightFraction { 0.2f }; // see SwipeDetector
+};
+
+// The image based swipe detection, used by LeapHandler on live frames and by the offline evaluation on recordings.
+// Switching the source starts the detectors over, the inactive one didn't see the frames in between.
+class SwipePipeline
+{
+public:
+	SwipeDirection processFrame(const std::shared_ptr<const ImagePyramid>& pyramid, SwipeSource source, int64_t frameTime);
+	void setFrameRate(float framesPerSecond);
+	void setThresholds(const SwipeThresholds& thresholds);
+	void logStatistics();
+
+private:
+	SwipeSource m_activeSource { SwipeSource_Motion };
+
+	BackgroundModel m_backgroundModel;
+	SwipeDetector m_swipeDetector;
+	MotionDetector m_motionDetector;
+};
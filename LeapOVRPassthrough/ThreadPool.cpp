@@ -0,0 +1,87 @@
+#include "ThreadPool.h"
+#include "Trace.h"
+
+ThreadPool::ThreadPool(uint32_t threadCount, const char* name) :
+	m_name(name)
+{
+	for (uint32_t i = 0; i < threadCount; i++) {
+		m_workers.emplace_back(&ThreadPool::workerLoop, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_workAvailable.notify_all();
+
+	for (auto& worker : m_workers) {
+		worker.join();
+	}
+}
+
+void ThreadPool::parallelFor(int taskCount, const std::function<void(int)>& task)
+{
+	if (taskCount <= 0) return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_task = &task;
+		m_taskCount = taskCount;
+		m_nextTask = 0;
+		m_busyWorkers = static_cast<uint32_t>(m_workers.size());
+		m_generation++;
+	}
+	m_workAvailable.notify_all();
+
+	// the calling thread helps out instead of idling
+	runTasks();
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_workDone.wait(lock, [this] { return m_busyWorkers == 0; });
+	m_task = nullptr;
+}
+
+uint32_t ThreadPool::getThreadCount()
+{
+	return static_cast<uint32_t>(m_workers.size()) + 1;
+}
+
+void ThreadPool::workerLoop(uint32_t index)
+{
+	std::string threadName = m_name + " " + std::to_string(index);
+	TRACE_THREAD_NAME(threadName.c_str());
+
+	uint64_t lastGeneration = 0;
+
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_workAvailable.wait(lock, [this, lastGeneration] { return m_stopping || m_generation != lastGeneration; });
+
+			if (m_stopping) return;
+
+			lastGeneration = m_generation;
+		}
+
+		runTasks();
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_busyWorkers--;
+		}
+		m_workDone.notify_one();
+	}
+}
+
+void ThreadPool::runTasks()
+{
+	while (true) {
+		int index = m_nextTask.fetch_add(1);
+		if (index >= m_taskCount) break;
+
+		(*m_task)(index);
+	}
+}
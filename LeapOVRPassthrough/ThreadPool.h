@@ -0,0 +1,38 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+#include <atomic>
+#include <string>
+
+// Small fixed-size pool of worker threads.
+// parallelFor() splits a range of tasks across the workers and the calling thread and returns once all of them are done.
+class ThreadPool
+{
+public:
+	ThreadPool(uint32_t threadCount, const char* name);
+	~ThreadPool();
+
+	void parallelFor(int taskCount, const std::function<void(int)>& task);
+	uint32_t getThreadCount();
+
+private:
+	void workerLoop(uint32_t index);
+	void runTasks();
+
+	std::vector<std::thread> m_workers;
+	std::string m_name;
+
+	std::mutex m_mutex;
+	std::condition_variable m_workAvailable;
+	std::condition_variable m_workDone;
+	bool m_stopping { false };
+	uint64_t m_generation { 0 };
+	uint32_t m_busyWorkers { 0 };
+
+	const std::function<void(int)>* m_task { nullptr };
+	int m_taskCount { 0 };
+	std::atomic<int> m_nextTask { 0 };
+};
@@ -0,0 +1,200 @@
+#include "Trace.h"
+
+#include <algorithm>
+#include <fstream>
+
+// hands the buffer back to the tracer when the thread exits
+struct ThreadTraceBuffer {
+	TraceBuffer* buffer { nullptr };
+
+	~ThreadTraceBuffer() {
+		if (buffer != nullptr) {
+			buffer->retire();
+			buffer = nullptr;
+		}
+	}
+};
+
+thread_local ThreadTraceBuffer t_traceBuffer;
+
+Tracer* s_tracer = nullptr;
+
+TraceBuffer::TraceBuffer(uint32_t threadId) :
+	m_threadId(threadId),
+	m_threadName("Thread " + std::to_string(threadId)),
+	m_events(new TraceEvent[k_capacity]()) // touched up front, so that a thread's first spans don't take the page faults
+{
+}
+
+uint32_t TraceBuffer::getThreadId()
+{
+	return m_threadId;
+}
+
+std::string TraceBuffer::getThreadName()
+{
+	std::lock_guard<std::mutex> lock(m_nameMutex);
+	return m_threadName;
+}
+
+void TraceBuffer::setThreadName(const std::string& name)
+{
+	std::lock_guard<std::mutex> lock(m_nameMutex);
+	m_threadName = name;
+}
+
+std::vector<TraceEvent> TraceBuffer::snapshot()
+{
+	// only events published by the release store in push() are read. The owning thread keeps writing while we copy,
+	// so afterwards every event it may have overwritten in the meantime is dropped instead of written out torn
+	uint64_t end = m_writeIndex.load(std::memory_order_acquire);
+	uint64_t begin = (end > k_capacity) ? end - k_capacity : 0;
+
+	std::vector<TraceEvent> result;
+	result.reserve(static_cast<size_t>(end - begin));
+
+	for (uint64_t i = begin; i < end; i++) {
+		result.push_back(m_events[i & (k_capacity - 1)]);
+	}
+
+	// keeps the copy above from moving past the second read of the write index
+	std::atomic_thread_fence(std::memory_order_acquire);
+
+	// the next push() may already be writing over event written + 1 - capacity
+	uint64_t written = m_writeIndex.load(std::memory_order_relaxed);
+	uint64_t firstIntact = (written + 1 > k_capacity) ? written + 1 - k_capacity : 0;
+
+	if (firstIntact > begin) {
+		size_t torn = static_cast<size_t>((std::min)(firstIntact - begin, static_cast<uint64_t>(result.size())));
+		result.erase(result.begin(), result.begin() + torn);
+	}
+
+	return result;
+}
+
+void TraceBuffer::retire()
+{
+	m_retired.store(true, std::memory_order_release);
+}
+
+bool TraceBuffer::isRetired()
+{
+	return m_retired.load(std::memory_order_acquire);
+}
+
+void TraceBuffer::reuse(uint32_t threadId)
+{
+	// the events of the thread that exited are dropped, the buffer starts over for the new one
+	m_threadId = threadId;
+	setThreadName("Thread " + std::to_string(threadId));
+	m_writeIndex.store(0, std::memory_order_relaxed);
+	m_retired.store(false, std::memory_order_relaxed);
+}
+
+Tracer::Tracer() :
+	m_startTicks(now()),
+	m_startNanoseconds(steadyNanoseconds())
+{
+}
+
+Tracer* Tracer::getInstance()
+{
+	if (s_tracer == nullptr) {
+		s_tracer = new Tracer();
+	}
+
+	return s_tracer;
+}
+
+TraceBuffer* Tracer::threadBuffer()
+{
+	if (t_traceBuffer.buffer == nullptr) {
+		t_traceBuffer.buffer = getInstance()->registerThread();
+	}
+
+	return t_traceBuffer.buffer;
+}
+
+uint32_t Tracer::registerName(const char* name)
+{
+	std::lock_guard<std::mutex> lock(m_namesMutex);
+
+	auto found = m_nameIndices.find(name);
+
+	if (found != m_nameIndices.end()) {
+		return found->second;
+	}
+
+	uint32_t index = static_cast<uint32_t>(m_names.size());
+	m_names.push_back(name);
+	m_nameIndices.emplace(name, index);
+
+	return index;
+}
+
+void Tracer::setThreadName(const char* name)
+{
+	threadBuffer()->setThreadName(name);
+}
+
+TraceBuffer* Tracer::registerThread()
+{
+	std::lock_guard<std::mutex> lock(m_buffersMutex);
+
+	uint32_t threadId = ++m_lastThreadId;
+
+	for (auto& buffer : m_buffers) {
+		if (buffer->isRetired()) {
+			buffer->reuse(threadId);
+			return buffer.get();
+		}
+	}
+
+	m_buffers.push_back(std::make_unique<TraceBuffer>(threadId));
+	return m_buffers.back().get();
+}
+
+bool Tracer::writeChromeTrace(const std::filesystem::path& path)
+{
+	std::ofstream file(path, std::ios::out | std::ios::trunc);
+
+	if (!file.is_open()) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(m_buffersMutex);
+	std::lock_guard<std::mutex> namesLock(m_namesMutex);
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << std::endl;
+
+	int64_t elapsedTicks = now() - m_startTicks;
+	int64_t elapsedNanoseconds = steadyNanoseconds() - m_startNanoseconds;
+	double nanosecondsPerTick = (elapsedTicks > 0 && elapsedNanoseconds > 0) ? static_cast<double>(elapsedNanoseconds) / elapsedTicks : 1.0;
+
+	auto toNanoseconds = [&](int64_t ticks) {
+		return static_cast<int64_t>(ticks * nanosecondsPerTick);
+	};
+
+	bool first = true;
+
+	for (auto& buffer : m_buffers) {
+		file << (first ? "" : ",\n")
+			<< "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->getThreadId()
+			<< ",\"args\":{\"name\":\"" << buffer->getThreadName() << "\"}}";
+		first = false;
+
+		for (const TraceEvent& evt : buffer->snapshot()) {
+			// chrome traces use microseconds, fractional values are allowed
+			int64_t start = m_startNanoseconds + toNanoseconds(evt.start - m_startTicks);
+			int64_t duration = toNanoseconds(evt.duration);
+
+			file << ",\n{\"name\":\"" << m_names[evt.name] << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->getThreadId()
+				<< ",\"ts\":" << (start / 1000) << "." << (start % 1000) / 100
+				<< ",\"dur\":" << (duration / 1000) << "." << (duration % 1000) / 100 << "}";
+		}
+	}
+
+	file << std::endl << "]}" << std::endl;
+
+	return file.good();
+}
@@ -0,0 +1,136 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define TRACE_USE_TSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+// Lightweight span tracing which can be written out as a Chrome trace (chrome://tracing, ui.perfetto.dev).
+// Every thread records into its own ring buffer, so recording a span never takes a lock. A thread's buffer is handed
+// back when the thread exits and reused by the next thread that traces, so short lived threads don't add up.
+// Define ENABLE_TRACING to compile the TRACE_* macros in, without it they expand to nothing. Only Debug builds define it.
+// On x64 spans are timed with the CPU's timestamp counter, which reads in a fraction of the time steady_clock takes,
+// and converted to nanoseconds when the trace is written. The Benchmark project measures the cost of a span (trace_span).
+// Span names are registered once per TRACE_SCOPE and stored as an index, TRACE_SCOPE_DYNAMIC looks the name up every
+// time for names that aren't string literals.
+
+struct TraceEvent {
+	int64_t start; // Tracer::now() ticks
+	uint32_t duration; // ticks, saturates after a second or so, longer spans aren't what tracing is for
+	uint32_t name; // Tracer::registerName() index
+};
+
+class TraceBuffer
+{
+public:
+	static const uint32_t k_capacity = 1 << 16; // has to be a power of two
+
+	TraceBuffer(uint32_t threadId);
+
+	void push(uint32_t name, int64_t start, int64_t duration) {
+		uint64_t index = m_writeIndex.load(std::memory_order_relaxed);
+		uint32_t clamped = (duration < static_cast<int64_t>(UINT32_MAX)) ? static_cast<uint32_t>(duration) : UINT32_MAX;
+		m_events[index & (k_capacity - 1)] = { start, clamped, name };
+		m_writeIndex.store(index + 1, std::memory_order_release);
+	}
+
+	uint32_t getThreadId();
+	std::string getThreadName();
+	void setThreadName(const std::string& name);
+	std::vector<TraceEvent> snapshot();
+
+	// retire() is called by the owning thread when it exits, reuse() by the Tracer when it gives the buffer to another thread
+	void retire();
+	bool isRetired();
+	void reuse(uint32_t threadId);
+
+private:
+	uint32_t m_threadId;
+	std::string m_threadName;
+	std::mutex m_nameMutex;
+	std::unique_ptr<TraceEvent[]> m_events;
+	std::atomic<uint64_t> m_writeIndex { 0 };
+	std::atomic<bool> m_retired { false };
+};
+
+class Tracer
+{
+public:
+	static Tracer* getInstance();
+
+	Tracer();
+
+	// timestamp counter ticks on x64, nanoseconds elsewhere
+	static int64_t now() {
+#ifdef TRACE_USE_TSC
+		return static_cast<int64_t>(__rdtsc());
+#else
+		return steadyNanoseconds();
+#endif
+	}
+
+	static int64_t steadyNanoseconds() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	static TraceBuffer* threadBuffer();
+
+	uint32_t registerName(const char* name); // the same index for the same text, the text is copied
+	void setThreadName(const char* name);
+	bool writeChromeTrace(const std::filesystem::path& path);
+
+private:
+	TraceBuffer* registerThread();
+
+	std::mutex m_buffersMutex;
+	std::vector<std::unique_ptr<TraceBuffer>> m_buffers;
+	uint32_t m_lastThreadId { 0 };
+
+	std::mutex m_namesMutex;
+	std::vector<std::string> m_names;
+	std::unordered_map<std::string, uint32_t> m_nameIndices;
+
+	// both clocks at the tracer's creation, ticks are converted with the rate between then and writing the trace
+	int64_t m_startTicks;
+	int64_t m_startNanoseconds;
+};
+
+class TraceScope
+{
+public:
+	TraceScope(uint32_t name) : m_name(name), m_start(Tracer::now()) {}
+
+	~TraceScope() {
+		Tracer::threadBuffer()->push(m_name, m_start, Tracer::now() - m_start);
+	}
+
+private:
+	uint32_t m_name;
+	int64_t m_start;
+};
+
+#ifdef ENABLE_TRACING
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) static const uint32_t TRACE_CONCAT(traceName, __LINE__) = Tracer::getInstance()->registerName(name); \
+	TraceScope TRACE_CONCAT(traceScope, __LINE__)(TRACE_CONCAT(traceName, __LINE__))
+#define TRACE_SCOPE_DYNAMIC(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(Tracer::getInstance()->registerName(name))
+#define TRACE_THREAD_NAME(name) Tracer::getInstance()->setThreadName(name)
+#else
+#define TRACE_SCOPE(name)
+#define TRACE_SCOPE_DYNAMIC(name)
+#define TRACE_THREAD_NAME(name)
+#endif
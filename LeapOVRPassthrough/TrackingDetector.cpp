@@ -0,0 +1,107 @@
+#include "TrackingDetector.h"
+#include "Trace.h"
+
+#include <cmath>
+#include <algorithm>
+
+TrackingFrame makeTrackingFrame(const LEAP_TRACKING_EVENT& event)
+{
+	TrackingFrame frame;
+	frame.frameId = event.tracking_frame_id;
+	frame.timestamp = event.info.timestamp;
+
+	for (uint32_t i = 0; i < event.nHands; i++) {
+		const LEAP_HAND& hand = event.pHands[i];
+		uint32_t slot = frame.handCount;
+
+		// with more hands than slots the least confident one is replaced
+		if (slot == k_trackedHandsMax) {
+			slot = (frame.hands[0].confidence < frame.hands[1].confidence) ? 0 : 1;
+
+			if (hand.confidence <= frame.hands[slot].confidence) continue;
+		} else {
+			frame.handCount++;
+		}
+
+		frame.hands[slot] = { hand.id, hand.confidence, hand.palm.position, hand.palm.velocity };
+	}
+
+	return frame;
+}
+
+SwipeDirection TrackingDetector::processFrame(const LEAP_TRACKING_EVENT& frame)
+{
+	return processFrame(makeTrackingFrame(frame));
+}
+
+SwipeDirection TrackingDetector::processFrame(const TrackingFrame& frame)
+{
+	TRACE_SCOPE("TrackingDetector::processFrame");
+
+	// the most confident hand is the one doing the gesture
+	const TrackedHand* hand = nullptr;
+
+	for (uint32_t i = 0; i < frame.handCount; i++) {
+		if (hand == nullptr || frame.hands[i].confidence > hand->confidence) {
+			hand = &frame.hands[i];
+		}
+	}
+
+	if (hand == nullptr) {
+		reset();
+		return SwipeDirection_None;
+	}
+
+	if (hand->id != m_handId) {
+		reset();
+		m_handId = hand->id;
+	}
+
+	// the cameras look along +y, so image columns follow the palm's x and image rows follow its z
+	float speedX = std::abs(hand->velocity.x);
+	float speedZ = std::abs(hand->velocity.z);
+	int axis = (speedX >= speedZ) ? 0 : 1;
+
+	if ((std::max)(speedX, speedZ) < k_trackingMinSpeed) {
+		m_movingSince = -1;
+		m_waitForRest = false;
+		return SwipeDirection_None;
+	}
+
+	if (m_waitForRest) {
+		return SwipeDirection_None;
+	}
+
+	// changing direction in the middle of a motion starts over
+	if (m_movingSince < 0 || axis != m_movingAxis) {
+		m_movingSince = frame.timestamp;
+		m_movingAxis = axis;
+		m_startX = hand->position.x;
+		m_startZ = hand->position.z;
+		return SwipeDirection_None;
+	}
+
+	float travel = (axis == 0) ? hand->position.x - m_startX : hand->position.z - m_startZ;
+
+	if (frame.timestamp - m_movingSince < k_trackingMinDuration || std::abs(travel) < k_trackingMinTravel) {
+		return SwipeDirection_None;
+	}
+
+	m_movingSince = -1;
+	m_waitForRest = true;
+
+	// a palm moving down the image came in from the top
+	if (axis == 1) {
+		return (travel > 0.0f) ? SwipeDirection_FromTop : SwipeDirection_FromBottom;
+	} else {
+		return (travel > 0.0f) ? SwipeDirection_FromLeft : SwipeDirection_FromRight;
+	}
+}
+
+void TrackingDetector::reset()
+{
+	m_movingSince = -1;
+	m_movingAxis = -1;
+	m_handId = 0;
+	m_waitForRest = false;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+
+#include "SwipeDetector.h"
+
+extern "C" {
+	#include <LeapC.h>
+}
+
+const float k_trackingMinSpeed = 400.0f; // mm/s along the swipe axis
+const float k_trackingMinTravel = 100.0f; // mm the palm has to cover
+const int64_t k_trackingMinDuration = 30000; // microseconds of continuous motion, same as the image based detector
+const uint32_t k_trackedHandsMax = 2;
+
+struct TrackedHand {
+	uint32_t id;
+	float confidence;
+	LEAP_VECTOR position; // palm, mm
+	LEAP_VECTOR velocity; // palm, mm/s
+};
+
+// The part of a LEAP_TRACKING_EVENT the detector looks at, small and of fixed size so that sessions can record it
+// next to the images, and the FrameGenerator can make one up from its labels
+struct TrackingFrame {
+	int64_t frameId { -1 }; // -1 if there was no tracking frame
+	int64_t timestamp { 0 }; // leap clock
+	uint32_t handCount { 0 };
+	uint32_t reserved { 0 }; // keeps the padding in recorded sessions defined
+	TrackedHand hands[k_trackedHandsMax] {};
+};
+
+// the most confident hands of the event
+TrackingFrame makeTrackingFrame(const LEAP_TRACKING_EVENT& event);
+
+// Detects swipes from the palm the tracking service reports instead of from the camera images.
+// The palm position is already filtered and the velocity is measured, so a sweep is recognized as soon as the palm
+// has travelled far enough, without waiting for the hand to cross an image region.
+class TrackingDetector
+{
+public:
+	SwipeDirection processFrame(const LEAP_TRACKING_EVENT& frame);
+	SwipeDirection processFrame(const TrackingFrame& frame);
+	void reset();
+
+private:
+	int64_t m_movingSince { -1 }; // leap timestamp the current motion started at, -1 while the palm rests
+	int m_movingAxis { -1 }; // 0 for x, 1 for z
+	float m_startX { 0.0f };
+	float m_startZ { 0.0f };
+	uint32_t m_handId { 0 };
+	bool m_waitForRest { false }; // one sweep only counts once, even if the hand keeps going
+};
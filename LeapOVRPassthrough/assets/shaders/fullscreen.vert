@@ -0,0 +1,11 @@
+#version 420 core
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec2 uv;
+
+out vec2 vUv;
+
+void main() {
+	vUv = uv;
+	gl_Position = vec4(position, 1.0);
+}
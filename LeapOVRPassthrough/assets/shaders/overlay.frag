@@ -0,0 +1,52 @@
+#version 420 core
+
+layout(location = 0) out vec4 diffuseColor;
+
+uniform sampler2DArray textureSampler; // layer 0 is the left camera, layer 1 the right one
+uniform sampler2DArray distortionTextureSampler;
+uniform bool useDistortionMap; 
+uniform bool stereo;
+uniform bool showHighlight;
+uniform vec4 highlightRect; // min x, min y, max x, max y in texture coordinates
+
+in vec2 vUv;
+
+void main() {
+	vec2 uv = vUv;
+	float camera = 0.0;
+
+	// in stereo mode the left half of the framebuffer shows the left camera and the right half the right one
+	if (stereo) {
+		camera = (vUv.x < 0.5) ? 0.0 : 1.0;
+		uv.x = vUv.x * 2.0 - camera;
+	}
+
+	vec2 textureUv;
+
+	if (useDistortionMap) {
+		vec2 distortionIndex = texture(distortionTextureSampler, vec3(uv, camera)).xy;
+
+		float hIndex = distortionIndex.x;
+		float vIndex = distortionIndex.y;
+
+		if (vIndex > 0.0 && vIndex < 1.0 && hIndex > 0.0 && hIndex < 1.0) {
+			diffuseColor = vec4(texture(textureSampler, vec3(distortionIndex, camera)).rrr, 1);
+		} else {
+			diffuseColor = vec4(0.2, 0.0, 0.0, 0.0);
+		}
+
+		textureUv = distortionIndex;
+	} else {
+		textureUv = vec2(uv.x, 1 - uv.y);
+		diffuseColor = vec4(texture(textureSampler, vec3(textureUv, camera)).rrr, 1);
+	}
+
+	// outline around the hand
+	if (showHighlight) {
+		vec2 inside = min(textureUv - highlightRect.xy, highlightRect.zw - textureUv);
+
+		if (min(inside.x, inside.y) >= 0.0 && min(inside.x, inside.y) < 0.008) {
+			diffuseColor = vec4(0.2, 0.8, 1.0, 1.0);
+		}
+	}
+}
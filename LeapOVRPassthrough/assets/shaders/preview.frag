@@ -0,0 +1,11 @@
+#version 420 core
+
+layout(location = 0) out vec3 diffuseColor;
+
+uniform sampler2D textureSampler;
+
+in vec2 vUv;
+
+void main() {
+	diffuseColor = texture(textureSampler, vUv).rgb;
+}
@@ -1,11 +1,48 @@
-#include "utils.h"
-
-void outputStringStream(std::stringstream& msg) {
-	std::vector<wchar_t> messageW(msg.str().length() + 1);
-
-	size_t convertedChars = 0;
-	mbstowcs_s(&convertedChars, &messageW[0], messageW.size(), msg.str().c_str(), msg.str().length());
-	OutputDebugString(&messageW[0]);
-
-	msg.clear();
-}
\ No newline at end of file
+#include "utils.h"
+
+#ifndef _WIN32
+#include <cerrno>
+#include <sys/resource.h>
+#endif
+
+int64_t getHostTimeMicroseconds() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t getProcessCpuMicroseconds() {
+#ifdef _WIN32
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+
+	if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime)) {
+		return 0;
+	}
+
+	// both are in 100 ns units
+	uint64_t kernel = (static_cast<uint64_t>(kernelTime.dwHighDateTime) << 32) | kernelTime.dwLowDateTime;
+	uint64_t user = (static_cast<uint64_t>(userTime.dwHighDateTime) << 32) | userTime.dwLowDateTime;
+
+	return static_cast<int64_t>((kernel + user) / 10);
+#else
+	rusage usage;
+
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+		return 0;
+	}
+
+	int64_t kernel = static_cast<int64_t>(usage.ru_stime.tv_sec) * 1000000 + usage.ru_stime.tv_usec;
+	int64_t user = static_cast<int64_t>(usage.ru_utime.tv_sec) * 1000000 + usage.ru_utime.tv_usec;
+
+	return kernel + user;
+#endif
+}
+
+#ifndef _WIN32
+int fopen_s(FILE** file, const char* path, const char* mode) {
+	*file = fopen(path, mode);
+	return (*file == nullptr) ? errno : 0;
+}
+
+int localtime_s(tm* result, const time_t* time) {
+	return (localtime_r(time, result) == nullptr) ? errno : 0;
+}
+#endif
@@ -1,9 +1,22 @@
-#pragma once
-#include <windows.h>
-#include <string>
-#include <iostream>
-#include <sstream> 
-#include <vector>
-#include <debugapi.h>
-
-void outputStringStream(std::stringstream& msg);
\ No newline at end of file
+#pragma once
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <string>
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+
+// host clock in microseconds, all frame timestamps in the application use this timebase
+int64_t getHostTimeMicroseconds();
+
+// user and kernel time of all threads of the process in microseconds
+int64_t getProcessCpuMicroseconds();
+
+#ifndef _WIN32
+// the image processing also builds on Linux (benchmarks and tests), these are the CRT functions it uses on Windows
+int fopen_s(FILE** file, const char* path, const char* mode);
+int localtime_s(tm* result, const time_t* time);
+#endif
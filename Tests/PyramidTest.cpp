@@ -0,0 +1,110 @@
+#include "Test.h"
+#include "ImagePyramid.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+int s_failedChecks = 0;
+
+std::vector<uint8_t> makeNoise(int width, int height, uint32_t seed) {
+	std::mt19937 random(seed);
+	std::vector<uint8_t> image(static_cast<size_t>(width) * height);
+
+	for (uint8_t& pixel : image) {
+		pixel = static_cast<uint8_t>(random() & 0xFF);
+	}
+
+	return image;
+}
+
+// compares the SIMD path against the scalar one for widths with and without a tail after the last full 16 pixel block
+void testHalveMatchesScalar() {
+	const int targetWidths[] = { 1, 7, 15, 16, 17, 31, 32, 33, 48, 50, 95, 160, 320 };
+
+	for (int targetWidth : targetWidths) {
+		const int targetHeight = 5;
+		std::vector<uint8_t> image = makeNoise(2 * targetWidth, 2 * targetHeight, targetWidth);
+		PyramidLevel source = { 2 * targetWidth, 2 * targetHeight, image.data() };
+
+		std::vector<uint8_t> simd(targetWidth * targetHeight);
+		std::vector<uint8_t> scalar(targetWidth * targetHeight);
+		halveImage(source, simd.data(), targetWidth, targetHeight);
+		halveImageScalar(source, scalar.data(), targetWidth, targetHeight);
+
+		int mismatches = 0;
+
+		for (size_t i = 0; i < simd.size(); i++) {
+			mismatches += (simd[i] != scalar[i]) ? 1 : 0;
+		}
+
+		CHECK_MESSAGE(mismatches == 0, "%d of %zu pixels differ at width %d", mismatches, simd.size(), targetWidth);
+	}
+}
+
+// the worst cases for rounding twice: blocks whose sum is 4n + 1 and 4n + 2, the double average rounds both of them up
+void testHalveRounding() {
+	const uint8_t blocks[][4] = { { 0, 1, 0, 0 }, { 0, 0, 1, 1 }, { 1, 0, 0, 0 }, { 0, 1, 1, 0 }, { 255, 254, 254, 254 }, { 3, 0, 0, 0 } };
+	const int targetWidth = 16 + 3; // the same blocks once in the SSE2 part and once in the tail
+
+	for (const uint8_t* block : blocks) {
+		std::vector<uint8_t> image(4 * targetWidth);
+
+		for (int x = 0; x < targetWidth; x++) {
+			image[2 * x] = block[0];
+			image[2 * x + 1] = block[1];
+			image[2 * targetWidth + 2 * x] = block[2];
+			image[2 * targetWidth + 2 * x + 1] = block[3];
+		}
+
+		PyramidLevel source = { 2 * targetWidth, 2, image.data() };
+		std::vector<uint8_t> target(targetWidth);
+		halveImage(source, target.data(), targetWidth, 1);
+
+		uint8_t expected = static_cast<uint8_t>((block[0] + block[1] + block[2] + block[3] + 2) / 4);
+
+		for (int x = 0; x < targetWidth; x++) {
+			CHECK_MESSAGE(target[x] == expected, "block %d %d %d %d became %d at column %d instead of %d",
+				block[0], block[1], block[2], block[3], target[x], x, expected);
+		}
+	}
+}
+
+// every level of a built pyramid is the scalar filter applied to the level above it
+void testPyramidLevels() {
+	const int width = 642; // 321, 160 and 80 pixel wide levels, so the first one has a tail
+	const int height = 242;
+	std::vector<uint8_t> left = makeNoise(width, height, 1);
+	std::vector<uint8_t> right = makeNoise(width, height, 2);
+
+	PyramidPool pool;
+	std::shared_ptr<const ImagePyramid> pyramid = pool.build(1, width, height, left.data(), right.data());
+	const std::vector<uint8_t>* images[k_pyramidCameras] = { &left, &right };
+
+	for (int camera = 0; camera < k_pyramidCameras; camera++) {
+		PyramidLevel above = { width, height, images[camera]->data() };
+
+		for (int level = 1; level < k_pyramidLevels; level++) {
+			PyramidLevel built = pyramid->getLevel(camera, level);
+			std::vector<uint8_t> expected(built.width * built.height);
+			halveImageScalar(above, expected.data(), built.width, built.height);
+
+			CHECK(built.width == above.width / 2 && built.height == above.height / 2);
+			CHECK_MESSAGE(std::equal(expected.begin(), expected.end(), built.data), "camera %d level %d differs from the scalar filter", camera, level);
+
+			above = built;
+		}
+	}
+}
+
+int main() {
+	testHalveMatchesScalar();
+	testHalveRounding();
+	testPyramidLevels();
+
+	Logger::getInstance()->shutdown();
+
+	return (s_failedChecks == 0) ? 0 : 1;
+}
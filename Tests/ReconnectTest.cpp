@@ -0,0 +1,198 @@
+#include "Test.h"
+#include "ConnectionMonitor.h"
+#include "OVROverlayController.h"
+#include "MockOverlaySink.h"
+#include "Clock.h"
+#include "Log.h"
+
+#include <cstdint>
+#include <memory>
+
+int s_failedChecks = 0;
+
+// the SteamVR delays of OVROverlayController
+const int64_t k_initialDelay = 2000000;
+const int64_t k_maxDelay = 8000000;
+const int64_t k_loopInterval = 10000; // microseconds between two passes of the simulated main loop
+
+// every backoff doubles the delay up to the maximum, and the next attempt is due exactly when the delay has passed
+void testBackoffGrowth() {
+	VirtualClock clock(0);
+	ConnectionMonitor monitor("Backoff growth", k_initialDelay, k_maxDelay);
+	monitor.setClock(&clock);
+
+	CHECK(monitor.isAttemptDue());
+
+	const int64_t expectedDelays[] = { 2000000, 4000000, 8000000, 8000000 };
+
+	for (int64_t expected : expectedDelays) {
+		monitor.backOff();
+
+		int64_t delay = monitor.getNextAttemptTime() - clock.now();
+		CHECK_MESSAGE(delay == expected, "backed off %lld us instead of %lld us", static_cast<long long>(delay), static_cast<long long>(expected));
+
+		clock.sleepUntil(monitor.getNextAttemptTime() - 1);
+		CHECK(!monitor.isAttemptDue());
+
+		clock.sleepFor(1);
+		CHECK(monitor.isAttemptDue());
+	}
+
+	CHECK(monitor.getStats().backoffs == 4);
+}
+
+// the delay only starts over after a connection held for the maximum delay, one that drops right away keeps the full backoff
+void testBackoffReset() {
+	VirtualClock clock(0);
+	ConnectionMonitor monitor("Backoff reset", k_initialDelay, k_maxDelay);
+	monitor.setClock(&clock);
+
+	monitor.backOff();
+	monitor.backOff();
+	clock.sleepUntil(monitor.getNextAttemptTime());
+
+	monitor.setState(ConnectionState_Connected, "test");
+	clock.sleepFor(k_maxDelay - 1);
+	monitor.setState(ConnectionState_Disconnected, "dropped right away");
+	monitor.backOff();
+
+	int64_t delay = monitor.getNextAttemptTime() - clock.now();
+	CHECK_MESSAGE(delay == k_maxDelay, "backed off %lld us after a short connection", static_cast<long long>(delay));
+
+	clock.sleepUntil(monitor.getNextAttemptTime());
+	monitor.setState(ConnectionState_Connected, "test");
+	clock.sleepFor(k_maxDelay);
+	monitor.setState(ConnectionState_Disconnected, "dropped after a while");
+	monitor.backOff();
+
+	delay = monitor.getNextAttemptTime() - clock.now();
+	CHECK_MESSAGE(delay == k_initialDelay, "backed off %lld us after a long connection", static_cast<long long>(delay));
+
+	// both outages lasted exactly the backoff, on the virtual clock
+	ConnectionStats stats = monitor.getStats();
+	CHECK(stats.outages == 2);
+	CHECK_MESSAGE(stats.maxRecoveryTime == k_maxDelay, "max recovery time %lld us", static_cast<long long>(stats.maxRecoveryTime));
+}
+
+// runs the connection part of the main loop until the overlay is back, returns when that happened
+int64_t waitForReconnect(OVROverlayController& controller, VirtualClock& clock) {
+	int64_t giveUp = clock.now() + 4 * k_maxDelay;
+
+	while (clock.now() < giveUp) {
+		controller.updateConnection();
+		controller.pollEvents();
+
+		if (controller.isConnected()) break;
+
+		clock.sleepFor(k_loopInterval);
+	}
+
+	return clock.now();
+}
+
+const MockOverlayCall* findLastCall(MockOverlaySink* sink, MockOverlayCallType type) {
+	const MockOverlayCall* found = nullptr;
+
+	for (const MockOverlayCall& call : sink->getCalls()) {
+		if (call.type == type) {
+			found = &call;
+		}
+	}
+
+	return found;
+}
+
+// SteamVR quits and comes back: the controller waits for the backoff, then restores the overlay the way the user left it
+void testOverlayReconnect() {
+	VirtualClock clock(1000000);
+	OVROverlayController controller;
+
+	std::unique_ptr<MockOverlaySink> sink = std::make_unique<MockOverlaySink>(90.0f, &clock);
+	MockOverlaySink* mockSink = sink.get();
+
+	controller.setClock(&clock);
+	controller.setSink(std::move(sink));
+	controller.init();
+	CHECK(controller.isConnected());
+
+	controller.setOverlayRotation(1);
+	controller.setOverlayWidth(0.3f);
+	controller.setStereo(false);
+	controller.showOverlay();
+	controller.pollEvents();
+	CHECK(controller.isOverlayVisible());
+
+	// the first quit gets the initial delay, the alpha changed while disconnected is applied on reconnect
+	mockSink->setRuntimeRunning(false);
+	controller.pollEvents();
+	CHECK(!controller.isConnected());
+	CHECK(!controller.isOverlayVisible());
+
+	int64_t quitTime = clock.now();
+	controller.setOverlayAlpha(0.5f);
+	mockSink->setRuntimeRunning(true);
+	mockSink->clearCalls();
+
+	int64_t recovery = waitForReconnect(controller, clock) - quitTime;
+	CHECK_MESSAGE(recovery == k_initialDelay, "reconnected after %lld us", static_cast<long long>(recovery));
+	CHECK(controller.isConnected());
+	CHECK(controller.isOverlayVisible());
+
+	const MockOverlayCall* width = findLastCall(mockSink, MockOverlayCall_SetWidth);
+	const MockOverlayCall* alpha = findLastCall(mockSink, MockOverlayCall_SetAlpha);
+	const MockOverlayCall* stereo = findLastCall(mockSink, MockOverlayCall_SetStereo);
+	const MockOverlayCall* transform = findLastCall(mockSink, MockOverlayCall_SetTransform);
+
+	CHECK_MESSAGE(width != nullptr && width->value == 0.3f, "the width was not restored");
+	CHECK_MESSAGE(alpha != nullptr && alpha->value == 0.5f, "the alpha set while disconnected was not applied");
+	CHECK_MESSAGE(stereo != nullptr && stereo->value == 0.0f, "stereo was not turned off again");
+	CHECK_MESSAGE(findLastCall(mockSink, MockOverlayCall_Show) != nullptr, "the overlay was not shown again");
+
+	// rotation 1 turns the overlay a quarter, see OVROverlayController::createOverlayMatrix
+	CHECK_MESSAGE(transform != nullptr && transform->transform.m[0][1] == -1.0f && transform->transform.m[1][0] == 1.0f, "the rotation was not restored");
+
+	// SteamVR drops us again right away, so the delay keeps growing
+	mockSink->setRuntimeRunning(false);
+	controller.pollEvents();
+	quitTime = clock.now();
+	mockSink->setRuntimeRunning(true);
+
+	recovery = waitForReconnect(controller, clock) - quitTime;
+	CHECK_MESSAGE(recovery == 2 * k_initialDelay, "reconnected after %lld us following a short connection", static_cast<long long>(recovery));
+
+	// a connection that held for the maximum delay starts the backoff over
+	clock.sleepFor(k_maxDelay);
+	mockSink->setRuntimeRunning(false);
+	controller.pollEvents();
+	quitTime = clock.now();
+	mockSink->setRuntimeRunning(true);
+
+	recovery = waitForReconnect(controller, clock) - quitTime;
+	CHECK_MESSAGE(recovery == k_initialDelay, "reconnected after %lld us following a long connection", static_cast<long long>(recovery));
+	CHECK(controller.isOverlayVisible());
+
+	// while SteamVR stays away no attempt connects, and nothing is sent to the overlay
+	mockSink->setRuntimeRunning(false);
+	controller.pollEvents();
+	mockSink->clearCalls();
+
+	clock.sleepFor(k_maxDelay);
+	for (int i = 0; i < 100; i++) {
+		controller.updateConnection();
+		controller.setOverlayAlpha(1.0f);
+		clock.sleepFor(k_loopInterval);
+	}
+
+	CHECK(!controller.isConnected());
+	CHECK(mockSink->getCalls().empty());
+}
+
+int main() {
+	testBackoffGrowth();
+	testBackoffReset();
+	testOverlayReconnect();
+
+	Logger::getInstance()->shutdown();
+
+	return (s_failedChecks == 0) ? 0 : 1;
+}
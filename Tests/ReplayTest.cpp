@@ -0,0 +1,167 @@
+#include "Test.h"
+#include "FrameGenerator.h"
+#include "SessionFile.h"
+#include "SwipePipeline.h"
+#include "TrackingDetector.h"
+#include "Log.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+int s_failedChecks = 0;
+
+const float k_frameRates[] = { 60.0f, 90.0f, 120.0f };
+const int64_t k_swipeStart = 1000000; // microseconds, gives the background model a second to settle
+const int64_t k_swipeInterval = 3000000; // further apart than the swipe cooldown
+const int64_t k_sessionDuration = k_swipeStart + SwipeDirection_Count * k_swipeInterval;
+const SwipeSource k_checkedSources[] = { SwipeSource_Foreground, SwipeSource_Tracking };
+
+struct Detection {
+	int64_t timestamp;
+	SwipeDirection direction;
+};
+
+// one full pass from every direction, the same script at every frame rate
+FrameGeneratorConfig makeConfig(float frameRate) {
+	FrameGeneratorConfig config;
+	config.frameRate = frameRate;
+
+	for (int i = 0; i < SwipeDirection_Count; i++) {
+		GeneratedSwipe swipe;
+		swipe.direction = static_cast<SwipeDirection>(i);
+		swipe.startTime = k_swipeStart + i * k_swipeInterval;
+		swipe.duration = 400000;
+		config.swipes.push_back(swipe);
+	}
+
+	return config;
+}
+
+bool recordSession(const std::string& path, const FrameGeneratorConfig& config) {
+	FrameGenerator generator(config);
+	SessionWriter writer;
+
+	if (!writer.open(path, config.width, config.height)) {
+		return false;
+	}
+
+	int64_t frameCount = static_cast<int64_t>(k_sessionDuration * config.frameRate / 1e6);
+
+	for (int64_t f = 0; f < frameCount; f++) {
+		const FrameLabel& label = generator.generate(f);
+
+		ImageFrame frame;
+		frame.frameId = f;
+		frame.timestamp = label.timestamp;
+		frame.width = config.width;
+		frame.height = config.height;
+		frame.left = generator.getImage(0);
+		frame.right = generator.getImage(1);
+		frame.tracking = generator.getTrackingFrame();
+
+		if (!writer.writeFrame(frame)) {
+			return false;
+		}
+	}
+
+	writer.close();
+	return true;
+}
+
+// the recording is replayed the way the evaluation does it, with the same cooldown as LeapHandler. The tracking source
+// runs on the tracking frames recorded with the images
+std::vector<Detection> replaySession(const std::string& path, float frameRate, SwipeSource source) {
+	std::vector<Detection> detections;
+	SessionReader reader;
+
+	if (!reader.open(path)) {
+		return detections;
+	}
+
+	PyramidPool pyramidPool;
+	SwipePipeline pipeline;
+	pipeline.setFrameRate(frameRate);
+	TrackingDetector trackingDetector;
+
+	int64_t lastSwipeTimestamp = -k_swipeCooldown;
+
+	for (size_t f = 0; f < reader.getFrameCount(); f++) {
+		ImageFrame frame = reader.getFrame(f);
+		SwipeDirection direction;
+		int64_t timestamp = frame.timestamp;
+
+		if (source == SwipeSource_Tracking) {
+			direction = (frame.tracking.frameId >= 0) ? trackingDetector.processFrame(frame.tracking) : SwipeDirection_None;
+			timestamp = frame.tracking.timestamp;
+		} else {
+			std::shared_ptr<const ImagePyramid> pyramid = pyramidPool.build(frame.frameId, frame.width, frame.height, frame.left, frame.right);
+			direction = pipeline.processFrame(pyramid, source, frame.timestamp);
+		}
+
+		if (direction != SwipeDirection_None && timestamp - lastSwipeTimestamp >= k_swipeCooldown) {
+			lastSwipeTimestamp = timestamp;
+			detections.push_back({ timestamp, direction });
+		}
+	}
+
+	return detections;
+}
+
+// Every pass has to be detected once with its direction at every frame rate, and the time from the hand entering the view
+// to the detection may only differ by the frame interval of the slowest rate, i.e. the windows are sized in time, not frames.
+// The foreground and the tracking detector are checked, the motion detector still misses and confuses directions on the
+// generated frames.
+int main() {
+	std::filesystem::path directory = std::filesystem::temp_directory_path();
+	int64_t latencies[2][3][SwipeDirection_Count] = {};
+
+	for (int r = 0; r < 3; r++) {
+		float frameRate = k_frameRates[r];
+		std::string path = (directory / ("replay-test-" + std::to_string(static_cast<int>(frameRate)) + k_sessionExtension)).string();
+
+		CHECK_MESSAGE(recordSession(path, makeConfig(frameRate)), "could not record %s", path.c_str());
+
+		for (int c = 0; c < 2; c++) {
+			std::vector<Detection> detections = replaySession(path, frameRate, k_checkedSources[c]);
+			std::vector<Detection> repeated = replaySession(path, frameRate, k_checkedSources[c]);
+
+			CHECK_MESSAGE(detections.size() == SwipeDirection_Count, "%zu swipes detected at %.0f Hz", detections.size(), frameRate);
+			CHECK_MESSAGE(repeated.size() == detections.size(), "a second replay at %.0f Hz detected %zu swipes instead of %zu", frameRate, repeated.size(), detections.size());
+
+			for (size_t i = 0; i < detections.size() && i < SwipeDirection_Count; i++) {
+				int64_t swipeStart = k_swipeStart + i * k_swipeInterval;
+				int64_t latency = detections[i].timestamp - swipeStart;
+
+				CHECK_MESSAGE(detections[i].direction == static_cast<SwipeDirection>(i), "swipe %zu at %.0f Hz detected as direction %d", i, frameRate, detections[i].direction);
+				CHECK_MESSAGE(latency > 0 && latency < k_swipeInterval, "swipe %zu at %.0f Hz detected %lld us after it started", i, frameRate, static_cast<long long>(latency));
+
+				if (i < repeated.size()) {
+					CHECK_MESSAGE(repeated[i].timestamp == detections[i].timestamp, "swipe %zu at %.0f Hz detected at a different frame the second time", i, frameRate);
+				}
+
+				latencies[c][r][i] = latency;
+			}
+		}
+
+		std::filesystem::remove(path);
+	}
+
+	const int64_t tolerance = static_cast<int64_t>(1e6f / k_frameRates[0]) + 1000;
+
+	for (int c = 0; c < 2; c++) {
+		for (int r = 1; r < 3; r++) {
+			for (int i = 0; i < SwipeDirection_Count; i++) {
+				int64_t difference = std::llabs(latencies[c][r][i] - latencies[c][0][i]);
+				CHECK_MESSAGE(difference <= tolerance, "source %d: swipe %d is detected after %lld us at %.0f Hz but after %lld us at %.0f Hz", c, i,
+					static_cast<long long>(latencies[c][r][i]), k_frameRates[r], static_cast<long long>(latencies[c][0][i]), k_frameRates[0]);
+			}
+		}
+	}
+
+	Logger::getInstance()->shutdown();
+
+	return (s_failedChecks == 0) ? 0 : 1;
+}
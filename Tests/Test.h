@@ -0,0 +1,10 @@
+#pragma once
+#include <cstdio>
+
+// Every test is a program of its own that returns non-zero when a check failed, ctest runs them (see CMakeLists.txt).
+// A failed check is reported and the test goes on, so that one run shows every failure.
+extern int s_failedChecks;
+
+#define CHECK(condition) do { if (!(condition)) { fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); s_failedChecks++; } } while (0)
+
+#define CHECK_MESSAGE(condition, ...) do { if (!(condition)) { fprintf(stderr, "%s:%d: CHECK(%s) failed: ", __FILE__, __LINE__, #condition); fprintf(stderr, __VA_ARGS__); fprintf(stderr, "\n"); s_failedChecks++; } } while (0)